@@ -0,0 +1,118 @@
+// 压缩编解码微基准：每个成员一次性compress2/uncompress vs 复用的zlib流
+//
+// 用法: codec_bench [压缩级别] [每种大小的总字节数(MB)]
+
+#include "../include/compress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 类日志文本，压缩率接近真实的小配置/日志文件
+static void fill_sample(uint8_t *buf, size_t size, uint32_t seed) {
+    static const char *words[] = {
+        "INFO ", "WARN ", "request ", "user=", "id=", "status=200 ", "latency_ms=",
+        "GET /api/v1/items ", "POST /login ", "\n", "cache hit ", "cache miss ",
+    };
+    size_t pos = 0;
+    while (pos < size) {
+        seed = seed * 1103515245 + 12345;
+        const char *w = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(w);
+        if (n > size - pos) n = size - pos;
+        memcpy(buf + pos, w, n);
+        pos += n;
+        if (pos < size && (seed & 3) == 0) {
+            buf[pos++] = (uint8_t)('0' + (seed >> 8) % 10);
+        }
+    }
+}
+
+// 一次性接口：每次调用都分配并初始化完整的deflate/inflate状态
+static int oneshot_roundtrip(const uint8_t *input, size_t size, int level,
+                             uint8_t *packed, uint8_t *output, size_t *packed_size) {
+    uLongf dest_len = compressBound(size);
+    if (compress2(packed, &dest_len, input, size, level) != Z_OK) return 0;
+    *packed_size = dest_len;
+
+    uLongf out_len = size;
+    return uncompress(output, &out_len, packed, dest_len) == Z_OK && out_len == size;
+}
+
+int main(int argc, char *argv[]) {
+    int level = argc > 1 ? atoi(argv[1]) : 6;
+    size_t total = (size_t)(argc > 2 ? atoi(argv[2]) : 64) * 1024 * 1024;
+    if (level < 1 || level > 9 || total == 0) {
+        fprintf(stderr, "Usage: %s [level 1-9] [MB per size]\n", argv[0]);
+        return 1;
+    }
+
+    CodecContext *codec = codec_context_create();
+    MemoryBuffer *packed = create_buffer(compressBound(64 * 1024));
+    MemoryBuffer *output = create_buffer(64 * 1024);
+    uint8_t *input = malloc(64 * 1024);
+    uint8_t *scratch_packed = malloc(compressBound(64 * 1024));
+    uint8_t *scratch_output = malloc(64 * 1024);
+    if (!codec || !packed || !output || !input || !scratch_packed || !scratch_output) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("level %d, %zu MB per size\n\n", level, total / (1024 * 1024));
+    printf("%8s %8s %14s %14s %10s %10s\n",
+           "size", "members", "oneshot(us)", "reused(us)", "speedup", "ratio");
+
+    for (size_t size = 1024; size <= 64 * 1024; size *= 2) {
+        fill_sample(input, size, (uint32_t)size);
+        size_t members = total / size;
+        if (members < 200) members = 200;
+
+        // 预热
+        size_t packed_size = 0;
+        oneshot_roundtrip(input, size, level, scratch_packed, scratch_output, &packed_size);
+
+        double start = now_seconds();
+        for (size_t i = 0; i < members; i++) {
+            if (!oneshot_roundtrip(input, size, level, scratch_packed, scratch_output, &packed_size)) {
+                fprintf(stderr, "compress2/uncompress failed\n");
+                return 1;
+            }
+        }
+        double oneshot = now_seconds() - start;
+
+        start = now_seconds();
+        for (size_t i = 0; i < members; i++) {
+            if (!codec_compress(codec, input, size, packed, level, NULL, 0) ||
+                !codec_decompress(codec, packed->buffer, packed->size, output, size, NULL, 0)) {
+                fprintf(stderr, "codec round trip failed\n");
+                return 1;
+            }
+        }
+        double reused = now_seconds() - start;
+
+        if (memcmp(output->buffer, input, size) != 0) {
+            fprintf(stderr, "Round trip mismatch at %zu bytes\n", size);
+            return 1;
+        }
+
+        printf("%7zuK %8zu %14.2f %14.2f %9.2fx %9.1f%%\n",
+               size / 1024, members,
+               oneshot / members * 1e6, reused / members * 1e6,
+               oneshot / reused, 100.0 * packed->size / size);
+    }
+
+    codec_context_destroy(codec);
+    destroy_buffer(packed);
+    destroy_buffer(output);
+    free(input);
+    free(scratch_packed);
+    free(scratch_output);
+    return 0;
+}
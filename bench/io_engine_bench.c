@@ -0,0 +1,139 @@
+// I/O引擎基准测试：大量小文件的create/extract，对比同步、io_uring和线程池后端
+//
+// 用法: io_engine_bench [文件数] [最大文件大小] [队列深度]
+
+#include "../include/archiver.h"
+#include "../include/io_engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BENCH_DIR_TEMPLATE "/tmp/io_engine_bench.XXXXXX"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 生成确定性的小文件语料
+static char** make_corpus(int count, int max_size) {
+    char **files = calloc(count, sizeof(char *));
+    uint8_t *buf = malloc(max_size);
+    if (!files || !buf) {
+        free(files);
+        free(buf);
+        return NULL;
+    }
+
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        files[i] = malloc(32);
+        snprintf(files[i], 32, "f%06d.txt", i);
+
+        seed = seed * 1103515245 + 12345;
+        int size = 1 + (int)(seed % (uint32_t)max_size);
+        for (int j = 0; j < size; j++) {
+            // 类文本内容，便于压缩
+            buf[j] = (uint8_t)("abcdefghij \n"[(j * 7 + i) % 12]);
+        }
+
+        FILE *fp = fopen(files[i], "wb");
+        if (fp) {
+            fwrite(buf, 1, size, fp);
+            fclose(fp);
+        }
+    }
+
+    free(buf);
+    return files;
+}
+
+static void remove_tree(const char *dir) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", dir);
+    }
+}
+
+static void run_backend(IoBackend backend, unsigned depth, char **files, int count) {
+    ArchiveContext *ctx = archive_context_create();
+    if (!ctx) return;
+
+    ctx->io_backend = backend;
+    ctx->io_depth = depth;
+
+    // 显示实际使用的后端（io_uring不可用时会退回线程池）
+    IoBackend actual = backend;
+    IoEngine *probe = io_engine_create(backend, depth);
+    if (probe) {
+        actual = io_engine_backend(probe);
+        io_engine_destroy(probe);
+    }
+
+    double start = now_seconds();
+    int ret = archive_create(ctx, "bench.arc", files, count);
+    double create_time = now_seconds() - start;
+
+    start = now_seconds();
+    if (ret == ARCHIVE_OK) {
+        ret = archive_extract(ctx, "bench.arc", "out");
+    }
+    double extract_time = now_seconds() - start;
+
+    printf("%-10s %-10s %10.3f %12.0f %10.3f %12.0f %s\n",
+           io_backend_name(backend), io_backend_name(actual),
+           create_time, count / create_time,
+           extract_time, count / extract_time,
+           ret == ARCHIVE_OK ? "" : archive_strerror(ret));
+
+    unlink("bench.arc");
+    remove_tree("out");
+    archive_context_destroy(ctx);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    int max_size = argc > 2 ? atoi(argv[2]) : 4096;
+    unsigned depth = argc > 3 ? (unsigned)atoi(argv[3]) : IO_ENGINE_DEFAULT_DEPTH;
+    if (count <= 0 || max_size <= 0) {
+        fprintf(stderr, "Usage: %s [files] [max_size] [depth]\n", argv[0]);
+        return 1;
+    }
+
+    char dir[] = BENCH_DIR_TEMPLATE;
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    printf("Generating %d files (1..%d bytes) in %s\n", count, max_size, dir);
+    char **files = make_corpus(count, max_size);
+    if (!files) {
+        fprintf(stderr, "Failed to generate corpus\n");
+        return 1;
+    }
+
+    printf("\n%-10s %-10s %10s %12s %10s %12s\n",
+           "backend", "actual", "create(s)", "files/s", "extract(s)", "files/s");
+
+    const IoBackend backends[] = { IO_BACKEND_SYNC, IO_BACKEND_URING, IO_BACKEND_THREADS };
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        run_backend(backends[i], depth, files, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(files[i]);
+    }
+    free(files);
+
+    if (chdir("/") == 0) {
+        remove_tree(dir);
+    }
+    return 0;
+}
@@ -0,0 +1,329 @@
+// lib/内核微基准：CRC32、压缩/解压、加密/解密和缓冲区追加，脱离端到端流程单独测量。
+// 缓冲区大小从64B按4倍扫到64MB，报告每字节周期数、吞吐和每次调用的内存分配次数。
+//
+// 周期数在x86上取TSC（恒定频率，近似于标称频率下的周期），其他架构只报告ns/byte。
+// 分配次数由本程序替换的malloc/calloc/realloc统计（动态库和zlib、OpenSSL的分配都会经过这里）。
+// 每个测量批次的调用次数按2倍增长，直到耗时超过最短测量时间，只取最后一批。
+//
+// 用法: kernel_bench [-l 压缩级别] [-m 最大MB] [-t 最短测量时间ms] [-k 内核名] [-o 输出JSON]
+
+#include "../include/archiver.h"
+#include "../include/buffer.h"
+#include "../include/compress.h"
+#include "../include/encrypt.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define MIN_SIZE 64
+#define APPEND_PIECE 4096
+#define BENCH_PASSWORD "kernel-bench"
+
+// 分配计数：替换malloc系列，转发给glibc的实现
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long allocations;
+
+void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void *ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t read_cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// 类日志文本，压缩率接近真实的小配置/日志文件
+static void fill_sample(uint8_t *buf, size_t size, uint32_t seed) {
+    static const char *words[] = {
+        "INFO ", "WARN ", "request ", "user=", "id=", "status=200 ", "latency_ms=",
+        "GET /api/v1/items ", "POST /login ", "\n", "cache hit ", "cache miss ",
+    };
+    size_t pos = 0;
+    while (pos < size) {
+        seed = seed * 1103515245 + 12345;
+        const char *w = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(w);
+        if (n > size - pos) n = size - pos;
+        memcpy(buf + pos, w, n);
+        pos += n;
+        if (pos < size && (seed & 3) == 0) {
+            buf[pos++] = (uint8_t)('0' + (seed >> 8) % 10);
+        }
+    }
+}
+
+// 一次测量的共享状态：输入、预先编码好的数据和复用的输出缓冲区
+typedef struct {
+    const uint8_t *input;
+    size_t size;
+    int level;
+    const uint8_t *packed;       // input压缩后的数据
+    size_t packed_size;
+    const uint8_t *sealed;       // input加密后的数据
+    size_t sealed_size;
+    MemoryBuffer *out;           // _to_buffer内核和追加内核复用
+    int ok;
+} KernelState;
+
+typedef void (*KernelFn)(KernelState *state);
+
+static void run_crc32(KernelState *s) {
+    volatile uint32_t crc = calculate_crc32(s->input, s->size);
+    (void)crc;
+}
+
+static void run_compress_data(KernelState *s) {
+    uint8_t *out = NULL;
+    size_t out_size = 0;
+    s->ok &= compress_data(s->input, s->size, &out, &out_size, s->level);
+    free(out);
+}
+
+static void run_decompress_data(KernelState *s) {
+    uint8_t *out = NULL;
+    s->ok &= decompress_data(s->packed, s->packed_size, &out, s->size);
+    free(out);
+}
+
+static void run_compress_to_buffer(KernelState *s) {
+    s->ok &= compress_to_buffer(s->input, s->size, s->out, s->level, NULL, 0);
+}
+
+static void run_decompress_to_buffer(KernelState *s) {
+    s->ok &= decompress_to_buffer(s->packed, s->packed_size, s->out, s->size, NULL, 0);
+}
+
+static void run_encrypt_data(KernelState *s) {
+    uint8_t *out = NULL;
+    size_t out_size = 0;
+    s->ok &= encrypt_data(s->input, s->size, &out, &out_size, BENCH_PASSWORD);
+    free(out);
+}
+
+static void run_decrypt_data(KernelState *s) {
+    uint8_t *out = NULL;
+    size_t out_size = 0;
+    s->ok &= decrypt_data(s->sealed, s->sealed_size, &out, &out_size, BENCH_PASSWORD);
+    free(out);
+}
+
+static void run_encrypt_to_buffer(KernelState *s) {
+    s->ok &= encrypt_to_buffer(s->input, s->size, s->out, BENCH_PASSWORD);
+}
+
+static void run_decrypt_to_buffer(KernelState *s) {
+    s->ok &= decrypt_to_buffer(s->sealed, s->sealed_size, s->out, BENCH_PASSWORD);
+}
+
+// 向已有足够容量的缓冲区追加（复用，只有memcpy）
+static void run_write_to_buffer(KernelState *s) {
+    s->out->size = 0;
+    s->ok &= write_to_buffer(s->out, s->input, s->size);
+}
+
+// 从64字节的新缓冲区开始按4KB分段追加，经过expand_buffer逐次翻倍
+static void run_write_expand(KernelState *s) {
+    MemoryBuffer *buf = create_buffer(MIN_SIZE);
+    if (!buf) {
+        s->ok = 0;
+        return;
+    }
+    for (size_t pos = 0; pos < s->size; pos += APPEND_PIECE) {
+        size_t n = s->size - pos < APPEND_PIECE ? s->size - pos : APPEND_PIECE;
+        s->ok &= write_to_buffer(buf, s->input + pos, n);
+    }
+    destroy_buffer(buf);
+}
+
+typedef struct {
+    const char *name;
+    KernelFn fn;
+} Kernel;
+
+static const Kernel kernels[] = {
+    { "calculate_crc32",      run_crc32 },
+    { "compress_data",        run_compress_data },
+    { "decompress_data",      run_decompress_data },
+    { "compress_to_buffer",   run_compress_to_buffer },
+    { "decompress_to_buffer", run_decompress_to_buffer },
+    { "encrypt_data",         run_encrypt_data },
+    { "decrypt_data",         run_decrypt_data },
+    { "encrypt_to_buffer",    run_encrypt_to_buffer },
+    { "decrypt_to_buffer",    run_decrypt_to_buffer },
+    { "write_to_buffer",      run_write_to_buffer },
+    { "write_to_buffer+expand", run_write_expand },
+};
+
+typedef struct {
+    unsigned long calls;
+    double seconds;
+    uint64_t cycles;
+    unsigned long allocations;
+} Measurement;
+
+// 调用次数按2倍增长，直到一批的耗时超过min_time
+static Measurement measure(const Kernel *kernel, KernelState *state, double min_time) {
+    Measurement m = { 0, 0, 0, 0 };
+    kernel->fn(state);    // 预热（线程上下文、缓冲区首次扩容）
+
+    for (unsigned long calls = 1; ; calls *= 2) {
+        unsigned long allocs = allocations;
+        uint64_t cycles = read_cycles();
+        double start = now_seconds();
+        for (unsigned long i = 0; i < calls; i++) {
+            kernel->fn(state);
+        }
+        m.seconds = now_seconds() - start;
+        m.cycles = read_cycles() - cycles;
+        m.allocations = allocations - allocs;
+        m.calls = calls;
+        if (m.seconds >= min_time || calls >= (1UL << 30)) {
+            return m;
+        }
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-l level] [-m max MB] [-t min ms] [-k kernel] [-o file]\n", prog);
+    fprintf(stderr, "  -l N     compression level (default 6)\n");
+    fprintf(stderr, "  -m N     largest buffer in MB (default 64)\n");
+    fprintf(stderr, "  -t N     minimum measured time per point in ms (default 100)\n");
+    fprintf(stderr, "  -k NAME  run only kernels whose name starts with NAME\n");
+    fprintf(stderr, "  -o FILE  also write the results as JSON to FILE\n");
+}
+
+int main(int argc, char *argv[]) {
+    int level = 6;
+    size_t max_size = (size_t)64 * 1024 * 1024;
+    double min_time = 0.1;
+    const char *only = NULL;
+    const char *output = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:m:t:k:o:h")) != -1) {
+        switch (opt) {
+            case 'l': level = atoi(optarg); break;
+            case 'm': max_size = (size_t)atoi(optarg) * 1024 * 1024; break;
+            case 't': min_time = atoi(optarg) / 1000.0; break;
+            case 'k': only = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (level < 1 || level > 9 || max_size == 0 || min_time <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t *input = malloc(max_size);
+    MemoryBuffer *out = create_buffer(MIN_SIZE);
+    FILE *json = output ? fopen(output, "w") : NULL;
+    if (!input || !out || (output && !json)) {
+        fprintf(stderr, "Cannot set up benchmark\n");
+        return 1;
+    }
+    fill_sample(input, max_size, 1);
+
+    printf("level %d, %s\n\n", level, HAVE_TSC ? "cycles from TSC" : "no cycle counter");
+    printf("%-24s %10s %12s %10s %12s %12s\n",
+           "kernel", "size", "calls", "MB/s", "cycles/byte", "allocs/call");
+    if (json) {
+        fprintf(json, "{\n  \"benchmark\": \"kernels\",\n  \"level\": %d,\n  \"tsc\": %s,\n  \"results\": [\n",
+                level, HAVE_TSC ? "true" : "false");
+    }
+
+    int first = 1;
+    int failures = 0;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        const Kernel *kernel = &kernels[k];
+        if (only && strncmp(kernel->name, only, strlen(only)) != 0) continue;
+
+        for (size_t size = MIN_SIZE; size <= max_size; size *= 4) {
+            KernelState state = { input, size, level, NULL, 0, NULL, 0, out, 1 };
+            uint8_t *packed = NULL;
+            uint8_t *sealed = NULL;
+            if (!compress_data(input, size, &packed, &state.packed_size, level) ||
+                !encrypt_data(input, size, &sealed, &state.sealed_size, BENCH_PASSWORD)) {
+                fprintf(stderr, "Cannot prepare %zu-byte input\n", size);
+                free(packed);
+                return 1;
+            }
+            state.packed = packed;
+            state.sealed = sealed;
+
+            Measurement m = measure(kernel, &state, min_time);
+            double bytes = (double)size * m.calls;
+            double cycles_per_byte = HAVE_TSC ? m.cycles / bytes : 0;
+            double allocs_per_call = (double)m.allocations / m.calls;
+            double mb_per_s = bytes / (1024 * 1024) / m.seconds;
+            if (!state.ok) failures++;
+
+            printf("%-24s %10zu %12lu %10.1f %12.3f %12.2f%s\n", kernel->name, size, m.calls,
+                   mb_per_s, cycles_per_byte, allocs_per_call, state.ok ? "" : "  FAILED");
+            if (json) {
+                fprintf(json, "%s    {\"kernel\": \"%s\", \"size\": %zu, \"calls\": %lu, "
+                        "\"seconds\": %.6f, \"mb_per_s\": %.3f, \"ns_per_byte\": %.4f, ",
+                        first ? "" : ",\n", kernel->name, size, m.calls, m.seconds, mb_per_s,
+                        m.seconds * 1e9 / bytes);
+                if (HAVE_TSC) {
+                    fprintf(json, "\"cycles_per_byte\": %.4f, ", cycles_per_byte);
+                } else {
+                    fprintf(json, "\"cycles_per_byte\": null, ");
+                }
+                fprintf(json, "\"allocs_per_call\": %.3f, \"ok\": %s}", allocs_per_call,
+                        state.ok ? "true" : "false");
+                first = 0;
+            }
+            free(packed);
+            free(sealed);
+        }
+        printf("\n");
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+    destroy_buffer(out);
+    free(input);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+// 预分配和页缓存提示基准测试
+//   1. 逐块追加 vs 先fallocate再写：多个文件交替写入（模拟并发解压），对比耗时和每个文件的extent数
+//   2. 读取源文件：默认 vs POSIX_FADV_SEQUENTIAL vs 读完DONTNEED，对比耗时和读完后留在页缓存中的比例
+//   3. 用库创建/解压含大文件的归档，报告归档和解压出的文件的extent数
+//
+// 用法: prealloc_bench [文件数] [每个文件MB数] [目录]
+// 目录默认在/tmp下；extent数只在支持FIEMAP的文件系统（ext4、xfs、btrfs）上有意义
+
+#include "../include/archiver.h"
+#include "../include/file_ops.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BENCH_DIR_TEMPLATE "prealloc_bench.XXXXXX"
+#define WRITE_CHUNK (64 * 1024)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 文件的extent数（不支持FIEMAP时返回-1）
+static long count_extents(int fd) {
+    struct fiemap fm;
+    memset(&fm, 0, sizeof(fm));
+    fm.fm_length = FIEMAP_MAX_OFFSET;
+    fm.fm_flags = FIEMAP_FLAG_SYNC;
+    fm.fm_extent_count = 0;    // 只要个数
+    if (ioctl(fd, FS_IOC_FIEMAP, &fm) != 0) return -1;
+    return (long)fm.fm_mapped_extents;
+}
+
+static long count_extents_path(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    long n = count_extents(fd);
+    close(fd);
+    return n;
+}
+
+// 页缓存中驻留的比例
+static double cached_ratio(int fd, size_t size) {
+    if (size == 0) return 0;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return -1;
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page;
+    unsigned char *vec = malloc(pages);
+    size_t resident = 0;
+    if (vec && mincore(map, size, vec) == 0) {
+        for (size_t i = 0; i < pages; i++) {
+            resident += vec[i] & 1;
+        }
+    }
+    free(vec);
+    munmap(map, size);
+    return (double)resident / pages;
+}
+
+static void fill_chunk(uint8_t *buf, size_t size, uint32_t seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// 1. count个文件交替追加写入，prealloc为真时先fallocate
+static void run_write(int count, size_t size, int prealloc) {
+    int *fds = calloc(count, sizeof(int));
+    uint8_t *buf = malloc(WRITE_CHUNK);
+    if (!fds || !buf) {
+        free(fds);
+        free(buf);
+        return;
+    }
+    fill_chunk(buf, WRITE_CHUNK, 7);
+
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "w%03d.bin", i);
+        fds[i] = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fds[i] >= 0 && prealloc) {
+            file_preallocate(fds[i], size);
+        }
+    }
+    for (size_t off = 0; off < size; off += WRITE_CHUNK) {
+        size_t n = size - off < WRITE_CHUNK ? size - off : WRITE_CHUNK;
+        for (int i = 0; i < count; i++) {
+            // 每轮都落盘，迫使文件系统边写边分配（大批量解压时脏页回写的效果）
+            if (fds[i] >= 0 && (!file_write_all(fds[i], buf, n) || fdatasync(fds[i]) != 0)) {
+                close(fds[i]);
+                fds[i] = -1;
+            }
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    long extents = 0;
+    int measured = 0;
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0) continue;
+        long n = count_extents(fds[i]);
+        if (n >= 0) {
+            extents += n;
+            measured++;
+        }
+        close(fds[i]);
+        char name[32];
+        snprintf(name, sizeof(name), "w%03d.bin", i);
+        unlink(name);
+    }
+
+    printf("%-22s %10.3f %10.1f %14.1f\n", prealloc ? "fallocate + write" : "append",
+           elapsed, (double)count * size / (1024 * 1024) / elapsed,
+           measured ? (double)extents / measured : -1.0);
+    free(fds);
+    free(buf);
+}
+
+// 2. 读取源文件的方式
+typedef enum { READ_DEFAULT, READ_SEQUENTIAL, READ_DROP } ReadMode;
+
+static void run_read(const char *path, size_t size, ReadMode mode) {
+    static const char *names[] = { "default", "SEQUENTIAL", "SEQUENTIAL + DONTNEED" };
+    uint8_t *buf = malloc(WRITE_CHUNK * 4);
+    int fd = open(path, O_RDONLY);
+    if (!buf || fd < 0) {
+        free(buf);
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    // 从冷缓存开始（文件已落盘，DONTNEED能丢掉全部页）
+    file_drop_cache(fd);
+
+    double start = now_seconds();
+    if (mode != READ_DEFAULT) {
+        file_advise_sequential(fd);
+    }
+    size_t total = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, WRITE_CHUNK * 4)) > 0) {
+        total += n;
+    }
+    if (mode == READ_DROP) {
+        file_drop_cache(fd);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%-22s %10.3f %10.1f %13.0f%%\n", names[mode], elapsed,
+           total / (1024.0 * 1024) / elapsed, cached_ratio(fd, size) * 100);
+    close(fd);
+    free(buf);
+}
+
+// 3. 归档和解压出的文件
+static void run_archive(int count, size_t size) {
+    char **files = calloc(count, sizeof(char *));
+    uint8_t *buf = malloc(WRITE_CHUNK);
+    if (!files || !buf) {
+        free(files);
+        free(buf);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        files[i] = malloc(32);
+        snprintf(files[i], 32, "src%03d.bin", i);
+        int fd = open(files[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        for (size_t off = 0; fd >= 0 && off < size; off += WRITE_CHUNK) {
+            fill_chunk(buf, WRITE_CHUNK, (uint32_t)(i * 131 + off));
+            file_write_all(fd, buf, size - off < WRITE_CHUNK ? size - off : WRITE_CHUNK);
+        }
+        if (fd >= 0) close(fd);
+    }
+
+    ArchiveContext *ctx = archive_context_create();
+    if (ctx) {
+        ctx->compression_level = COMPRESSION_NONE;
+        ctx->drop_cache = 1;
+
+        double start = now_seconds();
+        int ret = archive_create(ctx, "bench.arc", files, count);
+        double create_time = now_seconds() - start;
+
+        start = now_seconds();
+        if (ret == ARCHIVE_OK) {
+            ret = archive_extract(ctx, "bench.arc", "out");
+        }
+        double extract_time = now_seconds() - start;
+
+        long extracted = 0;
+        for (int i = 0; i < count; i++) {
+            char path[64];
+            snprintf(path, sizeof(path), "out/%s", files[i]);
+            long n = count_extents_path(path);
+            extracted += n > 0 ? n : 0;
+        }
+        printf("create %.3fs, archive extents %ld; extract %.3fs, extents per file %.1f %s\n",
+               create_time, count_extents_path("bench.arc"), extract_time,
+               (double)extracted / count, ret == ARCHIVE_OK ? "" : archive_strerror(ret));
+        archive_context_destroy(ctx);
+    }
+
+    for (int i = 0; i < count; i++) {
+        unlink(files[i]);
+        free(files[i]);
+    }
+    free(files);
+    free(buf);
+    if (system("rm -rf out bench.arc") != 0) {
+        fprintf(stderr, "Failed to clean up\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 8;
+    int mb = argc > 2 ? atoi(argv[2]) : 32;
+    const char *base = argc > 3 ? argv[3] : "/tmp";
+    if (count <= 0 || mb <= 0) {
+        fprintf(stderr, "Usage: %s [files] [MB per file] [dir]\n", argv[0]);
+        return 1;
+    }
+    size_t size = (size_t)mb * 1024 * 1024;
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/" BENCH_DIR_TEMPLATE, base);
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("%d files x %d MB in %s\n", count, mb, dir);
+
+    printf("\n%-22s %10s %10s %14s\n", "write", "time(s)", "MB/s", "extents/file");
+    run_write(count, size, 0);
+    run_write(count, size, 1);
+
+    // 读取用的源文件，落盘后才能被DONTNEED完全丢弃
+    int fd = open("read.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    uint8_t *buf = malloc(WRITE_CHUNK);
+    if (fd >= 0 && buf) {
+        fill_chunk(buf, WRITE_CHUNK, 3);
+        for (size_t off = 0; off < size * 2; off += WRITE_CHUNK) {
+            file_write_all(fd, buf, WRITE_CHUNK);
+        }
+        fsync(fd);
+    }
+    if (fd >= 0) close(fd);
+    free(buf);
+
+    printf("\n%-22s %10s %10s %14s\n", "read", "time(s)", "MB/s", "cached after");
+    run_read("read.bin", size * 2, READ_DEFAULT);
+    run_read("read.bin", size * 2, READ_SEQUENTIAL);
+    run_read("read.bin", size * 2, READ_DROP);
+    unlink("read.bin");
+
+    printf("\narchive (store, --drop-cache):\n");
+    run_archive(count, size / 4);
+
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+    return 0;
+}
@@ -0,0 +1,441 @@
+// 端到端基准测试套件：生成确定性的合成语料，按压缩级别和线程数依次运行
+// create/list/extract/verify/add/remove，输出机器可读的JSON（MB/s、files/s、峰值RSS、压缩率）
+//
+// 语料（-s 放大文件数和大小）：
+//   tiny    大量0~256字节的小文件（类文本）
+//   mixed   1KB~128KB的文本和二进制记录交替
+//   large   一个可压缩的大文本文件和一个不可压缩的随机文件
+//   sparse  含少量数据段的稀疏文件
+//   extra   add/remove使用的一组中等文件
+//
+// 每个操作在fork出的子进程中执行，峰值RSS取子进程的ru_maxrss，库的输出丢弃到/dev/null。
+// 源文件和归档都在页缓存中（热缓存），结果用于同一台机器上的前后对比。
+//
+// 用法: suite_bench [-s 倍数] [-l 级别列表] [-t 线程数列表] [-S 种子] [-d 目录] [-o 输出JSON]
+// 线程数为1时使用同步I/O、单线程校验；大于1时使用线程池I/O后端，校验使用对应的线程数
+
+#include "../include/archiver.h"
+#include "../include/io_engine.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BENCH_DIR_TEMPLATE "suite_bench.XXXXXX"
+#define MAX_CONFIGS 16
+#define ARCHIVE_NAME "bench.arc"
+
+// 一组语料文件
+typedef struct {
+    const char *name;
+    char **files;
+    int count;
+    uint64_t bytes;        // 逻辑大小之和（稀疏文件按表观大小）
+} FileSet;
+
+typedef enum { OP_CREATE, OP_LIST, OP_EXTRACT, OP_VERIFY, OP_ADD, OP_REMOVE, OP_COUNT } BenchOp;
+
+static const char *op_names[OP_COUNT] = { "create", "list", "extract", "verify", "add", "remove" };
+
+static uint64_t rng_state;
+
+// xorshift64*：语料只取决于种子
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 类日志文本
+static void fill_text(uint8_t *buf, size_t size) {
+    static const char *words[] = {
+        "INFO ", "WARN ", "request ", "user=", "id=", "status=200 ", "latency_ms=",
+        "GET /api/v1/items ", "POST /login ", "\n", "cache hit ", "cache miss ",
+    };
+    size_t pos = 0;
+    while (pos < size) {
+        uint64_t r = next_random();
+        const char *w = words[r % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(w);
+        if (n > size - pos) n = size - pos;
+        memcpy(buf + pos, w, n);
+        pos += n;
+        if (pos < size && (r & 0x300) == 0) {
+            buf[pos++] = (uint8_t)('0' + (r >> 16) % 10);
+        }
+    }
+}
+
+// 二进制记录：计数器、少量随机字节和填充零，压缩率介于文本和随机数据之间
+static void fill_binary(uint8_t *buf, size_t size) {
+    uint32_t counter = (uint32_t)next_random();
+    for (size_t pos = 0; pos < size; pos += 16) {
+        uint8_t record[16] = {0};
+        uint64_t r = next_random();
+        memcpy(record, &counter, 4);
+        memcpy(record + 4, &r, 4);
+        counter++;
+        memcpy(buf + pos, record, size - pos < 16 ? size - pos : 16);
+    }
+}
+
+static void fill_random(uint8_t *buf, size_t size) {
+    for (size_t pos = 0; pos < size; pos += 8) {
+        uint64_t r = next_random();
+        memcpy(buf + pos, &r, size - pos < 8 ? size - pos : 8);
+    }
+}
+
+static int add_file(FileSet *set, const char *path, uint64_t size) {
+    char **files = realloc(set->files, sizeof(char *) * (set->count + 1));
+    if (!files) return 0;
+    set->files = files;
+    set->files[set->count] = strdup(path);
+    if (!set->files[set->count]) return 0;
+    set->count++;
+    set->bytes += size;
+    return 1;
+}
+
+// 写一个文件；kind: 0文本 1二进制 2随机
+static int write_file(FileSet *set, const char *path, size_t size, int kind, uint8_t *buf) {
+    switch (kind) {
+        case 0: fill_text(buf, size); break;
+        case 1: fill_binary(buf, size); break;
+        default: fill_random(buf, size); break;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return 0;
+    int ok = fwrite(buf, 1, size, fp) == size;
+    ok &= fclose(fp) == 0;
+    return ok && add_file(set, path, size);
+}
+
+// 稀疏文件：表观大小size，runs段数据均匀分布，其余为空洞
+static int write_sparse(FileSet *set, const char *path, uint64_t size, int runs, size_t run_size,
+                        uint8_t *buf) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    int ok = ftruncate(fd, size) == 0;
+    for (int i = 0; ok && i < runs; i++) {
+        uint64_t offset = size / runs * i + (next_random() % (size / runs - run_size)) / 4096 * 4096;
+        fill_binary(buf, run_size);
+        ok = pwrite(fd, buf, run_size, offset) == (ssize_t)run_size;
+    }
+    ok &= close(fd) == 0;
+    return ok && add_file(set, path, size);
+}
+
+// 生成语料；sets[0..3]为归档内容，extra为add/remove使用的文件
+static int make_corpus(int scale, FileSet *sets, FileSet *extra) {
+    size_t large = (size_t)32 * 1024 * 1024 * scale;
+    uint8_t *buf = malloc(large);
+    if (!buf) return 0;
+    int ok = mkdir("corpus", 0755) == 0 && mkdir("corpus/tiny", 0755) == 0 &&
+             mkdir("corpus/mixed", 0755) == 0 && mkdir("corpus/large", 0755) == 0 &&
+             mkdir("corpus/sparse", 0755) == 0 && mkdir("extra", 0755) == 0;
+    char path[PATH_MAX];
+
+    sets[0].name = "tiny";
+    for (int i = 0; ok && i < 5000 * scale; i++) {
+        snprintf(path, sizeof(path), "corpus/tiny/t%06d.txt", i);
+        ok = write_file(&sets[0], path, next_random() % 257, 0, buf);
+    }
+    sets[1].name = "mixed";
+    for (int i = 0; ok && i < 500 * scale; i++) {
+        snprintf(path, sizeof(path), "corpus/mixed/m%05d.%s", i, i % 2 ? "bin" : "txt");
+        ok = write_file(&sets[1], path, 1024 + next_random() % (127 * 1024), i % 2, buf);
+    }
+    sets[2].name = "large";
+    ok = ok && write_file(&sets[2], "corpus/large/text.log", large, 0, buf);
+    ok = ok && write_file(&sets[2], "corpus/large/random.bin", large, 2, buf);
+    sets[3].name = "sparse";
+    ok = ok && write_sparse(&sets[3], "corpus/sparse/disk.img", (uint64_t)256 * 1024 * 1024 * scale,
+                            16, 512 * 1024, buf);
+    extra->name = "extra";
+    for (int i = 0; ok && i < 200 * scale; i++) {
+        snprintf(path, sizeof(path), "extra/e%05d.dat", i);
+        ok = write_file(extra, path, 4096 + next_random() % (60 * 1024), i % 3 == 0 ? 2 : 0, buf);
+    }
+
+    free(buf);
+    return ok;
+}
+
+static void free_set(FileSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        free(set->files[i]);
+    }
+    free(set->files);
+}
+
+// 一个测试配置
+typedef struct {
+    int level;
+    int threads;
+} BenchConfig;
+
+static ArchiveContext* make_context(const BenchConfig *cfg) {
+    ArchiveContext *ctx = archive_context_create();
+    if (!ctx) return NULL;
+    ctx->compression_level = cfg->level;
+    ctx->io_backend = cfg->threads > 1 ? IO_BACKEND_THREADS : IO_BACKEND_SYNC;
+    ctx->verify_threads = cfg->threads;
+    ctx->extract_overwrite = 1;
+    return ctx;
+}
+
+// 子进程中执行一个操作，返回ARCHIVE_*
+static int run_op(const BenchConfig *cfg, BenchOp op, char **all, int all_count, FileSet *extra) {
+    ArchiveContext *ctx = make_context(cfg);
+    if (!ctx) return ARCHIVE_ERROR_MEMORY;
+
+    int ret;
+    switch (op) {
+        case OP_CREATE:  ret = archive_create(ctx, ARCHIVE_NAME, all, all_count); break;
+        case OP_LIST:    ret = archive_list(ctx, ARCHIVE_NAME); break;
+        case OP_EXTRACT: ret = archive_extract(ctx, ARCHIVE_NAME, "out"); break;
+        case OP_VERIFY:  ret = archive_verify(ctx, ARCHIVE_NAME); break;
+        case OP_ADD:     ret = archive_add(ctx, ARCHIVE_NAME, extra->files, extra->count); break;
+        default:         ret = archive_remove(ARCHIVE_NAME, extra->files, extra->count); break;
+    }
+    archive_context_destroy(ctx);
+    return ret;
+}
+
+typedef struct {
+    double seconds;
+    long peak_rss_kb;
+    int status;            // 0成功
+} OpResult;
+
+// fork执行，取子进程的耗时和峰值RSS
+static OpResult measure(const BenchConfig *cfg, BenchOp op, char **all, int all_count,
+                        FileSet *extra) {
+    OpResult result = { 0, 0, -1 };
+    fflush(NULL);
+    double start = now_seconds();
+    pid_t pid = fork();
+    if (pid < 0) return result;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+        }
+        _exit(run_op(cfg, op, all, all_count, extra) == ARCHIVE_OK ? 0 : 1);
+    }
+
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) return result;
+    }
+    result.seconds = now_seconds() - start;
+    result.peak_rss_kb = usage.ru_maxrss;
+    result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return result;
+}
+
+static uint64_t file_size_of(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+static void print_rate(FILE *out, const char *key, double amount, double seconds) {
+    if (amount > 0 && seconds > 0) {
+        fprintf(out, "\"%s\": %.3f", key, amount / seconds);
+    } else {
+        fprintf(out, "\"%s\": null", key);
+    }
+}
+
+// 解析逗号分隔的整数列表
+static int parse_list(const char *text, int *values, int max) {
+    int count = 0;
+    while (*text && count < max) {
+        char *end;
+        long v = strtol(text, &end, 10);
+        if (end == text) return 0;
+        values[count++] = (int)v;
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return count;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s scale] [-l levels] [-t threads] [-S seed] [-d dir] [-o file]\n", prog);
+    fprintf(stderr, "  -s N     corpus scale (file counts and sizes, default 1)\n");
+    fprintf(stderr, "  -l LIST  compression levels, e.g. 0,1,6,9 (default)\n");
+    fprintf(stderr, "  -t LIST  thread counts (default 1 and the number of CPUs)\n");
+    fprintf(stderr, "  -S N     corpus seed (default 1)\n");
+    fprintf(stderr, "  -d DIR   directory for the corpus and archives (default /tmp)\n");
+    fprintf(stderr, "  -o FILE  write the JSON report to FILE instead of stdout\n");
+}
+
+int main(int argc, char *argv[]) {
+    int scale = 1;
+    int levels[MAX_CONFIGS] = { 0, 1, 6, 9 };
+    int level_count = 4;
+    int threads[MAX_CONFIGS] = { 1 };
+    int thread_count = 1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 1) {
+        threads[thread_count++] = (int)cpus;
+    }
+    unsigned long long seed = 1;
+    const char *base = "/tmp";
+    const char *output = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:l:t:S:d:o:h")) != -1) {
+        switch (opt) {
+            case 's': scale = atoi(optarg); break;
+            case 'l': level_count = parse_list(optarg, levels, MAX_CONFIGS); break;
+            case 't': thread_count = parse_list(optarg, threads, MAX_CONFIGS); break;
+            case 'S': seed = strtoull(optarg, NULL, 10); break;
+            case 'd': base = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    int valid = scale > 0 && level_count > 0 && thread_count > 0;
+    for (int i = 0; i < level_count; i++) {
+        valid &= levels[i] >= 0 && levels[i] <= 9;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        valid &= threads[i] > 0;
+    }
+    if (!valid) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 输出路径在切换目录前打开
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/" BENCH_DIR_TEMPLATE, base);
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    FileSet sets[4];
+    FileSet extra;
+    memset(sets, 0, sizeof(sets));
+    memset(&extra, 0, sizeof(extra));
+    fprintf(stderr, "Generating corpus (scale %d, seed %llu) in %s\n", scale, seed, dir);
+    if (!make_corpus(scale, sets, &extra)) {
+        fprintf(stderr, "Failed to generate corpus: %s\n", strerror(errno));
+        return 1;
+    }
+
+    // 全部归档内容
+    int all_count = 0;
+    uint64_t all_bytes = 0;
+    for (int s = 0; s < 4; s++) {
+        all_count += sets[s].count;
+        all_bytes += sets[s].bytes;
+    }
+    char **all = malloc(sizeof(char *) * all_count);
+    if (!all) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int s = 0, n = 0; s < 4; s++) {
+        memcpy(all + n, sets[s].files, sizeof(char *) * sets[s].count);
+        n += sets[s].count;
+    }
+
+    fprintf(out, "{\n  \"benchmark\": \"suite\",\n");
+    fprintf(out, "  \"corpus\": {\"scale\": %d, \"seed\": %llu, \"files\": %d, \"bytes\": %llu, \"sets\": [",
+            scale, seed, all_count, (unsigned long long)all_bytes);
+    for (int s = 0; s < 4; s++) {
+        fprintf(out, "%s{\"name\": \"%s\", \"files\": %d, \"bytes\": %llu}", s ? ", " : "",
+                sets[s].name, sets[s].count, (unsigned long long)sets[s].bytes);
+    }
+    fprintf(out, "], \"extra\": {\"files\": %d, \"bytes\": %llu}},\n", extra.count,
+            (unsigned long long)extra.bytes);
+    fprintf(out, "  \"cpus\": %ld,\n  \"results\": [\n", cpus);
+
+    int failures = 0;
+    int first = 1;
+    for (int l = 0; l < level_count; l++) {
+        for (int t = 0; t < thread_count; t++) {
+            BenchConfig cfg = { levels[l], threads[t] };
+            unlink(ARCHIVE_NAME);
+            for (int op = 0; op < OP_COUNT; op++) {
+                OpResult r = measure(&cfg, op, all, all_count, &extra);
+                uint64_t archive_bytes = file_size_of(ARCHIVE_NAME);
+
+                // 每个操作处理的数据量：list只读索引；remove重写剩余的全部成员
+                int files = op == OP_ADD || op == OP_REMOVE ? extra.count : all_count;
+                uint64_t bytes = op == OP_LIST ? 0 : op == OP_ADD ? extra.bytes :
+                                 op == OP_REMOVE ? archive_bytes : all_bytes;
+                uint64_t content = op == OP_ADD ? all_bytes + extra.bytes : all_bytes;
+
+                fprintf(out, "%s    {\"op\": \"%s\", \"level\": %d, \"threads\": %d, "
+                        "\"status\": %d, \"seconds\": %.6f, \"files\": %d, \"bytes\": %llu, ",
+                        first ? "" : ",\n", op_names[op], cfg.level, cfg.threads,
+                        r.status, r.seconds, files, (unsigned long long)bytes);
+                print_rate(out, "mb_per_s", bytes / (1024.0 * 1024), r.seconds);
+                fprintf(out, ", ");
+                print_rate(out, "files_per_s", files, r.seconds);
+                fprintf(out, ", \"peak_rss_kb\": %ld, \"archive_bytes\": %llu, \"ratio\": %.4f}",
+                        r.peak_rss_kb, (unsigned long long)archive_bytes,
+                        content ? (double)archive_bytes / content : 0.0);
+                first = 0;
+
+                fprintf(stderr, "level %d threads %2d %-8s %8.3fs %8ld KB%s\n", cfg.level,
+                        cfg.threads, op_names[op], r.seconds, r.peak_rss_kb,
+                        r.status == 0 ? "" : "  FAILED");
+                if (r.status != 0) failures++;
+                if (op == OP_EXTRACT && system("rm -rf out") != 0) {
+                    fprintf(stderr, "Failed to remove extracted files\n");
+                }
+            }
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (output) {
+        fclose(out);
+    }
+
+    free(all);
+    for (int s = 0; s < 4; s++) {
+        free_set(&sets[s]);
+    }
+    free_set(&extra);
+    if (chdir("/") == 0) {
+        char cmd[PATH_MAX + 16];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+        if (system(cmd) != 0) {
+            fprintf(stderr, "Failed to remove %s\n", dir);
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef ARCHIVE_WRITER_H
+#define ARCHIVE_WRITER_H
+
+#include "buffer.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 默认写缓冲区大小（MB级，减少write系统调用次数）
+#define ARCHIVE_WRITER_BUFFER_SIZE (4 * 1024 * 1024)
+// 缓冲区地址和O_DIRECT写入的对齐粒度
+#define ARCHIVE_WRITER_ALIGN 4096
+
+// 打开标志
+#define ARCHIVE_WRITER_DIRECT 0x01   // 尝试O_DIRECT，大量顺序写入不污染页缓存
+
+// 顺序写入的归档输出：数据先进入对齐的大缓冲区，满了再整块write；
+// 已写出区域（如归档头）用pwrite回填
+typedef struct {
+    int fd;
+    MemoryBuffer *buf;        // 页对齐的缓冲区
+    int owns_buffer;          // 缓冲区是否由写入器分配
+    uint64_t flushed;         // 已写入fd的字节数，缓冲区内容从这个偏移开始
+    int direct;               // 当前是否使用O_DIRECT
+    int error;                // 第一次失败时的errno
+    int owns_fd;              // 关闭写入器时是否关闭fd
+    uint64_t reserved;        // 已用fallocate预分配到的大小，关闭时截断到实际大小
+} ArchiveWriter;
+
+// 创建页对齐的缓冲区（容量向上取整到ARCHIVE_WRITER_ALIGN），可用destroy_buffer释放
+ MemoryBuffer* archive_writer_buffer_create(size_t size);
+
+// 创建并截断path；buffer为NULL时自行分配，否则借用（必须页对齐）
+// O_DIRECT不可用时（如tmpfs）自动退回普通写入
+ ArchiveWriter* archive_writer_open(const char *path, MemoryBuffer *buffer, int flags);
+
+// 包装已打开的fd（如stdout管道），只追加写入，关闭写入器时不关闭fd
+ ArchiveWriter* archive_writer_attach(int fd, MemoryBuffer *buffer);
+
+// 追加写入
+ int archive_writer_write(ArchiveWriter *writer, const void *data, size_t size);
+
+// 当前逻辑写入位置（已写出 + 缓冲中）
+ uint64_t archive_writer_tell(const ArchiveWriter *writer);
+
+// 回填已写入区域（缓冲中的部分直接修改缓冲区，已写出的部分用pwrite）
+ int archive_writer_pwrite(ArchiveWriter *writer, const void *data, size_t size, uint64_t offset);
+
+// 按估计的最终大小预分配归档文件空间（只对写入器自己打开的文件有效），
+// 减少逐次追加造成的碎片；多预分配的部分在关闭时截掉。
+// 只是提示：空间不足（ENOSPC/EFBIG/EDQUOT）时不预分配，也不记为写入错误
+ void archive_writer_reserve(ArchiveWriter *writer, uint64_t size);
+
+// 写出缓冲区中的全部数据
+ int archive_writer_flush(ArchiveWriter *writer);
+
+// 写出剩余数据并关闭；返回1表示全部写入成功
+ int archive_writer_close(ArchiveWriter *writer);
+
+#endif // ARCHIVE_WRITER_H
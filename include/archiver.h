@@ -3,6 +3,13 @@
 
 #include "buffer.h"
 #include "file_ops.h"
+#include "io_engine.h"
+#include "archive_writer.h"
+#include "output_sink.h"
+#include "dir_cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "progress.h"
 
 #include<stdio.h>
 #include<stdlib.h>
@@ -25,7 +32,9 @@
 
 
 // 归档文件格式版本
-#define ARCHIVE_FORMAT_VERSION 0x0100  // 1.0
+#define ARCHIVE_FORMAT_VERSION 0x0101  // 1.1：条目表和块表位于归档末尾
+#define ARCHIVE_FORMAT_V1_0    0x0100  // 1.0：条目头与数据交错存放
+#define ARCHIVE_MAGIC          0x48435241  // "ARCH"
 
 // 文件头标志位
 #define FLAG_COMPRESSED    0x01  // 文件已压缩
@@ -33,6 +42,37 @@
 #define FLAG_DIRECTORY     0x04  // 目录
 #define FLAG_SYMLINK       0x08  // 符号链接
 #define FLAG_MODIFIED      0x10  // 文件已修改
+#define FLAG_SOLID         0x20  // 数据位于共享的固实块中
+#define FLAG_DICT          0x40  // 使用归档内的预置字典压缩
+#define FLAG_CHUNKED       0x80  // 数据分块独立压缩，块表位于数据之后，可随机读取
+#define FLAG_STORED_CRC    0x100 // 记录了存储数据（压缩、加密后）的CRC32，可不解码快速校验
+#define FLAG_SPARSE        0x200 // 稀疏文件（总是分块存储）：块表中带此标志的块是空洞，不占存储
+#define FLAG_HARDLINK      0x400 // 硬链接：与之前的某个条目共享数据（数据引用字段相同），自身不占存储
+
+// 分块存储：大文件按块独立压缩，随机读取只需解码所在的块
+#define MEMBER_CHUNK_SIZE  (256 * 1024)
+
+// 条目大小和归档内的偏移都是32位：成员和整个归档都不能超过4 GiB - 1
+#define ARCHIVE_SIZE_MAX   UINT32_MAX
+
+// 归档标志位（ArchiveHeader.flags）
+#define ARCHIVE_FLAG_STREAM 0x01  // 只能顺序读写的流格式（条目自描述，没有条目表）
+#define ARCHIVE_FLAG_HARDLINKS 0x02 // 含有FLAG_HARDLINK条目
+
+// 流模式
+#define ARCHIVE_STREAM_NAME "-"             // 归档名为"-"时写stdout/读stdin
+#define STREAM_CHUNK_SIZE   (1024 * 1024)   // 每个数据块的最大原始大小
+
+// 固实模式
+#define SOLID_DEFAULT_BLOCK_SIZE (4 * 1024 * 1024)  // 默认固实块大小
+#define SOLID_MEMBER_MAX         (256 * 1024)       // 超过该大小的文件单独存储
+#define SOLID_BLOCK_MEMBERS_MAX  UINT16_MAX         // 每块最多文件数（BlockEntry.member_count为16位）
+
+// 字典模式
+#define DICT_DEFAULT_SIZE  DICT_MAX_SIZE        // 默认字典大小
+#define DICT_MEMBER_MAX    (64 * 1024)          // 超过该大小的文件不使用字典
+#define DICT_SAMPLE_MAX    (16 * 1024)          // 每个样本文件最多读取的字节数
+#define DICT_SAMPLE_TOTAL  (4 * 1024 * 1024)    // 训练样本总量上限
 
  extern int quiet;
  extern int progress;
@@ -71,7 +111,20 @@ typedef struct {
     uint32_t archive_size; // 归档文件大小
     time_t create_time;    // 创建时间
     uint32_t flags;        // 归档标志
-    uint8_t reserved[64];  // 保留字段
+    uint32_t index_offset; // 条目表偏移（1.1起）
+    uint32_t block_offset; // 固实块表偏移（1.1起）
+    uint32_t block_count;  // 固实块数量
+    uint32_t block_size;   // 固实块大小（0表示未使用固实模式）
+    uint32_t dict_offset;  // 预置字典偏移（0表示没有字典）
+    uint32_t dict_stored_size; // 字典存储大小
+    uint32_t dict_size;    // 字典原始大小
+    uint32_t dict_flags;   // 字典存储标志（FLAG_ENCRYPTED）
+    uint32_t page_dir_offset;   // 条目表页目录偏移（0表示没有，按固定页大小计算）
+    uint32_t page_entries;      // 每页条目数
+    uint32_t name_index_offset; // 文件名哈希索引偏移（0表示没有）
+    uint32_t name_index_slots;  // 哈希索引槽数（2的幂）
+    uint32_t dict_stored_crc32; // 字典存储数据的CRC32（dict_flags含FLAG_STORED_CRC时有效）
+    uint8_t reserved[12];  // 保留字段
 } ArchiveHeader;
 
 // 文件条目设计
@@ -85,22 +138,122 @@ typedef struct {
     uint16_t mode;         // 文件权限
     uint16_t flags;        // 文件标志
     uint32_t crc32;        // CRC32校验和
-    uint8_t reserved[32];  // 保留字段
+    uint32_t block_index;  // 所在固实块（FLAG_SOLID）
+    uint32_t block_offset; // 在固实块内的偏移（FLAG_SOLID）
+    uint32_t chunk_size;   // 每块原始大小（FLAG_CHUNKED）
+    uint32_t chunk_count;  // 块数（FLAG_CHUNKED）
+    uint32_t stored_crc32; // 存储数据的CRC32，分块存储时包括块表（FLAG_STORED_CRC）
+    uint8_t reserved[12];  // 保留字段
 } FileEntry;
 
+// 分块存储的块表项（块表位于条目数据区末尾）
+typedef struct {
+    uint32_t offset;       // 相对条目数据区开头的偏移
+    uint32_t stored_size;  // 存储大小
+    uint32_t crc32;        // 块原始数据的CRC32
+    uint16_t flags;        // FLAG_COMPRESSED / FLAG_ENCRYPTED / FLAG_SPARSE（空洞，全零）
+    uint16_t reserved;
+} ChunkEntry;
+
+// 固实块描述（块表项）
+typedef struct {
+    uint32_t offset;       // 在归档中的偏移量
+    uint32_t stored_size;  // 存储大小
+    uint32_t raw_size;     // 解压后大小
+    uint32_t crc32;        // 解压后数据的CRC32
+    uint16_t flags;        // FLAG_COMPRESSED / FLAG_ENCRYPTED / FLAG_STORED_CRC
+    uint16_t member_count; // 块内文件数
+    uint32_t stored_crc32; // 存储数据的CRC32（FLAG_STORED_CRC）
+    uint8_t reserved[8];   // 保留字段
+} BlockEntry;
+
+// 流格式：每个成员为FileEntry + 若干数据块 + 结束块（stored_size为0）+ StreamTrailer，
+// 最后以文件名为空的FileEntry结束
+typedef struct {
+    uint32_t stored_size;  // 块存储大小（0表示成员数据结束）
+    uint32_t raw_size;     // 块原始大小（不超过STREAM_CHUNK_SIZE）
+    uint16_t flags;        // FLAG_COMPRESSED / FLAG_ENCRYPTED
+    uint16_t reserved;
+} StreamChunk;
+
+// 流格式成员尾部：实际大小和CRC在数据之后给出
+typedef struct {
+    uint64_t file_size;    // 原始大小
+    uint32_t crc32;        // 原始数据的CRC32
+    uint32_t chunk_count;  // 数据块数
+    int32_t status;        // 0表示完整，否则为读取源文件时的errno（数据不完整）
+    uint8_t reserved[12];
+} StreamTrailer;
+
+// 条目表分页：读模式按需加载页，只缓存最近使用的几页
+#define ENTRY_PAGE_ENTRIES 1024   // 每页条目数
+#define ENTRY_CACHE_PAGES  8      // 缓存的页数
+
+// 页目录项（条目表之后），打开归档时只读取页目录
+typedef struct {
+    uint32_t offset;       // 页在归档中的偏移
+    uint32_t count;        // 页内条目数
+    uint32_t crc32;        // 页内容的CRC32
+    uint32_t reserved;
+} EntryPageInfo;
+
+// 文件名哈希索引槽（开放寻址），按名称查找只需读取少量槽和一个条目
+typedef struct {
+    uint32_t hash;         // 文件名哈希
+    uint32_t entry;        // 条目序号 + 1（0表示空槽）
+} NameIndexSlot;
+
+// 缓存的条目页
+typedef struct {
+    uint32_t page;         // 页序号
+    uint32_t count;        // 有效条目数（0表示空闲）
+    uint64_t last_used;    // LRU时间戳
+    FileEntry *entries;
+} EntryPage;
+
+// 共享数据的条目查找表的槽（键为inode，或条目的数据位置）
+typedef struct {
+    uint64_t key_a;
+    uint64_t key_b;
+    uint32_t entry;        // 条目序号 + 1（0表示空槽）
+} LinkSlot;
+
 // 内部数据结构
 typedef struct {
     ArchiveHeader header;
-    FileEntry *entries;
+    FileEntry *entries;        // 写模式和1.0格式：全部条目；1.1读模式为NULL，按页加载
+    EntryPageInfo *page_dir;   // 读模式：条目表页目录
+    uint32_t page_count;
+    EntryPage *page_cache;     // 读模式：最近使用的条目页
+    uint64_t page_clock;
+    uint32_t entry_capacity;   // 写模式：条目表容量
+    BlockEntry *blocks;
+    uint32_t block_capacity;   // 写模式：块表容量
+    MemoryBuffer *solid;       // 写模式：正在填充的固实块
+    uint32_t solid_members;    // 写模式：当前固实块内的文件数
+    int solid_level;           // 写模式：固实块压缩级别
+    char *solid_password;      // 写模式：固实块加密密码
+    MemoryBuffer *block_cache; // 读模式：最近解码的固实块
+    uint32_t cached_block;     // 读模式：缓存的块序号
+    uint8_t *dict;             // 预置字典（写模式训练得到，读模式按需加载）
+    uint32_t dict_size;
     FILE *fp;
+    ArchiveWriter *writer;     // 写模式：缓冲输出（此时fp为NULL）
     char *filename;
     int is_modified;
+    LinkSlot *links;           // 共享数据的条目：创建时按inode，复制、解压、校验时按数据位置
+    uint32_t link_count;
+    uint32_t link_capacity;
+    ProgressTracker *progress; // 借用上下文的进度（NULL表示不报告）
+    uint64_t progress_member;  // 当前成员已逐块报告的字节数
 } ArchiveFile;
 
 
 
 
-// 核心接口
+// 核心接口（回调参数用到ArchiveContext，先声明）
+typedef struct ArchiveContext ArchiveContext;
+
 typedef struct {
     // 归档操作
     int (*create)(ArchiveContext *ctx,const char *archive, char **files, int count);
@@ -126,21 +279,37 @@ typedef struct {
 } ArchiveAPI;
 
 // 扩展ArchiveContext
-typedef struct {
+struct ArchiveContext {
     CompressionLevel compression_level;
     char *password;
-   // ProgressCallback progress_callback;
+    ProgressCallback progress_callback;  // 结构化进度回调（NULL时退回api->progress_callback）
+    void *progress_user;
+    unsigned progress_rate;     // 每秒最多回调次数（0表示PROGRESS_DEFAULT_RATE）
+    ProgressTracker *progress;  // 进行中的操作的进度（内部使用）
   //  ErrorCallback error_callback;
     FILE *log_file;
     ArchiveFile *current_archive;
-    MemoryBuffer *write_buffer;
+    MemoryBuffer *write_buffer;  // create使用的页对齐写缓冲区（首次create时分配）
 
     int recursive;  // 是否递归添加目录
     char **exclude_patterns;  // 排除模式
     int exclude_count;
+    char **include_patterns;  // 解压时只处理匹配的成员（路径或glob）
+    int include_count;
+    IoBackend io_backend;     // I/O后端（默认同步）
+    unsigned io_depth;        // 异步I/O队列深度
+    uint32_t solid_block_size; // 固实块大小（0表示不使用固实模式）
+    uint32_t dict_size;       // 训练字典大小（0表示不使用字典模式）
+    int direct_io;            // 归档输出使用O_DIRECT
+    int drop_cache;           // create读完源文件后丢弃其页缓存（备份不挤占其他程序的缓存）
+    unsigned verify_threads;  // 校验线程数（0表示按CPU数）
+    int verify_fail_fast;     // 校验遇到第一个错误即停止
+    int extract_overwrite;    // 解压时总是重写（否则跳过与条目一致的已有文件）
+    int extract_checksum;     // 大小和mtime一致时再比较内容的CRC32
+    uint32_t extract_skipped; // 上次解压跳过的一致文件数
     ArchiveAPI *api; // 指向API结构体的指针
     
-} ArchiveContext;
+};
 // 初始化函数
 ArchiveAPI* archive_init(void);
 int archive_cleanup(ArchiveAPI *api);
@@ -150,6 +319,15 @@ int archive_context_destroy(ArchiveContext *ctx);
 
 // 工具函数
 const char* archive_strerror(int error_code);
+// 设置解压的成员选择（复制patterns；count为0时恢复为全部解压）
+int archive_set_include_patterns(ArchiveContext *ctx, char **patterns, int count);
+// 设置结构化进度回调：按字节统计，每秒最多max_per_second次（0为默认），可能在工作线程中调用
+int archive_set_progress_callback(ArchiveContext *ctx, ProgressCallback callback, void *user,
+                                  unsigned max_per_second);
+// 成员是否被选中；matched非NULL时记录命中的模式
+int archive_member_selected(const ArchiveContext *ctx, const char *name, uint8_t *matched);
+// 报告没有命中任何成员的模式，返回其个数
+int archive_report_unmatched(const ArchiveContext *ctx, const uint8_t *matched);
 int archive_get_file_count(const char *archive);
 
 
@@ -161,20 +339,52 @@ void error_callback(const char *message);
 
 // 打开归档文件（内部使用）
  ArchiveFile* open_archive_file(const char *filename, const char *mode);
-// 关闭归档文件
- void close_archive_file(ArchiveFile *af);
+// 打开归档文件；写模式通过ArchiveWriter输出，可借用对齐的write_buffer
+ ArchiveFile* open_archive_file_ex(const char *filename, const char *mode,
+                                   MemoryBuffer *write_buffer, int writer_flags);
+// 关闭归档文件；写模式下返回0表示有数据没能写入
+ int close_archive_file(ArchiveFile *af);
+// 向条目表追加条目（写模式）
+ int archive_append_entry(ArchiveFile *af, const FileEntry *entry);
+// 启用固实模式（写模式）
+ int archive_enable_solid(ArchiveFile *af, uint32_t block_size, int level, const char *password);
+// 把当前固实块压缩写出（写模式）
+ int archive_flush_solid(ArchiveFile *af);
+// 写入预置字典，之后的小文件用它压缩（写模式）
+ int archive_set_dictionary(ArchiveFile *af, const uint8_t *dict, size_t dict_size, const char *password);
 // 实际的create函数实现
  int archive_create(ArchiveContext *ctx, const char *archive, char **files, int count);
+// 以流格式把文件写入已打开的fd（如stdout）
+ int archive_create_stream(ArchiveContext *ctx, int out_fd, char **files, int count);
+// 从流格式归档顺序解压（in已定位在归档开头）
+ int archive_extract_stream(ArchiveContext *ctx, FILE *in, const char *dest);
+// 从流格式归档把选中的成员依次写入同一个输出端
+ int archive_extract_stream_to_sink(ArchiveContext *ctx, FILE *in, OutputSink *sink);
+// 顺序扫描流格式归档并列出成员
+ int archive_list_stream(ArchiveContext *ctx, FILE *in, const char *name);
+// 顺序解码流格式归档并校验每个成员的CRC32
+ int archive_verify_stream(ArchiveContext *ctx, FILE *in, const char *name);
+// 只检查流格式归档的结构（块头和成员尾部），跳过数据
+ int archive_test_stream(FILE *in);
+// 打开流格式归档："-"为stdin，普通文件只有头部带ARCHIVE_FLAG_STREAM时才返回
+ FILE* archive_stream_open(const char *archive);
+// 关闭archive_stream_open打开的归档（不关闭stdin）
+ void archive_stream_close(FILE *fp);
 // 实际的extract函数实现
  int archive_extract(ArchiveContext *ctx, const char *archive, const char *dest);
+// 把选中的成员依次解压到同一个输出端（如stdout或回调），不创建文件
+ int archive_extract_to_sink(ArchiveContext *ctx, const char *archive, OutputSink *sink);
 // 实际的list函数实现
  int archive_list(ArchiveContext *ctx, const char *archive);
 // 添加文件到现有归档
  int archive_add(ArchiveContext *ctx, const char *archive, char **files, int count);
-// 验证归档完整性
+// 完整校验：多线程逐个成员解密、解压并校验CRC32，大文件逐块解码，不整体读入内存
  int archive_verify(ArchiveContext *ctx, const char *archive);
+// 快速校验：多线程按存储数据的CRC32扫描，不解密、不解压，不需要密码
+ int archive_verify_fast(ArchiveContext *ctx, const char *archive);
  int archive_remove(const char *archive, char **files, int count);
  int archive_update(const char *archive, char **files, int count);
+// 结构测试：只读头部、块表和条目表，检查偏移和大小是否越界、重叠，与条目数线性相关
  int archive_test(const char *archive);
 // 压缩函数
  int compress_data(const uint8_t *input, size_t input_size,
@@ -193,17 +403,95 @@ void error_callback(const char *message);
                         const char *password);
 
 void report_error(ArchiveContext *ctx, const char *message);
-void report_progress(ArchiveContext *ctx, int percentage, const char *filename);
+// 开始报告一次操作的进度（没有回调时ctx->progress为NULL，之后的报告什么也不做）
+void archive_progress_begin(ArchiveContext *ctx, const char *operation,
+                            uint64_t bytes_total, uint64_t members_total);
+// 结束报告（最后回调一次）
+void archive_progress_end(ArchiveContext *ctx);
+// 当前成员内已处理的字节（大文件逐块调用）
+void archive_progress_bytes(ArchiveFile *af, uint64_t bytes, const char *name);
+// 成员处理完：补上未逐块报告的字节，成员数加一
+void archive_progress_member(ArchiveFile *af, uint64_t size, const char *name);
 
 
 uint32_t calculate_crc32(const uint8_t *data, size_t length);
+// 在crc的基础上继续计算CRC32（初值为0）
+uint32_t update_crc32(uint32_t crc, const uint8_t *data, size_t length);
 // 实际写入文件到归档
-int write_file_to_archive(FILE *archive_fp, const char *filename,
+int write_file_to_archive(ArchiveFile *af, const char *filename,
                          CompressionLevel compression_level,
                          const char *password);
-// 从归档读取文件
-
-int read_file_from_archive(FILE *archive_fp, const FileEntry *entry,
-                            const char *dest_path, const char *password);   
+// 从已打开的fd写入文件到归档，out_entry可为NULL
+int write_fd_to_archive(ArchiveFile *af, int fd, const char *filename,
+                        const FileInfo *info,
+                        CompressionLevel compression_level,
+                        const char *password, FileEntry *out_entry);
+// 把已读入内存的文件内容写入归档（不接管file_data）
+int write_buffer_to_archive(ArchiveFile *af, const char *filename,
+                            const FileInfo *info, const uint8_t *file_data,
+                            CompressionLevel compression_level,
+                            const char *password, FileEntry *out_entry);
+// 压缩、加密一段数据；*stored指向raw或*scratch中的结果，*scratch由调用者归还缓冲池
+int encode_data(const uint8_t *raw, size_t raw_size, int level,
+                const uint8_t *dict, size_t dict_size, const char *password,
+                MemoryBuffer **scratch, const uint8_t **stored, size_t *stored_size,
+                uint16_t *flags);
+// 还原一段已读入内存的存储数据（解密、解压），接管stored；*out由调用者归还缓冲池
+int decode_stored_buffer(MemoryBuffer *stored, uint16_t flags, uint32_t raw_size,
+                         const char *name, const char *password,
+                         const uint8_t *dict, size_t dict_size, MemoryBuffer **out);
+// 解压时先写入的临时文件名（与目标同目录，每次调用都不同），缓冲区不够时返回0
+int extract_temp_path(const char *name, char *temp, size_t size);
+// 用写好的临时文件原子地替换目标（都相对dir_fd）；ok为0或rename失败时删除临时文件
+int commit_extract_file(int dir_fd, const char *temp, const char *name, int ok);
+// 读取分块条目的块表（FLAG_CHUNKED），返回值由调用者free
+ChunkEntry* load_chunk_table(ArchiveFile *af, const FileEntry *entry);
+// 解码分块条目中的一块并校验CRC32，*out由调用者归还缓冲池
+int decode_member_chunk(ArchiveFile *af, const FileEntry *entry, const ChunkEntry *chunks,
+                        uint32_t index, const char *password, MemoryBuffer **out);
+// 记录键(key_a, key_b)对应的条目（已有时覆盖）
+int archive_link_add(ArchiveFile *af, uint64_t key_a, uint64_t key_b, uint32_t entry);
+// 查找键对应的条目，找到返回1
+int archive_link_find(const ArchiveFile *af, uint64_t key_a, uint64_t key_b, uint32_t *entry);
+// 释放查找表
+void archive_links_free(ArchiveFile *af);
+// 条目数据位置的键：数据相同的条目（硬链接与其原条目）键相同
+void archive_entry_data_key(const FileEntry *entry, uint64_t *key_a, uint64_t *key_b);
+// 读模式：加载条目表页目录（条目页按需读取）
+int entry_index_open(ArchiveFile *af);
+// 释放页目录和页缓存
+void entry_index_close(ArchiveFile *af);
+// 写模式：在条目表之后写出页目录和文件名哈希索引
+int entry_index_write(ArchiveFile *af);
+// 读取第index个条目（复制到*entry）
+int archive_read_entry(ArchiveFile *af, uint32_t index, FileEntry *entry);
+// 按完整路径查找条目（重名时取最后一个），有哈希索引时不扫描条目表；index可为NULL
+int archive_find_entry(ArchiveFile *af, const char *name, FileEntry *entry, uint32_t *index);
+// 从归档读取并解码文件内容，*out由调用者用buffer_pool_release归还
+int decode_file_from_archive(ArchiveFile *af, const FileEntry *entry,
+                             const char *password, MemoryBuffer **out);
+// 把条目解码后按块写入输出端（分块条目和未编码条目不需要整个文件的缓冲区）
+int write_member_to_sink(ArchiveFile *af, const FileEntry *entry,
+                         const char *password, OutputSink *sink);
+// 从归档读取文件，相对缓存的上级目录fd创建（缺少的目录逐级创建）
+int read_file_from_archive(ArchiveFile *af, const FileEntry *entry,
+                           DirCache *dirs, const char *password);
 int archive_append_files(ArchiveContext *ctx, const char **files, int file_count) ;
+
+// 成员读取句柄：按需解码，分块成员的随机读取只解码涉及的块
+// 同一个句柄不能被多个线程同时使用
+typedef struct ArchiveMember ArchiveMember;
+
+// 打开归档中的成员（按完整路径查找），失败返回NULL
+ArchiveMember* archive_member_open(const char *archive, const char *path, const char *password);
+// 从当前位置读取，返回读到的字节数，0表示到达末尾，-1表示出错（errno）
+ssize_t archive_member_read(ArchiveMember *member, void *buf, size_t size);
+// 从指定偏移读取，不改变当前位置
+ssize_t archive_member_pread(ArchiveMember *member, void *buf, size_t size, uint64_t offset);
+// 移动当前位置（SEEK_SET/SEEK_CUR/SEEK_END），返回新位置，出错返回-1
+int64_t archive_member_seek(ArchiveMember *member, int64_t offset, int whence);
+// 成员原始大小
+uint64_t archive_member_size(const ArchiveMember *member);
+// 关闭句柄
+void archive_member_close(ArchiveMember *member);
 #endif // ARCHIVER_H
\ No newline at end of file
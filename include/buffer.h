@@ -6,19 +6,56 @@
 #include <string.h>
 
 // 内存管理结构
-typedef struct {
+typedef struct MemoryBuffer {
     uint8_t *buffer;
     size_t size;
     size_t capacity;
+    struct MemoryBuffer *next_free;  // 缓冲池内部使用
 } MemoryBuffer;
 
 // 创建内存缓冲区
  MemoryBuffer* create_buffer(size_t initial_capacity);
 
+// 释放内存缓冲区
+ void destroy_buffer(MemoryBuffer *buf);
+
 // 扩展缓冲区
  int expand_buffer(MemoryBuffer *buf, size_t min_capacity);
 
 // 写入数据到缓冲区
  int write_to_buffer(MemoryBuffer *buf, const void *data, size_t size);
 
-#endif
\ No newline at end of file
+// 缓冲池：按2的幂分尺寸类（4KB~64MB），每个线程有自己的缓存，
+// 线程缓存满了再放入共享池。上限只约束空闲缓存的字节数：借出使用中的缓冲区不计入，
+// 峰值内存由调用者同时持有的缓冲区决定（如I/O队列深度、校验线程数）
+#define BUFFER_POOL_MIN_SHIFT     12
+#define BUFFER_POOL_MAX_SHIFT     26
+#define BUFFER_POOL_CLASSES       (BUFFER_POOL_MAX_SHIFT - BUFFER_POOL_MIN_SHIFT + 1)
+#define BUFFER_POOL_THREAD_SLOTS  4                      // 每线程每个尺寸类的缓存数
+#define BUFFER_POOL_DEFAULT_CACHE_LIMIT (256 * 1024 * 1024)  // 空闲缓存字节数上限
+
+typedef struct {
+    uint64_t hits;           // 从缓存取得
+    uint64_t misses;         // 新分配
+    uint64_t releases;       // 归还到缓存
+    uint64_t drops;          // 超出缓存上限或尺寸而直接释放
+    size_t cached_bytes;     // 当前空闲缓存的字节数（不含借出的缓冲区）
+    size_t cache_limit;      // 空闲缓存上限
+} BufferPoolStats;
+
+// 取得容量不小于min_capacity的空缓冲区（size为0）
+ MemoryBuffer* buffer_pool_acquire(size_t min_capacity);
+
+// 归还缓冲区；可以在任意线程归还
+ void buffer_pool_release(MemoryBuffer *buf);
+
+// 设置空闲缓存字节数上限（0表示不缓存）；不限制借出的缓冲区
+ void buffer_pool_set_cache_limit(size_t limit);
+
+// 释放共享池和当前线程缓存中的全部缓冲区
+ void buffer_pool_trim(void);
+
+// 读取统计信息
+ void buffer_pool_get_stats(BufferPoolStats *stats);
+
+#endif
@@ -6,6 +6,8 @@
 #include <string.h> 
 #include <zlib.h>
 
+#include "buffer.h"
+
 // 使用zlib压缩数据
  int compress_data(const uint8_t *input, size_t input_size,
                         uint8_t **output, size_t *output_size,
@@ -14,5 +16,46 @@
  int decompress_data(const uint8_t *input, size_t input_size,
                           uint8_t **output, size_t output_size);
 
+// 预置字典（zlib窗口为32KB，更长的字典只有末尾部分有效）
+#define DICT_MAX_SIZE     (32 * 1024)
+
+// 使用预置字典压缩（deflateSetDictionary）
+ int compress_data_dict(const uint8_t *input, size_t input_size,
+                        uint8_t **output, size_t *output_size,
+                        int compression_level,
+                        const uint8_t *dict, size_t dict_size);
+// 使用预置字典解压（inflateSetDictionary）
+ int decompress_data_dict(const uint8_t *input, size_t input_size,
+                          uint8_t **output, size_t output_size,
+                          const uint8_t *dict, size_t dict_size);
+// 长期复用的zlib流（deflate/inflate状态约256KB，只初始化一次，之后Reset复用）
+// 同一个上下文不能被多个线程同时使用
+typedef struct CodecContext CodecContext;
+
+// 创建/销毁上下文
+ CodecContext* codec_context_create(void);
+ void codec_context_destroy(CodecContext *codec);
+// 当前线程的上下文（首次调用时创建，线程退出时释放）
+ CodecContext* codec_thread_context(void);
+
+// 使用指定上下文压缩/解压，语义同compress_to_buffer/decompress_to_buffer
+ int codec_compress(CodecContext *codec, const uint8_t *input, size_t input_size,
+                    MemoryBuffer *out, int compression_level,
+                    const uint8_t *dict, size_t dict_size);
+ int codec_decompress(CodecContext *codec, const uint8_t *input, size_t input_size,
+                      MemoryBuffer *out, size_t output_size,
+                      const uint8_t *dict, size_t dict_size);
+
+// 压缩到缓冲区（out->size为压缩后大小），dict为NULL时不使用字典；使用当前线程的上下文
+ int compress_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                        int compression_level, const uint8_t *dict, size_t dict_size);
+// 解压output_size字节到缓冲区，dict为NULL时不使用字典；使用当前线程的上下文
+ int decompress_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                          size_t output_size, const uint8_t *dict, size_t dict_size);
+// 从样本中训练字典：挑选在多个样本中重复出现的片段，最常用的放在末尾
+ int train_dictionary(const uint8_t *const *samples, const size_t *sample_sizes,
+                      int sample_count, size_t max_size,
+                      uint8_t **dict, size_t *dict_size);
+
 
 #endif // COMPRESS_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <stddef.h>
+
+// 默认缓存的目录fd数
+#define DIR_CACHE_DEFAULT_SIZE 64
+
+typedef struct DirCache DirCache;
+
+// 以root为根创建目录fd缓存（root不存在时创建）；root为NULL或""时使用当前目录
+ DirCache* dir_cache_create(const char *root, unsigned capacity);
+
+// 关闭缓存的全部目录fd
+ void dir_cache_destroy(DirCache *cache);
+
+// 返回相对路径path的上级目录fd（缺少的各级目录逐级创建），*name指向最后一段；
+// 失败返回-1（errno保留）。返回的fd归缓存所有，调用者不得关闭
+ int dir_cache_parent(DirCache *cache, const char *path, const char **name);
+
+// 固定目录fd，固定期间不会被淘汰（异步请求在途时使用）；与dir_cache_unpin成对调用
+ void dir_cache_pin(DirCache *cache, int fd);
+
+ void dir_cache_unpin(DirCache *cache, int fd);
+
+#endif // DIR_CACHE_H
@@ -7,6 +7,8 @@
 #include <openssl/aes.h>
 #include <openssl/sha.h>
 
+#include "buffer.h"
+
 // AES加密（简单实现）
  int encrypt_data(const uint8_t *input, size_t input_size,
                        uint8_t **output, size_t *output_size,
@@ -15,4 +17,10 @@
  int decrypt_data(const uint8_t *input, size_t input_size,
                        uint8_t **output, size_t *output_size,
                        const char *password);
+// 加密到缓冲区（out->size为填充后大小）
+ int encrypt_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                       const char *password);
+// 解密到缓冲区；不去除填充，调用者按已知的原始长度使用
+ int decrypt_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                       const char *password);
 #endif // ENCRYPT_H
\ No newline at end of file
@@ -15,4 +15,56 @@
 #include <utime.h>
 #include <stdio.h>
 
-#endif
\ No newline at end of file
+// 文件元数据（打开文件后一次statx取得，直接填入FileEntry）
+typedef struct {
+    uint64_t size;         // 文件大小
+    uint32_t mode;         // 类型和权限
+    time_t mtime;          // 修改时间
+    time_t atime;          // 访问时间
+    uint64_t dev;          // 所在设备和inode（识别硬链接）
+    uint64_t ino;
+    uint32_t nlink;        // 硬链接数
+} FileInfo;
+
+#ifdef STATX_BASIC_STATS
+// FileInfo需要的statx字段
+#define FILE_INFO_STATX_MASK (STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | \
+                              STATX_ATIME | STATX_INO | STATX_NLINK)
+
+// 用statx结果填写FileInfo
+ void file_info_from_statx(FileInfo *info, const struct statx *stx);
+#endif
+
+// 打开文件并获取元数据，成功返回fd，失败返回-1（errno保留）
+ int file_open_info(const char *path, FileInfo *info);
+
+// 从fd读取size字节到buf（处理短读和EINTR）
+ int file_read_all(int fd, uint8_t *buf, size_t size);
+
+// 从fd读取最多size字节，直到读满或遇到EOF（适用于管道）；返回读到的字节数，出错返回-1
+ ssize_t file_read_some(int fd, uint8_t *buf, size_t size);
+
+// 向fd写入size字节（处理短写和EINTR）
+ int file_write_all(int fd, const uint8_t *buf, size_t size);
+
+// 不小于这个大小的输出文件写入前预分配空间（小文件由延迟分配处理即可）
+#define PREALLOC_MIN_SIZE (1024 * 1024)
+
+// 为fd预分配[0, size)的空间，文件大小随之扩展到size；
+// 文件系统不支持fallocate时什么也不做。只有空间不足时返回0
+ int file_preallocate(int fd, uint64_t size);
+
+// 提示内核fd将被顺序读取（加大预读）
+ void file_advise_sequential(int fd);
+
+// 丢弃fd已缓存的干净页，读完的源文件不再占用页缓存
+ void file_drop_cache(int fd);
+
+// 大小为size的文件是否含有空洞（SEEK_HOLE早于文件末尾）；文件位置不变
+ int file_has_holes(int fd, uint64_t size);
+
+// 查找pos处或之后的第一个数据区[*start, *end)；之后没有数据时*start = *end = size。
+// 文件系统不支持SEEK_DATA时整个文件视为一个数据区。文件位置不变，出错返回0
+ int file_data_extent(int fd, uint64_t pos, uint64_t size, uint64_t *start, uint64_t *end);
+
+#endif
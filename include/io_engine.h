@@ -0,0 +1,70 @@
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include "buffer.h"
+#include "file_ops.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 默认队列深度（同时在途的文件数）
+#define IO_ENGINE_DEFAULT_DEPTH 64
+// 读请求整文件读入内存的上限，更大的文件交还fd给调用者同步处理
+#define IO_ENGINE_INLINE_MAX (1024 * 1024)
+
+// I/O后端
+typedef enum {
+    IO_BACKEND_SYNC = 0,      // 不使用引擎，逐个阻塞调用
+    IO_BACKEND_URING = 1,     // io_uring（不可用时退回线程池）
+    IO_BACKEND_THREADS = 2    // 线程池
+} IoBackend;
+
+// 请求类型
+typedef enum {
+    IO_OP_READ_FILE = 0,      // open + statx + read + close
+    IO_OP_WRITE_FILE = 1      // open + write + fchmod + futimens + close
+} IoOpType;
+
+// 异步请求（由调用者分配，完成前不得修改或释放）
+typedef struct IoRequest {
+    IoOpType op;
+    const char *path;
+    int dir_fd;               // 写：path相对的目录fd（0表示相对当前目录）
+    FileInfo info;            // 读：statx结果；写：mode/atime/mtime
+    uint8_t *data;            // 读：指向buffer的内容；写：调用者提供
+    MemoryBuffer *buffer;     // 读：引擎从缓冲池取得，调用者用buffer_pool_release归还
+    size_t size;              // 读：实际读取字节数；写：要写入的字节数
+    int fd;                   // 读：文件超过INLINE_MAX或非普通文件时返回打开的fd，data为NULL
+    int drop_cache;           // 读：读完后丢弃文件的页缓存（POSIX_FADV_DONTNEED）
+    int result;               // 1成功，0失败
+    int error;                // 失败时的errno
+    int done;                 // 被reap后置1
+    void *user;               // 调用者私有数据
+    struct IoRequest *next;   // 内部使用
+    void *owner;              // 内部使用
+} IoRequest;
+
+typedef struct IoEngine IoEngine;
+
+// 创建引擎；IO_BACKEND_SYNC返回NULL
+ IoEngine* io_engine_create(IoBackend backend, unsigned depth);
+
+// 实际使用的后端
+ IoBackend io_engine_backend(const IoEngine *engine);
+
+// 提交请求；队列满时先处理完成事件腾出位置
+ int io_engine_submit(IoEngine *engine, IoRequest *req);
+
+// 取回一个已完成的请求（必要时阻塞）；没有在途请求时返回NULL
+ IoRequest* io_engine_reap(IoEngine *engine);
+
+// 在途请求数
+ unsigned io_engine_inflight(const IoEngine *engine);
+
+// 销毁引擎（会等待在途请求完成）
+ void io_engine_destroy(IoEngine *engine);
+
+// 后端名称
+ const char* io_backend_name(IoBackend backend);
+
+#endif // IO_ENGINE_H
@@ -0,0 +1,51 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// 输出端类型
+typedef enum {
+    OUTPUT_SINK_FILE = 0,     // 新建（截断）的文件
+    OUTPUT_SINK_FD = 1,       // 已打开的fd，如stdout或管道
+    OUTPUT_SINK_CALLBACK = 2  // 调用者的回调
+} OutputSinkType;
+
+// 回调输出端：返回1表示成功，0表示中止
+typedef int (*OutputSinkCallback)(void *user, const uint8_t *data, size_t size);
+
+// 解压数据的去向；解码后的数据按块依次写入，不经过临时文件
+typedef struct {
+    OutputSinkType type;
+    int fd;                       // FILE/FD
+    int owns_fd;                  // 关闭输出端时是否关闭fd
+    OutputSinkCallback callback;  // CALLBACK
+    void *user;
+    uint64_t written;             // 已写入字节数（包括空洞）
+    int holes;                    // FILE：跳过过空洞，关闭时按written确定文件大小
+    int error;                    // 第一次失败时的errno
+} OutputSink;
+
+// 创建并截断path
+ OutputSink* output_sink_file(const char *path, mode_t mode);
+
+// 相对目录fd创建并截断name（dir_fd为AT_FDCWD时同output_sink_file）
+ OutputSink* output_sink_file_at(int dir_fd, const char *name, mode_t mode);
+
+// 包装已打开的fd（不接管，关闭输出端时不关闭）
+ OutputSink* output_sink_fd(int fd);
+
+// 把数据交给回调
+ OutputSink* output_sink_callback(OutputSinkCallback callback, void *user);
+
+// 写入一段数据，返回1表示成功
+ int output_sink_write(OutputSink *sink, const uint8_t *data, size_t size);
+
+// 写入size字节的零：文件输出端上只移动位置留下空洞，其余输出端写入零
+ int output_sink_hole(OutputSink *sink, uint64_t size);
+
+// 关闭输出端；返回1表示全部写入成功
+ int output_sink_close(OutputSink *sink);
+
+#endif // OUTPUT_SINK_H
@@ -0,0 +1,52 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 按字节统计的进度：任意线程用原子操作累加，回调按时间限速（每秒最多N次），
+// 同一时刻只有一个线程调用回调。
+
+// 默认每秒最多回调次数
+#define PROGRESS_DEFAULT_RATE 10
+
+// 回调收到的进度快照
+typedef struct {
+    const char *operation;      // "create"、"extract"等
+    const char *current;        // 触发本次回调的线程正在处理的成员（可能为NULL，只在回调期间有效）
+    uint64_t bytes_done;
+    uint64_t bytes_total;       // 0表示总量未知
+    uint64_t members_done;
+    uint64_t members_total;     // 0表示总数未知
+    double elapsed;             // 已用秒数
+    double bytes_per_second;    // 平滑后的速率
+    double eta;                 // 预计剩余秒数，未知时为-1
+    int percent;                // 0-100，总量未知时为-1
+    int finished;               // 最后一次回调（操作结束）
+} ProgressInfo;
+
+typedef void (*ProgressCallback)(const ProgressInfo *info, void *user);
+
+typedef struct ProgressTracker ProgressTracker;
+
+// 创建进度；max_per_second为0时使用PROGRESS_DEFAULT_RATE
+ ProgressTracker* progress_create(const char *operation, uint64_t bytes_total, uint64_t members_total,
+                                  unsigned max_per_second, ProgressCallback callback, void *user);
+
+// 开始后才知道的总量
+ void progress_add_total(ProgressTracker *progress, uint64_t bytes, uint64_t members);
+
+// 又一个成员的大小已知（创建时打开源文件的statx）。只知道部分成员的大小时，
+// 字节总量按已知成员的平均大小估计，不需要事先把所有源文件stat一遍
+ void progress_add_source(ProgressTracker *progress, uint64_t bytes);
+
+// 累加已处理的字节数和成员数，到了回调时间时回调一次；progress为NULL时什么也不做
+ void progress_update(ProgressTracker *progress, uint64_t bytes, uint64_t members, const char *current);
+
+// 最后回调一次（finished为1）并释放
+ void progress_finish(ProgressTracker *progress);
+
+// 默认的进度显示：在user（FILE*）上原地刷新一行，结束时换行
+ void progress_print(const ProgressInfo *info, void *user);
+
+#endif // PROGRESS_H
@@ -0,0 +1,84 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 分阶段计数：各热点路径记录调用次数、墙钟/CPU时间和字节数。
+// 关闭时只检查一个全局标志；开启时每个线程写自己的计数块，快照时汇总。
+// 开启trace（trace.h）时，同样的计时点还会记录为trace事件。
+
+// 统计的阶段
+typedef enum {
+    STATS_STAT = 0,       // 取源文件元数据（statx/fstat）
+    STATS_READ,           // 读取源文件和归档数据
+    STATS_CHECKSUM,       // CRC32
+    STATS_COMPRESS,
+    STATS_DECOMPRESS,
+    STATS_ENCRYPT,
+    STATS_DECRYPT,
+    STATS_WRITE,          // 写出归档和解压的文件
+    STATS_MKDIR,          // 打开、创建解压目标目录
+    STATS_ALLOC,          // 缓冲区分配（bytes_out为新分配的字节数）
+    STATS_IO_WAIT,        // 等待I/O引擎完成请求（队列空转）
+    STATS_PHASE_COUNT
+} StatsPhase;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;      // 调用线程的CPU时间
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} StatsCounter;
+
+// 阶段开始时的时间点（未开启统计时为0）
+typedef struct {
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+} StatsMark;
+
+extern int stats_enabled;
+
+// 开启/关闭统计（在操作开始前设置）
+ void stats_enable(int enabled);
+
+// 清零全部计数
+ void stats_reset(void);
+
+// 汇总所有线程的计数
+ void stats_snapshot(StatsCounter counters[STATS_PHASE_COUNT]);
+
+ const char* stats_phase_name(StatsPhase phase);
+
+ void stats_mark_now(StatsMark *mark);
+
+// 记录一次调用：从start到现在的时间和处理的字节数
+ void stats_record(StatsPhase phase, const StatsMark *start, uint64_t bytes_in, uint64_t bytes_out);
+
+// 记录一次异步完成的调用（io_uring）：只计次数和字节数。完成事件要等调用者收割，
+// 提交到收割的间隔不是该阶段花费的时间
+ void stats_count(StatsPhase phase, uint64_t bytes_in, uint64_t bytes_out);
+
+// 以表格形式输出一次操作的统计（wall_seconds为整个操作的墙钟时间）
+ void stats_print(FILE *out, const char *operation, double wall_seconds);
+
+// 以JSON输出一次操作的统计
+ int stats_write_json(FILE *out, const char *operation, double wall_seconds);
+
+static inline void stats_begin(StatsMark *mark) {
+    if (stats_enabled) {
+        stats_mark_now(mark);
+    } else {
+        mark->wall_ns = 0;
+    }
+}
+
+static inline void stats_end(StatsPhase phase, const StatsMark *start,
+                             uint64_t bytes_in, uint64_t bytes_out) {
+    if (stats_enabled && start->wall_ns) {
+        stats_record(phase, start, bytes_in, bytes_out);
+    }
+}
+
+#endif // STATS_H
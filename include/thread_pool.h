@@ -0,0 +1,26 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+// 线程池任务函数
+typedef void (*ThreadTask)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+// 创建线程池（threads <= 0 时使用在线CPU数）
+ ThreadPool* thread_pool_create(int threads);
+
+// 提交任务（队列无上限，不会阻塞）
+ int thread_pool_submit(ThreadPool *pool, ThreadTask task, void *arg);
+
+// 等待所有已提交的任务完成
+ void thread_pool_wait(ThreadPool *pool);
+
+// 停止并销毁线程池（会先完成剩余任务）
+ void thread_pool_destroy(ThreadPool *pool);
+
+// 线程池中的线程数
+ int thread_pool_size(const ThreadPool *pool);
+
+#endif // THREAD_POOL_H
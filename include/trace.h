@@ -0,0 +1,31 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Chrome trace格式的事件记录（可在chrome://tracing或Perfetto中打开）。
+// 各阶段的事件来自stats的计时点；每个线程写自己的环形缓冲区，满了覆盖最旧的事件，
+// trace_finish（或进程退出时）统一写出。
+
+// 每个线程的环形缓冲区容量（事件数）
+#define TRACE_RING_EVENTS 65536
+// 事件中记录的成员名最大长度（超长时保留结尾部分）
+#define TRACE_MEMBER_MAX 96
+
+extern int trace_enabled;
+
+// 开启记录，结束时写入path；同时打开stats的计时点。失败返回0
+ int trace_start(const char *path);
+
+// 记录一个阶段事件（时间为CLOCK_MONOTONIC纳秒），成员为当前线程正在处理的成员
+ void trace_record(const char *stage, uint64_t start_ns, uint64_t end_ns);
+
+// 当前线程开始处理成员name；已有成员在处理（嵌套调用）或未开启时返回0，什么也不做。
+// 返回1时调用者处理完要调用trace_member_end，它记录一个覆盖整个成员的"member"事件
+ int trace_member_begin(const char *name);
+ void trace_member_end(void);
+
+// 写出全部事件并停止记录；未开启时返回1
+ int trace_finish(void);
+
+#endif // TRACE_H
@@ -0,0 +1,240 @@
+#include "../include/archiver.h"
+#include "../include/archive_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 创建页对齐的缓冲区（容量向上取整到ARCHIVE_WRITER_ALIGN），可用destroy_buffer释放
+ MemoryBuffer* archive_writer_buffer_create(size_t size) {
+    size = (size + ARCHIVE_WRITER_ALIGN - 1) & ~(size_t)(ARCHIVE_WRITER_ALIGN - 1);
+    if (size == 0) size = ARCHIVE_WRITER_ALIGN;
+    
+    MemoryBuffer *buf = malloc(sizeof(MemoryBuffer));
+    if (!buf) return NULL;
+    
+    void *mem = NULL;
+    if (posix_memalign(&mem, ARCHIVE_WRITER_ALIGN, size) != 0) {
+        free(buf);
+        return NULL;
+    }
+    
+    buf->buffer = mem;
+    buf->size = 0;
+    buf->capacity = size;
+    buf->next_free = NULL;
+    return buf;
+}
+
+// 关闭O_DIRECT（写不对齐的尾部或回填时需要）
+static void writer_drop_direct(ArchiveWriter *writer) {
+    if (!writer->direct) return;
+    int fl = fcntl(writer->fd, F_GETFL);
+    if (fl >= 0) {
+        fcntl(writer->fd, F_SETFL, fl & ~O_DIRECT);
+    }
+    writer->direct = 0;
+}
+
+// 写出缓冲区；O_DIRECT时只写对齐的前缀，余下部分移到缓冲区开头
+static int writer_flush_buffer(ArchiveWriter *writer, int final) {
+    MemoryBuffer *buf = writer->buf;
+    if (final) {
+        writer_drop_direct(writer);
+    }
+    
+    size_t n = buf->size;
+    if (writer->direct) {
+        n &= ~(size_t)(ARCHIVE_WRITER_ALIGN - 1);
+    }
+    if (n == 0) return 1;
+    
+    if (!file_write_all(writer->fd, buf->buffer, n)) {
+        if (!writer->error) writer->error = errno ? errno : EIO;
+        return 0;
+    }
+    
+    memmove(buf->buffer, buf->buffer + n, buf->size - n);
+    buf->size -= n;
+    writer->flushed += n;
+    return 1;
+}
+
+// 创建并截断path；buffer为NULL时自行分配，否则借用（必须页对齐）
+ ArchiveWriter* archive_writer_open(const char *path, MemoryBuffer *buffer, int flags) {
+    ArchiveWriter *writer = calloc(1, sizeof(ArchiveWriter));
+    if (!writer) return NULL;
+    
+    if (buffer && ((uintptr_t)buffer->buffer % ARCHIVE_WRITER_ALIGN != 0 ||
+                   buffer->capacity < ARCHIVE_WRITER_ALIGN)) {
+        // 不满足对齐要求的缓冲区不借用
+        buffer = NULL;
+    }
+    writer->buf = buffer ? buffer : archive_writer_buffer_create(ARCHIVE_WRITER_BUFFER_SIZE);
+    writer->owns_buffer = buffer == NULL;
+    if (!writer->buf) {
+        free(writer);
+        return NULL;
+    }
+    writer->buf->size = 0;
+    
+    int open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    writer->fd = -1;
+    if (flags & ARCHIVE_WRITER_DIRECT) {
+        writer->fd = open(path, open_flags | O_DIRECT, 0644);
+        writer->direct = writer->fd >= 0;
+    }
+    if (writer->fd < 0) {
+        writer->fd = open(path, open_flags, 0644);
+    }
+    if (writer->fd < 0) {
+        if (writer->owns_buffer) destroy_buffer(writer->buf);
+        free(writer);
+        return NULL;
+    }
+    writer->owns_fd = 1;
+    
+    return writer;
+}
+
+// 包装已打开的fd（如stdout管道），只追加写入，关闭写入器时不关闭fd
+ ArchiveWriter* archive_writer_attach(int fd, MemoryBuffer *buffer) {
+    ArchiveWriter *writer = calloc(1, sizeof(ArchiveWriter));
+    if (!writer) return NULL;
+    
+    if (buffer && buffer->capacity < ARCHIVE_WRITER_ALIGN) {
+        buffer = NULL;
+    }
+    writer->buf = buffer ? buffer : archive_writer_buffer_create(ARCHIVE_WRITER_BUFFER_SIZE);
+    writer->owns_buffer = buffer == NULL;
+    if (!writer->buf) {
+        free(writer);
+        return NULL;
+    }
+    writer->buf->size = 0;
+    writer->fd = fd;
+    return writer;
+}
+
+// 追加写入
+ int archive_writer_write(ArchiveWriter *writer, const void *data, size_t size) {
+    const uint8_t *p = data;
+    MemoryBuffer *buf = writer->buf;
+    
+    if (writer->error) return 0;
+    
+    // 缓冲区为空时，大块数据直接写出，省去一次复制
+    if (!writer->direct && buf->size == 0 && size >= buf->capacity) {
+        if (!file_write_all(writer->fd, p, size)) {
+            writer->error = errno ? errno : EIO;
+            return 0;
+        }
+        writer->flushed += size;
+        return 1;
+    }
+    
+    while (size > 0) {
+        size_t space = buf->capacity - buf->size;
+        size_t n = size < space ? size : space;
+        memcpy(buf->buffer + buf->size, p, n);
+        buf->size += n;
+        p += n;
+        size -= n;
+        
+        if (buf->size == buf->capacity && !writer_flush_buffer(writer, 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 当前逻辑写入位置（已写出 + 缓冲中）
+ uint64_t archive_writer_tell(const ArchiveWriter *writer) {
+    return writer->flushed + writer->buf->size;
+}
+
+// 回填已写入区域（缓冲中的部分直接修改缓冲区，已写出的部分用pwrite）
+ int archive_writer_pwrite(ArchiveWriter *writer, const void *data, size_t size, uint64_t offset) {
+    const uint8_t *p = data;
+    
+    if (offset + size > archive_writer_tell(writer)) {
+        writer->error = EINVAL;
+        return 0;
+    }
+    
+    // 已写出的部分
+    if (offset < writer->flushed) {
+        size_t n = offset + size <= writer->flushed ? size : (size_t)(writer->flushed - offset);
+        writer_drop_direct(writer);
+        
+        StatsMark mark;
+        stats_begin(&mark);
+        size_t done = 0;
+        while (done < n) {
+            ssize_t w = pwrite(writer->fd, p + done, n - done, offset + done);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                writer->error = errno;
+                return 0;
+            }
+            done += w;
+        }
+        stats_end(STATS_WRITE, &mark, n, n);
+        p += n;
+        offset += n;
+        size -= n;
+    }
+    
+    // 仍在缓冲区中的部分
+    if (size > 0) {
+        memcpy(writer->buf->buffer + (offset - writer->flushed), p, size);
+    }
+    return 1;
+}
+
+// 按估计的最终大小预分配归档文件空间（只对写入器自己打开的文件有效），
+// 减少逐次追加造成的碎片；多预分配的部分在关闭时截掉。
+// 只是提示：空间或配额不足时放弃预分配，不影响写入器状态，真正写不下时由写入报错
+ void archive_writer_reserve(ArchiveWriter *writer, uint64_t size) {
+    if (!writer->owns_fd || writer->error || size <= writer->reserved) return;
+    
+    if (file_preallocate(writer->fd, size)) {
+        writer->reserved = size;
+        return;
+    }
+    // 失败的fallocate可能已经分配了一部分，截回到原来的大小
+    uint64_t current = writer->reserved > writer->flushed ? writer->reserved : writer->flushed;
+    if (ftruncate(writer->fd, (off_t)current) != 0) {
+        // 截不回去时关闭时仍会按实际大小截断
+        writer->reserved = size;
+    }
+}
+
+// 写出缓冲区中的全部数据
+ int archive_writer_flush(ArchiveWriter *writer) {
+    if (writer->error) return 0;
+    return writer_flush_buffer(writer, 1);
+}
+
+// 写出剩余数据并关闭；返回1表示全部写入成功
+ int archive_writer_close(ArchiveWriter *writer) {
+    if (!writer) return 0;
+    
+    int ok = archive_writer_flush(writer);
+    // 预分配超出实际大小时截掉多余部分
+    if (ok && writer->reserved > writer->flushed &&
+        ftruncate(writer->fd, (off_t)writer->flushed) != 0) {
+        ok = 0;
+    }
+    if (writer->owns_fd && close(writer->fd) != 0 && ok) {
+        ok = 0;
+    }
+    
+    if (writer->owns_buffer) {
+        destroy_buffer(writer->buf);
+    } else {
+        writer->buf->size = 0;
+    }
+    free(writer);
+    return ok;
+}
@@ -1,7 +1,12 @@
 #include "../include/buffer.h"
+#include "../include/stats.h"
+
+#include <pthread.h>
 
 // 创建内存缓冲区
  MemoryBuffer* create_buffer(size_t initial_capacity) {
+    StatsMark mark;
+    stats_begin(&mark);
     MemoryBuffer *buf = malloc(sizeof(MemoryBuffer));
     if (!buf) return NULL;
     
@@ -13,9 +18,18 @@
     
     buf->size = 0;
     buf->capacity = initial_capacity;
+    buf->next_free = NULL;
+    stats_end(STATS_ALLOC, &mark, 0, initial_capacity);
     return buf;
 }
 
+// 释放内存缓冲区
+ void destroy_buffer(MemoryBuffer *buf) {
+    if (!buf) return;
+    free(buf->buffer);
+    free(buf);
+}
+
 // 扩展缓冲区
  int expand_buffer(MemoryBuffer *buf, size_t min_capacity) {
     if (buf->capacity >= min_capacity) {
@@ -27,11 +41,14 @@
         new_capacity = min_capacity;
     }
     
+    StatsMark mark;
+    stats_begin(&mark);
     uint8_t *new_buffer = realloc(buf->buffer, new_capacity);
     if (!new_buffer) {
         return 0;
     }
     
+    stats_end(STATS_ALLOC, &mark, 0, new_capacity - buf->capacity);
     buf->buffer = new_buffer;
     buf->capacity = new_capacity;
     return 1;
@@ -47,4 +64,191 @@
     memcpy(buf->buffer + buf->size, data, size);
     buf->size += size;
     return 1;
-}
\ No newline at end of file
+}
+
+// 每线程缓存
+typedef struct {
+    MemoryBuffer *free_list[BUFFER_POOL_CLASSES];
+    unsigned count[BUFFER_POOL_CLASSES];
+} ThreadBufferCache;
+
+static __thread ThreadBufferCache *thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+// 共享池
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemoryBuffer *shared_free[BUFFER_POOL_CLASSES];
+
+static size_t pool_cache_limit = BUFFER_POOL_DEFAULT_CACHE_LIMIT;
+static size_t pool_cached_bytes;
+static uint64_t pool_hits, pool_misses, pool_releases, pool_drops;
+
+#define POOL_ADD(var, n) __atomic_add_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define POOL_SUB(var, n) __atomic_sub_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define POOL_LOAD(var)   __atomic_load_n(&(var), __ATOMIC_RELAXED)
+
+// 容纳size字节所需的最小尺寸类，超出范围返回-1
+static int class_for_request(size_t size) {
+    int cls = 0;
+    while (((size_t)1 << (cls + BUFFER_POOL_MIN_SHIFT)) < size) {
+        if (++cls >= BUFFER_POOL_CLASSES) return -1;
+    }
+    return cls;
+}
+
+// 容量capacity可以归入的最大尺寸类，不足最小类返回-1
+static int class_for_capacity(size_t capacity) {
+    if (capacity < ((size_t)1 << BUFFER_POOL_MIN_SHIFT)) return -1;
+    int cls = 0;
+    while (cls + 1 < BUFFER_POOL_CLASSES &&
+           ((size_t)1 << (cls + 1 + BUFFER_POOL_MIN_SHIFT)) <= capacity) {
+        cls++;
+    }
+    return cls;
+}
+
+static void shared_push(int cls, MemoryBuffer *buf) {
+    pthread_mutex_lock(&pool_lock);
+    buf->next_free = shared_free[cls];
+    shared_free[cls] = buf;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+static MemoryBuffer* shared_pop(int cls) {
+    pthread_mutex_lock(&pool_lock);
+    MemoryBuffer *buf = shared_free[cls];
+    if (buf) shared_free[cls] = buf->next_free;
+    pthread_mutex_unlock(&pool_lock);
+    return buf;
+}
+
+// 线程退出时把缓存交回共享池
+static void thread_cache_destructor(void *arg) {
+    ThreadBufferCache *cache = arg;
+    for (int cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+        while (cache->free_list[cls]) {
+            MemoryBuffer *buf = cache->free_list[cls];
+            cache->free_list[cls] = buf->next_free;
+            shared_push(cls, buf);
+        }
+    }
+    free(cache);
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, thread_cache_destructor);
+}
+
+static ThreadBufferCache* get_thread_cache(void) {
+    if (!thread_cache) {
+        pthread_once(&cache_once, create_cache_key);
+        thread_cache = calloc(1, sizeof(ThreadBufferCache));
+        if (thread_cache) {
+            pthread_setspecific(cache_key, thread_cache);
+        }
+    }
+    return thread_cache;
+}
+
+// 取得容量不小于min_capacity的空缓冲区（size为0）
+ MemoryBuffer* buffer_pool_acquire(size_t min_capacity) {
+    int cls = class_for_request(min_capacity);
+    if (cls < 0) {
+        // 超大缓冲区不进入缓冲池
+        POOL_ADD(pool_misses, 1);
+        return create_buffer(min_capacity);
+    }
+    
+    MemoryBuffer *buf = NULL;
+    ThreadBufferCache *cache = get_thread_cache();
+    if (cache && cache->free_list[cls]) {
+        buf = cache->free_list[cls];
+        cache->free_list[cls] = buf->next_free;
+        cache->count[cls]--;
+    } else {
+        buf = shared_pop(cls);
+    }
+    
+    if (buf) {
+        POOL_SUB(pool_cached_bytes, buf->capacity);
+        POOL_ADD(pool_hits, 1);
+        buf->next_free = NULL;
+        buf->size = 0;
+        return buf;
+    }
+    
+    POOL_ADD(pool_misses, 1);
+    return create_buffer((size_t)1 << (cls + BUFFER_POOL_MIN_SHIFT));
+}
+
+// 归还缓冲区；可以在任意线程归还
+ void buffer_pool_release(MemoryBuffer *buf) {
+    if (!buf) return;
+    
+    // 按实际容量归类（缓冲区可能被expand_buffer扩大过）
+    int cls = class_for_capacity(buf->capacity);
+    if (cls < 0 || buf->capacity > ((size_t)1 << BUFFER_POOL_MAX_SHIFT)) {
+        POOL_ADD(pool_drops, 1);
+        destroy_buffer(buf);
+        return;
+    }
+    
+    // 空闲缓存超过上限时直接释放，保持闲置的常驻内存平稳
+    if (POOL_ADD(pool_cached_bytes, buf->capacity) > POOL_LOAD(pool_cache_limit)) {
+        POOL_SUB(pool_cached_bytes, buf->capacity);
+        POOL_ADD(pool_drops, 1);
+        destroy_buffer(buf);
+        return;
+    }
+    
+    POOL_ADD(pool_releases, 1);
+    buf->size = 0;
+    ThreadBufferCache *cache = get_thread_cache();
+    if (cache && cache->count[cls] < BUFFER_POOL_THREAD_SLOTS) {
+        buf->next_free = cache->free_list[cls];
+        cache->free_list[cls] = buf;
+        cache->count[cls]++;
+    } else {
+        shared_push(cls, buf);
+    }
+}
+
+// 设置空闲缓存字节数上限（0表示不缓存）
+ void buffer_pool_set_cache_limit(size_t limit) {
+    __atomic_store_n(&pool_cache_limit, limit, __ATOMIC_RELAXED);
+    if (POOL_LOAD(pool_cached_bytes) > limit) {
+        buffer_pool_trim();
+    }
+}
+
+// 释放共享池和当前线程缓存中的全部缓冲区
+ void buffer_pool_trim(void) {
+    for (int cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+        if (thread_cache) {
+            while (thread_cache->free_list[cls]) {
+                MemoryBuffer *buf = thread_cache->free_list[cls];
+                thread_cache->free_list[cls] = buf->next_free;
+                POOL_SUB(pool_cached_bytes, buf->capacity);
+                destroy_buffer(buf);
+            }
+            thread_cache->count[cls] = 0;
+        }
+        
+        MemoryBuffer *buf;
+        while ((buf = shared_pop(cls)) != NULL) {
+            POOL_SUB(pool_cached_bytes, buf->capacity);
+            destroy_buffer(buf);
+        }
+    }
+}
+
+// 读取统计信息
+ void buffer_pool_get_stats(BufferPoolStats *stats) {
+    stats->hits = POOL_LOAD(pool_hits);
+    stats->misses = POOL_LOAD(pool_misses);
+    stats->releases = POOL_LOAD(pool_releases);
+    stats->drops = POOL_LOAD(pool_drops);
+    stats->cached_bytes = POOL_LOAD(pool_cached_bytes);
+    stats->cache_limit = POOL_LOAD(pool_cache_limit);
+}
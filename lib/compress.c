@@ -1,4 +1,155 @@
 #include "../include/compress.h"
+#include "../include/stats.h"
+
+#include <pthread.h>
+
+struct CodecContext {
+    z_stream deflate_strm;
+    z_stream inflate_strm;
+    int deflate_level;        // 当前deflate流的压缩级别，-1表示未初始化
+    int inflate_ready;
+};
+
+// 创建上下文（流在第一次使用时初始化）
+ CodecContext* codec_context_create(void) {
+    CodecContext *codec = calloc(1, sizeof(CodecContext));
+    if (!codec) return NULL;
+    codec->deflate_level = -1;
+    codec->inflate_ready = 0;
+    return codec;
+}
+
+// 销毁上下文
+ void codec_context_destroy(CodecContext *codec) {
+    if (!codec) return;
+    if (codec->deflate_level >= 0) deflateEnd(&codec->deflate_strm);
+    if (codec->inflate_ready) inflateEnd(&codec->inflate_strm);
+    free(codec);
+}
+
+static __thread CodecContext *thread_codec;
+static pthread_key_t codec_key;
+static pthread_once_t codec_once = PTHREAD_ONCE_INIT;
+
+static void thread_codec_destructor(void *arg) {
+    codec_context_destroy(arg);
+}
+
+static void create_codec_key(void) {
+    pthread_key_create(&codec_key, thread_codec_destructor);
+}
+
+// 当前线程的上下文（首次调用时创建，线程退出时释放）
+ CodecContext* codec_thread_context(void) {
+    if (!thread_codec) {
+        pthread_once(&codec_once, create_codec_key);
+        thread_codec = codec_context_create();
+        if (thread_codec) {
+            pthread_setspecific(codec_key, thread_codec);
+        }
+    }
+    return thread_codec;
+}
+
+// 准备deflate流：同级别时deflateReset，否则重新初始化
+static int codec_prepare_deflate(CodecContext *codec, int level) {
+    if (codec->deflate_level == level) {
+        return deflateReset(&codec->deflate_strm) == Z_OK;
+    }
+    if (codec->deflate_level >= 0) {
+        deflateEnd(&codec->deflate_strm);
+        codec->deflate_level = -1;
+    }
+    memset(&codec->deflate_strm, 0, sizeof(z_stream));
+    if (deflateInit(&codec->deflate_strm, level) != Z_OK) return 0;
+    codec->deflate_level = level;
+    return 1;
+}
+
+// 准备inflate流
+static int codec_prepare_inflate(CodecContext *codec) {
+    if (codec->inflate_ready) {
+        return inflateReset(&codec->inflate_strm) == Z_OK;
+    }
+    memset(&codec->inflate_strm, 0, sizeof(z_stream));
+    if (inflateInit(&codec->inflate_strm) != Z_OK) return 0;
+    codec->inflate_ready = 1;
+    return 1;
+}
+
+// 使用指定上下文压缩
+ int codec_compress(CodecContext *codec, const uint8_t *input, size_t input_size,
+                    MemoryBuffer *out, int compression_level,
+                    const uint8_t *dict, size_t dict_size) {
+    StatsMark mark;
+    stats_begin(&mark);
+    if (!codec_prepare_deflate(codec, compression_level)) return 0;
+    z_stream *strm = &codec->deflate_strm;
+    
+    if (dict && deflateSetDictionary(strm, dict, dict_size) != Z_OK) {
+        return 0;
+    }
+    
+    uLong bound = deflateBound(strm, input_size);
+    if (!expand_buffer(out, bound)) {
+        return 0;
+    }
+    
+    strm->next_in = (Bytef *)input;
+    strm->avail_in = input_size;
+    strm->next_out = out->buffer;
+    strm->avail_out = out->capacity;
+    
+    int result = deflate(strm, Z_FINISH);
+    out->size = strm->total_out;
+    stats_end(STATS_COMPRESS, &mark, input_size, out->size);
+    return result == Z_STREAM_END;
+}
+
+// 使用指定上下文解压
+ int codec_decompress(CodecContext *codec, const uint8_t *input, size_t input_size,
+                      MemoryBuffer *out, size_t output_size,
+                      const uint8_t *dict, size_t dict_size) {
+    StatsMark mark;
+    stats_begin(&mark);
+    if (!expand_buffer(out, output_size ? output_size : 1)) return 0;
+    if (!codec_prepare_inflate(codec)) return 0;
+    z_stream *strm = &codec->inflate_strm;
+    
+    strm->next_in = (Bytef *)input;
+    strm->avail_in = input_size;
+    strm->next_out = out->buffer;
+    strm->avail_out = output_size;
+    
+    int result = inflate(strm, Z_FINISH);
+    if (result == Z_NEED_DICT && dict) {
+        // 流头中的Adler32与字典不符时这里会失败
+        if (inflateSetDictionary(strm, dict, dict_size) == Z_OK) {
+            result = inflate(strm, Z_FINISH);
+        }
+    }
+    
+    int ok = result == Z_STREAM_END && strm->total_out == output_size;
+    out->size = ok ? output_size : 0;
+    stats_end(STATS_DECOMPRESS, &mark, input_size, out->size);
+    return ok;
+}
+
+// 压缩到缓冲区（out->size为压缩后大小），dict为NULL时不使用字典
+ int compress_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                        int compression_level, const uint8_t *dict, size_t dict_size) {
+    CodecContext *codec = codec_thread_context();
+    if (!codec) return 0;
+    return codec_compress(codec, input, input_size, out, compression_level, dict, dict_size);
+}
+
+// 解压output_size字节到缓冲区，dict为NULL时不使用字典
+ int decompress_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                          size_t output_size, const uint8_t *dict, size_t dict_size) {
+    CodecContext *codec = codec_thread_context();
+    if (!codec) return 0;
+    return codec_decompress(codec, input, input_size, out, output_size, dict, dict_size);
+}
 
 // 使用zlib压缩数据
  int compress_data(const uint8_t *input, size_t input_size,
@@ -13,34 +164,232 @@
         return 1;
     }
     
-    // 计算压缩后的最大大小
-    uLongf dest_len = compressBound(input_size);
-    uint8_t *dest = malloc(dest_len);
-    if (!dest) return 0;
+    // 复用线程上下文，避免每次compress2重新初始化deflate状态
+    MemoryBuffer out = { malloc(compressBound(input_size)), 0, compressBound(input_size), NULL };
+    if (!out.buffer) return 0;
     
-    int result = compress2(dest, &dest_len, input, input_size, compression_level);
-    if (result != Z_OK) {
-        free(dest);
+    if (!compress_to_buffer(input, input_size, &out, compression_level, NULL, 0)) {
+        free(out.buffer);
         return 0;
     }
     
-    *output = dest;
-    *output_size = dest_len;
+    *output = out.buffer;
+    *output_size = out.size;
     return 1;
 }
 // 解压数据
  int decompress_data(const uint8_t *input, size_t input_size,
                           uint8_t **output, size_t output_size) {
-    *output = malloc(output_size);
-    if (!*output) return 0;
+    MemoryBuffer out = { malloc(output_size ? output_size : 1), 0, output_size ? output_size : 1, NULL };
+    if (!out.buffer) return 0;
     
-    uLongf dest_len = output_size;
-    int result = uncompress(*output, &dest_len, input, input_size);
-    if (result != Z_OK) {
-        free(*output);
+    if (!decompress_to_buffer(input, input_size, &out, output_size, NULL, 0)) {
+        free(out.buffer);
         *output = NULL;
         return 0;
     }
     
+    *output = out.buffer;
     return 1;
-}
\ No newline at end of file
+}
+
+// 使用预置字典压缩（deflateSetDictionary）
+ int compress_data_dict(const uint8_t *input, size_t input_size,
+                        uint8_t **output, size_t *output_size,
+                        int compression_level,
+                        const uint8_t *dict, size_t dict_size) {
+    MemoryBuffer *out = create_buffer(input_size + 64);
+    if (!out) return 0;
+    
+    if (!compress_to_buffer(input, input_size, out, compression_level, dict, dict_size)) {
+        destroy_buffer(out);
+        return 0;
+    }
+    
+    *output = out->buffer;
+    *output_size = out->size;
+    free(out);
+    return 1;
+}
+
+// 使用预置字典解压（inflateSetDictionary）
+ int decompress_data_dict(const uint8_t *input, size_t input_size,
+                          uint8_t **output, size_t output_size,
+                          const uint8_t *dict, size_t dict_size) {
+    MemoryBuffer *out = create_buffer(output_size ? output_size : 1);
+    if (!out) return 0;
+    
+    if (!decompress_to_buffer(input, input_size, out, output_size, dict, dict_size)) {
+        destroy_buffer(out);
+        *output = NULL;
+        return 0;
+    }
+    
+    *output = out->buffer;
+    free(out);
+    return 1;
+}
+
+// 字典训练参数
+#define DICT_GRAM        8      // 以8字节片段统计重复
+#define DICT_HASH_BITS   18
+#define DICT_SEGMENT     512    // 每次挑选的窗口长度
+#define DICT_DECAY       2      // 片段选中后，其中各8字节片段的得分右移的位数
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    uint64_t score;
+    size_t start;      // 在所有样本依次排列中的位置（标记已选字节）
+} DictSegment;
+
+static uint32_t dict_hash(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - DICT_HASH_BITS));
+}
+
+static int compare_segments(const void *a, const void *b) {
+    const DictSegment *x = a, *y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return 0;
+}
+
+// 在样本[first, last)中找得分最高的窗口：窗口内各8字节片段的当前得分之和。
+// used按字节标记已选入字典的位置（各样本依次排列，样本s从start[s]开始），与已选窗口重叠的窗口不参与
+static DictSegment best_dict_segment(const uint8_t *const *samples, const size_t *sample_sizes,
+                                     const size_t *start, int first, int last,
+                                     const uint16_t *score, const uint8_t *used_all) {
+    DictSegment best = { NULL, 0, 0, 0 };
+    for (int s = first; s < last; s++) {
+        const uint8_t *data = samples[s];
+        const uint8_t *used = used_all + start[s];
+        size_t size = sample_sizes[s];
+        if (size < DICT_GRAM) continue;
+        
+        size_t length = size < DICT_SEGMENT ? size : DICT_SEGMENT;
+        size_t grams = length - DICT_GRAM + 1;
+        uint64_t sum = 0;
+        size_t taken = 0;   // 窗口内已选入的字节数
+        for (size_t g = 0; g < grams; g++) {
+            sum += score[dict_hash(data + g)];
+        }
+        for (size_t i = 0; i < length; i++) {
+            taken += used[i];
+        }
+        for (size_t p = 0; ; p++) {
+            if (taken == 0 && sum > best.score) {
+                best = (DictSegment){ data + p, length, sum, start[s] + p };
+            }
+            if (p + length >= size) break;
+            sum -= score[dict_hash(data + p)];
+            sum += score[dict_hash(data + p + grams)];
+            taken -= used[p];
+            taken += used[p + length];
+        }
+    }
+    return best;
+}
+
+// 从样本中训练字典，最常用的片段放在末尾。
+// 片段得分为出现的样本数（只在一个样本中出现的不计）。样本分成若干段，每段挑一个得分最高的窗口；
+// 选中窗口中各片段的得分降低而不是清零，其他样本中相同的内容仍可入选；同一位置不会再次入选。
+// 一轮挑完后字典未满时继续
+ int train_dictionary(const uint8_t *const *samples, const size_t *sample_sizes,
+                      int sample_count, size_t max_size,
+                      uint8_t **dict, size_t *dict_size) {
+    size_t table_size = (size_t)1 << DICT_HASH_BITS;
+    uint16_t *doc_freq = calloc(table_size, sizeof(uint16_t));
+    int32_t *last_sample = malloc(table_size * sizeof(int32_t));
+    size_t *sample_start = malloc((sample_count > 0 ? sample_count : 1) * sizeof(size_t));
+    uint8_t *used = NULL;
+    DictSegment *segments = NULL;
+    size_t segment_count = 0, segment_capacity = 0;
+    int ok = 0;
+    
+    if (!doc_freq || !last_sample || !sample_start || sample_count <= 0 || max_size == 0) goto out;
+    size_t sample_total = 0;
+    for (int s = 0; s < sample_count; s++) {
+        sample_start[s] = sample_total;
+        sample_total += sample_sizes[s];
+    }
+    used = calloc(sample_total + 1, 1);
+    if (!used) goto out;
+    memset(last_sample, 0xFF, table_size * sizeof(int32_t));
+    
+    // 统计每个片段出现在多少个样本中
+    for (int s = 0; s < sample_count; s++) {
+        for (size_t p = 0; p + DICT_GRAM <= sample_sizes[s]; p++) {
+            uint32_t h = dict_hash(samples[s] + p);
+            if (last_sample[h] != s) {
+                last_sample[h] = s;
+                if (doc_freq[h] < UINT16_MAX) doc_freq[h]++;
+            }
+        }
+    }
+    for (size_t h = 0; h < table_size; h++) {
+        if (doc_freq[h] < 2) doc_freq[h] = 0;
+    }
+    
+    // 每段样本挑一个窗口，直到填满字典或没有重复的内容
+    size_t epochs = max_size / DICT_SEGMENT;
+    if (epochs > (size_t)sample_count) epochs = sample_count;
+    if (epochs == 0) epochs = 1;
+    size_t total = 0;
+    for (;;) {
+        size_t added = 0;
+        for (size_t e = 0; e < epochs && total < max_size; e++) {
+            int first = (int)(sample_count * e / epochs);
+            int last = (int)(sample_count * (e + 1) / epochs);
+            DictSegment best = best_dict_segment(samples, sample_sizes, sample_start, first, last,
+                                                 doc_freq, used);
+            if (best.score == 0) continue;
+            
+            for (size_t g = 0; g + DICT_GRAM <= best.length; g++) {
+                uint32_t h = dict_hash(best.data + g);
+                doc_freq[h] >>= DICT_DECAY;
+            }
+            if (best.length > max_size - total) {
+                best.length = max_size - total;
+            }
+            memset(used + best.start, 1, best.length);
+            
+            if (segment_count == segment_capacity) {
+                size_t capacity = segment_capacity ? segment_capacity * 2 : 256;
+                DictSegment *grown = realloc(segments, capacity * sizeof(DictSegment));
+                if (!grown) goto out;
+                segments = grown;
+                segment_capacity = capacity;
+            }
+            segments[segment_count++] = best;
+            total += best.length;
+            added++;
+        }
+        if (added == 0 || total >= max_size) break;
+    }
+    
+    if (segment_count == 0) goto out;
+    
+    uint8_t *out_dict = malloc(total);
+    if (!out_dict) goto out;
+    
+    // 得分越高越靠后，匹配距离越短
+    qsort(segments, segment_count, sizeof(DictSegment), compare_segments);
+    size_t pos = total;
+    for (size_t i = 0; i < segment_count; i++) {
+        pos -= segments[i].length;
+        memcpy(out_dict + pos, segments[i].data, segments[i].length);
+    }
+    
+    *dict = out_dict;
+    *dict_size = total;
+    ok = 1;
+    
+out:
+    free(doc_freq);
+    free(last_sample);
+    free(sample_start);
+    free(used);
+    free(segments);
+    return ok;
+}
@@ -0,0 +1,296 @@
+#include "../include/dir_cache.h"
+#include "../include/stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 目录fd缓存：解压时按相对路径缓存已打开的目录，文件用openat相对上级目录创建，
+// 不再每个文件都从头解析完整路径。未命中时先取得上级目录（递归，同样经过缓存），
+// 再openat打开这一级，不存在时mkdirat创建，因此缺少的各级目录只创建一次。
+// 缓存满时淘汰最久未使用且未固定的目录；全部固定时扩容。按路径查找经过哈希桶，不扫描全部槽。
+// 各级目录都以O_NOFOLLOW打开，路径中含".."的成员被拒绝，解压不会写到根目录之外
+// （开头的"/"被去掉，绝对路径也落在根目录下）。
+
+typedef struct {
+    char *path;            // 相对根目录的路径（NULL表示空槽）
+    size_t len;
+    uint32_t hash;
+    int fd;
+    unsigned pins;         // 固定计数（在途的异步请求）
+    uint64_t last_used;    // LRU时间戳
+    int next;              // 同一哈希桶中的下一个槽（-1表示没有）
+} DirSlot;
+
+struct DirCache {
+    int root_fd;
+    DirSlot *slots;
+    unsigned capacity;
+    int *buckets;          // 哈希桶：每桶第一个槽的序号（-1表示空），桶数为不小于capacity的2的幂
+    unsigned bucket_mask;
+    uint64_t clock;
+};
+
+// FNV-1a
+static uint32_t path_hash(const char *path, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 路径段是否为".."（长度len）
+static int is_dot_dot(const char *name, size_t len) {
+    return len == 2 && name[0] == '.' && name[1] == '.';
+}
+
+// 打开parent下名为name（长度len）的目录，不存在时创建。
+// 不跟随符号链接：先解压的成员是指向外部的链接时，后面的成员不能借它写到外面
+static int open_dir_at(int parent, const char *name, size_t len) {
+    char component[NAME_MAX + 1];
+    if (len > NAME_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (is_dot_dot(name, len)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(component, name, len);
+    component[len] = '\0';
+
+    StatsMark mark;
+    stats_begin(&mark);
+    int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    int fd = openat(parent, component, flags);
+    if (fd < 0 && errno == ENOENT) {
+        if (mkdirat(parent, component, 0755) != 0 && errno != EEXIST) {
+            return -1;
+        }
+        fd = openat(parent, component, flags);
+    }
+    stats_end(STATS_MKDIR, &mark, 0, 0);
+    return fd;
+}
+
+// 不小于capacity的2的幂个桶，按各槽的哈希重新挂链
+static int rebuild_buckets(DirCache *cache) {
+    unsigned count = 1;
+    while (count < cache->capacity) {
+        count <<= 1;
+    }
+    int *buckets = malloc(sizeof(int) * count);
+    if (!buckets) return 0;
+    memset(buckets, 0xFF, sizeof(int) * count);
+    for (unsigned i = 0; i < cache->capacity; i++) {
+        DirSlot *slot = &cache->slots[i];
+        if (!slot->path) continue;
+        slot->next = buckets[slot->hash & (count - 1)];
+        buckets[slot->hash & (count - 1)] = (int)i;
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = count - 1;
+    return 1;
+}
+
+// 把槽从它的哈希桶中摘下
+static void unlink_slot(DirCache *cache, DirSlot *slot) {
+    int index = (int)(slot - cache->slots);
+    int *link = &cache->buckets[slot->hash & cache->bucket_mask];
+    while (*link >= 0 && *link != index) {
+        link = &cache->slots[*link].next;
+    }
+    if (*link == index) {
+        *link = slot->next;
+    }
+}
+
+// 选择放入新目录的槽：空槽，否则最久未使用且未固定的槽；全部固定时扩容
+static DirSlot* take_slot(DirCache *cache) {
+    DirSlot *victim = NULL;
+    for (unsigned i = 0; i < cache->capacity; i++) {
+        DirSlot *slot = &cache->slots[i];
+        if (!slot->path) return slot;
+        if (slot->pins == 0 && (!victim || slot->last_used < victim->last_used)) {
+            victim = slot;
+        }
+    }
+
+    if (victim) {
+        unlink_slot(cache, victim);
+        close(victim->fd);
+        free(victim->path);
+        victim->path = NULL;
+        return victim;
+    }
+
+    unsigned capacity = cache->capacity * 2;
+    DirSlot *slots = realloc(cache->slots, sizeof(DirSlot) * capacity);
+    if (!slots) return NULL;
+    memset(slots + cache->capacity, 0, sizeof(DirSlot) * (capacity - cache->capacity));
+    cache->slots = slots;
+    unsigned first_new = cache->capacity;
+    cache->capacity = capacity;
+    if (!rebuild_buckets(cache)) return NULL;
+    return &slots[first_new];
+}
+
+// 返回path前len字节表示的目录的fd
+static int lookup_dir(DirCache *cache, const char *path, size_t len) {
+    while (len > 0 && path[len - 1] == '/') {
+        len--;
+    }
+    if (len == 0) return cache->root_fd;
+
+    uint32_t hash = path_hash(path, len);
+    for (int i = cache->buckets[hash & cache->bucket_mask]; i >= 0; i = cache->slots[i].next) {
+        DirSlot *slot = &cache->slots[i];
+        if (slot->hash == hash && slot->len == len && memcmp(slot->path, path, len) == 0) {
+            slot->last_used = ++cache->clock;
+            return slot->fd;
+        }
+    }
+
+    // 未命中：先取得上级目录，再打开（必要时创建）这一级
+    size_t start = len;
+    while (start > 0 && path[start - 1] != '/') {
+        start--;
+    }
+    int parent = lookup_dir(cache, path, start);
+    if (parent < 0) return -1;
+    int fd = open_dir_at(parent, path + start, len - start);
+    if (fd < 0) return -1;
+
+    DirSlot *slot = take_slot(cache);
+    char *copy = slot ? malloc(len + 1) : NULL;
+    if (!copy) {
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(copy, path, len);
+    copy[len] = '\0';
+    slot->path = copy;
+    slot->len = len;
+    slot->hash = hash;
+    slot->fd = fd;
+    slot->pins = 0;
+    slot->last_used = ++cache->clock;
+    slot->next = cache->buckets[hash & cache->bucket_mask];
+    cache->buckets[hash & cache->bucket_mask] = (int)(slot - cache->slots);
+    return fd;
+}
+
+// 逐级创建root（mkdir -p）
+static int make_root(const char *root) {
+    char path[PATH_MAX];
+    size_t len = strlen(root);
+    if (len >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    memcpy(path, root, len + 1);
+    for (size_t i = 1; i <= len; i++) {
+        if (path[i] != '/' && path[i] != '\0') continue;
+        char saved = path[i];
+        path[i] = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return 0;
+        path[i] = saved;
+    }
+    return 1;
+}
+
+DirCache* dir_cache_create(const char *root, unsigned capacity) {
+    if (!root || !*root) {
+        root = ".";
+    }
+    if (capacity == 0) {
+        capacity = DIR_CACHE_DEFAULT_SIZE;
+    }
+
+    int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && make_root(root)) {
+        fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (fd < 0) return NULL;
+
+    DirCache *cache = calloc(1, sizeof(DirCache));
+    DirSlot *slots = calloc(capacity, sizeof(DirSlot));
+    if (!cache || !slots) {
+        free(cache);
+        free(slots);
+        close(fd);
+        return NULL;
+    }
+    cache->root_fd = fd;
+    cache->slots = slots;
+    cache->capacity = capacity;
+    if (!rebuild_buckets(cache)) {
+        dir_cache_destroy(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void dir_cache_destroy(DirCache *cache) {
+    if (!cache) return;
+
+    for (unsigned i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].path) {
+            close(cache->slots[i].fd);
+            free(cache->slots[i].path);
+        }
+    }
+    close(cache->root_fd);
+    free(cache->slots);
+    free(cache->buckets);
+    free(cache);
+}
+
+int dir_cache_parent(DirCache *cache, const char *path, const char **name) {
+    // 路径总是相对根目录
+    while (*path == '/') {
+        path++;
+    }
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+    if (*base == '\0' || is_dot_dot(base, strlen(base))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *name = base;
+    return slash ? lookup_dir(cache, path, slash - path) : cache->root_fd;
+}
+
+// 按fd查找缓存槽（根目录不在槽中，不需要固定）
+static DirSlot* find_slot(DirCache *cache, int fd) {
+    for (unsigned i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].path && cache->slots[i].fd == fd) {
+            return &cache->slots[i];
+        }
+    }
+    return NULL;
+}
+
+void dir_cache_pin(DirCache *cache, int fd) {
+    DirSlot *slot = find_slot(cache, fd);
+    if (slot) {
+        slot->pins++;
+    }
+}
+
+void dir_cache_unpin(DirCache *cache, int fd) {
+    DirSlot *slot = find_slot(cache, fd);
+    if (slot && slot->pins > 0) {
+        slot->pins--;
+    }
+}
@@ -1,10 +1,13 @@
 #include "../include/encrypt.h"
+#include "../include/stats.h"
 
 
 // AES加密（简单实现）
  int encrypt_data(const uint8_t *input, size_t input_size,
                        uint8_t **output, size_t *output_size,
                        const char *password) {
+    StatsMark mark;
+    stats_begin(&mark);
     // 简单实现：实际应使用更安全的加密
     size_t padded_size = ((input_size + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
     uint8_t *dest = malloc(padded_size);
@@ -27,6 +30,7 @@
     
     *output = dest;
     *output_size = padded_size;
+    stats_end(STATS_ENCRYPT, &mark, input_size, padded_size);
     return 1;
 }
 
@@ -37,6 +41,8 @@
     if (input_size % AES_BLOCK_SIZE != 0) {
         return 0;  // 不是块大小的倍数
     }
+    StatsMark mark;
+    stats_begin(&mark);
     
     // 使用相同的密钥
     unsigned char key[32];
@@ -58,5 +64,52 @@
     
     *output = dest;
     *output_size = original_size;
+    stats_end(STATS_DECRYPT, &mark, input_size, original_size);
     return 1;
-}
\ No newline at end of file
+}
+// 加密到缓冲区（out->size为填充后大小）
+ int encrypt_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                       const char *password) {
+    StatsMark mark;
+    stats_begin(&mark);
+    size_t padded_size = ((input_size + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
+    if (!expand_buffer(out, padded_size)) return 0;
+    
+    unsigned char key[32];
+    SHA256((unsigned char*)password, strlen(password), key);
+    
+    uint8_t *dest = out->buffer;
+    for (size_t i = 0; i < input_size; i++) {
+        dest[i] = input[i] ^ key[i % 32];
+    }
+    for (size_t i = input_size; i < padded_size; i++) {
+        dest[i] = key[i % 32];
+    }
+    
+    out->size = padded_size;
+    stats_end(STATS_ENCRYPT, &mark, input_size, padded_size);
+    return 1;
+}
+
+// 解密到缓冲区；不去除填充，调用者按已知的原始长度使用
+ int decrypt_to_buffer(const uint8_t *input, size_t input_size, MemoryBuffer *out,
+                       const char *password) {
+    if (input_size % AES_BLOCK_SIZE != 0) {
+        return 0;  // 不是块大小的倍数
+    }
+    StatsMark mark;
+    stats_begin(&mark);
+    if (!expand_buffer(out, input_size)) return 0;
+    
+    unsigned char key[32];
+    SHA256((unsigned char*)password, strlen(password), key);
+    
+    uint8_t *dest = out->buffer;
+    for (size_t i = 0; i < input_size; i++) {
+        dest[i] = input[i] ^ key[i % 32];
+    }
+    
+    out->size = input_size;
+    stats_end(STATS_DECRYPT, &mark, input_size, input_size);
+    return 1;
+}
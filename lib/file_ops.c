@@ -0,0 +1,190 @@
+#include "../include/archiver.h"
+#include "../include/file_ops.h"
+#include "../include/stats.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/sysmacros.h>
+
+#ifdef STATX_BASIC_STATS
+// 用statx结果填写FileInfo
+ void file_info_from_statx(FileInfo *info, const struct statx *stx) {
+    info->size = stx->stx_size;
+    info->mode = stx->stx_mode;
+    info->mtime = stx->stx_mtime.tv_sec;
+    info->atime = stx->stx_atime.tv_sec;
+    info->dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    info->ino = stx->stx_ino;
+    info->nlink = stx->stx_nlink;
+}
+#endif
+
+// 通过fd获取元数据：优先statx（只请求需要的字段），否则退回fstat
+static int file_stat_fd(int fd, FileInfo *info) {
+    StatsMark mark;
+    stats_begin(&mark);
+#ifdef STATX_BASIC_STATS
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, FILE_INFO_STATX_MASK, &stx) == 0) {
+        file_info_from_statx(info, &stx);
+        stats_end(STATS_STAT, &mark, 0, 0);
+        return 1;
+    }
+    if (errno != ENOSYS) {
+        return 0;
+    }
+#endif
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return 0;
+    }
+    info->size = st.st_size;
+    info->mode = st.st_mode;
+    info->mtime = st.st_mtime;
+    info->atime = st.st_atime;
+    info->dev = st.st_dev;
+    info->ino = st.st_ino;
+    info->nlink = st.st_nlink;
+    stats_end(STATS_STAT, &mark, 0, 0);
+    return 1;
+}
+
+// 打开文件并获取元数据，成功返回fd，失败返回-1（errno保留）
+ int file_open_info(const char *path, FileInfo *info) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (!file_stat_fd(fd, info)) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    // 调用者都是从头到尾读取整个文件
+    if (S_ISREG(info->mode)) {
+        file_advise_sequential(fd);
+    }
+    return fd;
+}
+
+// 从fd读取size字节到buf（处理短读和EINTR）
+ int file_read_all(int fd, uint8_t *buf, size_t size) {
+    StatsMark mark;
+    stats_begin(&mark);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, buf + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (n == 0) {
+            // 文件在读取期间被截断
+            return 0;
+        }
+        done += (size_t)n;
+    }
+    stats_end(STATS_READ, &mark, size, size);
+    return 1;
+}
+
+// 从fd读取最多size字节，直到读满或遇到EOF（适用于管道）；返回读到的字节数，出错返回-1
+ ssize_t file_read_some(int fd, uint8_t *buf, size_t size) {
+    StatsMark mark;
+    stats_begin(&mark);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, buf + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    stats_end(STATS_READ, &mark, done, done);
+    return (ssize_t)done;
+}
+
+// 向fd写入size字节（处理短写和EINTR）
+ int file_write_all(int fd, const uint8_t *buf, size_t size) {
+    StatsMark mark;
+    stats_begin(&mark);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, buf + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        done += (size_t)n;
+    }
+    stats_end(STATS_WRITE, &mark, size, size);
+    return 1;
+}
+
+// 为fd预分配[0, size)的空间，文件大小随之扩展到size；
+// 文件系统不支持fallocate时什么也不做。只有空间不足时返回0
+ int file_preallocate(int fd, uint64_t size) {
+    if (size == 0) return 1;
+    int ret;
+    do {
+        ret = fallocate(fd, 0, 0, (off_t)size);
+    } while (ret != 0 && errno == EINTR);
+    if (ret == 0) return 1;
+    // EOPNOTSUPP/ENOSYS（tmpfs旧内核、NFS等）和EINVAL都按不支持处理
+    return errno != ENOSPC && errno != EFBIG && errno != EDQUOT;
+}
+
+// 提示内核fd将被顺序读取（加大预读）
+ void file_advise_sequential(int fd) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+// 丢弃fd已缓存的干净页，读完的源文件不再占用页缓存
+ void file_drop_cache(int fd) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+// 大小为size的文件是否含有空洞（SEEK_HOLE早于文件末尾）；文件位置不变
+ int file_has_holes(int fd, uint64_t size) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    off_t hole = lseek(fd, 0, SEEK_HOLE);
+    if (pos >= 0) {
+        lseek(fd, pos, SEEK_SET);
+    }
+    return hole >= 0 && (uint64_t)hole < size;
+}
+
+// 查找pos处或之后的第一个数据区[*start, *end)；之后没有数据时*start = *end = size。
+// 文件系统不支持SEEK_DATA时整个文件视为一个数据区。出错返回0
+ int file_data_extent(int fd, uint64_t pos, uint64_t size, uint64_t *start, uint64_t *end) {
+    // SEEK_DATA/SEEK_HOLE会移动文件位置，查询后恢复
+    off_t saved = lseek(fd, 0, SEEK_CUR);
+    if (saved < 0) return 0;
+    
+    int ok = 1;
+    off_t data = lseek(fd, (off_t)pos, SEEK_DATA);
+    if (data < 0) {
+        if (errno == ENXIO) {
+            // pos之后全是空洞
+            *start = *end = size;
+        } else if (errno == EINVAL || errno == EOPNOTSUPP) {
+            *start = pos;
+            *end = size;
+        } else {
+            ok = 0;
+        }
+    } else {
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        ok = hole >= 0;
+        *start = (uint64_t)data < size ? (uint64_t)data : size;
+        *end = ok && (uint64_t)hole < size ? (uint64_t)hole : size;
+    }
+    
+    if (lseek(fd, saved, SEEK_SET) < 0) return 0;
+    return ok;
+}
@@ -0,0 +1,699 @@
+#include "../include/archiver.h"
+#include "../include/io_engine.h"
+#include "../include/thread_pool.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING 1
+#endif
+
+// io_uring中单个请求所处的阶段
+enum {
+    STAGE_OPEN = 0,
+    STAGE_STAT,
+    STAGE_READ,
+    STAGE_WRITE,
+    STAGE_CLOSE
+};
+
+#ifdef HAVE_IO_URING
+// 在途请求槽（user_data为槽下标）
+typedef struct {
+    IoRequest *req;
+    int stage;
+    int fd;
+    size_t offset;
+    struct statx stx;
+} UringSlot;
+
+// 直接通过系统调用使用的io_uring（不依赖liburing）
+typedef struct {
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_local_tail;   // 已填写但未提交的sqe
+    unsigned to_submit;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+    UringSlot *slots;
+    unsigned *free_slots;
+    unsigned free_count;
+} UringRing;
+#endif
+
+struct IoEngine {
+    IoBackend backend;
+    unsigned depth;
+    unsigned inflight;
+    // 已完成但未被reap的请求
+    IoRequest *done_head;
+    IoRequest *done_tail;
+    // 线程池后端
+    ThreadPool *pool;
+    pthread_mutex_t lock;
+    pthread_cond_t completed;
+#ifdef HAVE_IO_URING
+    UringRing ring;
+#endif
+};
+
+// 后端名称
+ const char* io_backend_name(IoBackend backend) {
+    switch (backend) {
+        case IO_BACKEND_SYNC:
+            return "sync";
+        case IO_BACKEND_URING:
+            return "io_uring";
+        case IO_BACKEND_THREADS:
+            return "threads";
+        default:
+            return "unknown";
+    }
+}
+
+// 加入完成队列（调用者负责加锁）
+static void push_done(IoEngine *engine, IoRequest *req) {
+    req->next = NULL;
+    if (engine->done_tail) {
+        engine->done_tail->next = req;
+    } else {
+        engine->done_head = req;
+    }
+    engine->done_tail = req;
+}
+
+static IoRequest* pop_done(IoEngine *engine) {
+    IoRequest *req = engine->done_head;
+    if (req) {
+        engine->done_head = req->next;
+        if (!engine->done_head) engine->done_tail = NULL;
+        req->next = NULL;
+    }
+    return req;
+}
+
+// 恢复文件属性（基于fd，不再解析路径）
+static void restore_attributes(int fd, const FileInfo *info) {
+    struct timespec times[2];
+    fchmod(fd, info->mode & 0777);
+    times[0].tv_sec = info->atime;
+    times[0].tv_nsec = 0;
+    times[1].tv_sec = info->mtime;
+    times[1].tv_nsec = 0;
+    futimens(fd, times);
+}
+
+// 写请求打开文件时相对的目录
+static int request_dir_fd(const IoRequest *req) {
+    return req->dir_fd > 0 ? req->dir_fd : AT_FDCWD;
+}
+
+// 同步执行一个请求（线程池后端的工作函数）
+static void run_request_sync(IoRequest *req) {
+    req->result = 0;
+    req->error = 0;
+
+    if (req->op == IO_OP_READ_FILE) {
+        req->data = NULL;
+        req->buffer = NULL;
+        req->fd = file_open_info(req->path, &req->info);
+        if (req->fd < 0) {
+            req->error = errno;
+            return;
+        }
+        if (!S_ISREG(req->info.mode) || req->info.size > IO_ENGINE_INLINE_MAX) {
+            // 交给调用者用同步路径处理
+            req->result = 1;
+            return;
+        }
+        req->size = req->info.size;
+        req->buffer = buffer_pool_acquire(req->size);
+        req->data = req->buffer ? req->buffer->buffer : NULL;
+        if (!req->data || !file_read_all(req->fd, req->data, req->size)) {
+            req->error = req->data ? (errno ? errno : EIO) : ENOMEM;
+            buffer_pool_release(req->buffer);
+            req->buffer = NULL;
+            req->data = NULL;
+            close(req->fd);
+            req->fd = -1;
+            return;
+        }
+        if (req->drop_cache) {
+            file_drop_cache(req->fd);
+        }
+        close(req->fd);
+        req->fd = -1;
+        req->result = 1;
+    } else {
+        int fd = openat(request_dir_fd(req), req->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            req->error = errno;
+            return;
+        }
+        if (!file_write_all(fd, req->data, req->size)) {
+            req->error = errno;
+            close(fd);
+            return;
+        }
+        restore_attributes(fd, &req->info);
+        close(fd);
+        req->result = 1;
+    }
+}
+
+static void thread_task(void *arg) {
+    IoRequest *req = arg;
+    IoEngine *engine = req->owner;
+
+    int traced = trace_member_begin(req->path);
+    run_request_sync(req);
+    if (traced) trace_member_end();
+
+    pthread_mutex_lock(&engine->lock);
+    push_done(engine, req);
+    pthread_cond_signal(&engine->completed);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+#ifdef HAVE_IO_URING
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_unmap(UringRing *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) munmap(ring->sq_ptr, ring->sq_len);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    free(ring->slots);
+    free(ring->free_slots);
+    memset(ring, 0, sizeof(*ring));
+    ring->ring_fd = -1;
+}
+
+// 检查内核是否支持需要的操作码
+static int uring_probe_ops(int ring_fd) {
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    if (!probe) return 0;
+
+    int ok = 0;
+    if (sys_io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        const int needed[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ,
+                               IORING_OP_WRITE, IORING_OP_CLOSE };
+        ok = 1;
+        for (size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); i++) {
+            if (needed[i] > probe->last_op ||
+                !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED)) {
+                ok = 0;
+                break;
+            }
+        }
+    }
+    free(probe);
+    return ok;
+}
+
+static int uring_init(UringRing *ring, unsigned depth) {
+    struct io_uring_params p;
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    ring->ring_fd = -1;
+
+    int fd = sys_io_uring_setup(depth, &p);
+    if (fd < 0) {
+        return 0;
+    }
+    ring->ring_fd = fd;
+
+    if (!uring_probe_ops(fd)) {
+        uring_unmap(ring);
+        return 0;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        uring_unmap(ring);
+        return 0;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            uring_unmap(ring);
+            return 0;
+        }
+    }
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        uring_unmap(ring);
+        return 0;
+    }
+
+    uint8_t *sq = ring->sq_ptr;
+    uint8_t *cq = ring->cq_ptr;
+    ring->sq_entries = p.sq_entries;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    ring->slots = calloc(depth, sizeof(UringSlot));
+    ring->free_slots = calloc(depth, sizeof(unsigned));
+    if (!ring->slots || !ring->free_slots) {
+        uring_unmap(ring);
+        return 0;
+    }
+    for (unsigned i = 0; i < depth; i++) {
+        ring->free_slots[i] = depth - 1 - i;
+    }
+    ring->free_count = depth;
+
+    return 1;
+}
+
+// 提交所有已填写的sqe；wait_nr>0时同时等待完成事件
+static int uring_flush(UringRing *ring, unsigned wait_nr) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    while (ring->to_submit > 0 || wait_nr > 0) {
+        int ret = sys_io_uring_enter(ring->ring_fd, ring->to_submit, wait_nr, flags);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        ring->to_submit -= (unsigned)ret;
+        if (ring->to_submit == 0) break;
+        if (ret == 0) return 0;
+    }
+    return 1;
+}
+
+// 取一个空闲sqe（SQ满时先提交）
+static struct io_uring_sqe* uring_get_sqe(UringRing *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= ring->sq_entries) {
+        uring_flush(ring, 0);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head >= ring->sq_entries) {
+            return NULL;
+        }
+    }
+
+    unsigned index = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+// 为槽的当前阶段准备sqe
+static int uring_queue_stage(UringRing *ring, unsigned slot_index) {
+    UringSlot *slot = &ring->slots[slot_index];
+    IoRequest *req = slot->req;
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) return 0;
+
+    sqe->user_data = slot_index;
+    switch (slot->stage) {
+        case STAGE_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = req->op == IO_OP_WRITE_FILE ? request_dir_fd(req) : AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)req->path;
+            if (req->op == IO_OP_READ_FILE) {
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            } else {
+                sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                sqe->len = 0644;
+            }
+            break;
+        case STAGE_STAT:
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = slot->fd;
+            sqe->addr = (uint64_t)(uintptr_t)"";
+            sqe->len = FILE_INFO_STATX_MASK;
+            sqe->off = (uint64_t)(uintptr_t)&slot->stx;
+            sqe->statx_flags = AT_EMPTY_PATH;
+            break;
+        case STAGE_READ:
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = slot->fd;
+            sqe->addr = (uint64_t)(uintptr_t)(req->data + slot->offset);
+            sqe->len = (uint32_t)(req->size - slot->offset);
+            sqe->off = slot->offset;
+            break;
+        case STAGE_WRITE:
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = slot->fd;
+            sqe->addr = (uint64_t)(uintptr_t)(req->data + slot->offset);
+            sqe->len = (uint32_t)(req->size - slot->offset);
+            sqe->off = slot->offset;
+            break;
+        case STAGE_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = slot->fd;
+            break;
+    }
+    return 1;
+}
+
+// 请求结束：释放槽并放入完成队列
+static void uring_finish(IoEngine *engine, unsigned slot_index, int error) {
+    UringRing *ring = &engine->ring;
+    UringSlot *slot = &ring->slots[slot_index];
+    IoRequest *req = slot->req;
+
+    if (error) {
+        if (slot->fd >= 0 && slot->stage != STAGE_CLOSE) {
+            close(slot->fd);
+        }
+        if (req->op == IO_OP_READ_FILE) {
+            buffer_pool_release(req->buffer);
+            req->buffer = NULL;
+            req->data = NULL;
+            req->fd = -1;
+        }
+        req->result = 0;
+        req->error = error;
+    } else {
+        req->result = 1;
+        req->error = 0;
+    }
+
+    slot->req = NULL;
+    ring->free_slots[ring->free_count++] = slot_index;
+    push_done(engine, req);
+}
+
+// 处理一个完成事件，推进请求的状态机
+static void uring_handle_cqe(IoEngine *engine, unsigned slot_index, int res) {
+    UringRing *ring = &engine->ring;
+    UringSlot *slot = &ring->slots[slot_index];
+    IoRequest *req = slot->req;
+
+    if (res < 0 && slot->stage != STAGE_CLOSE) {
+        if ((res == -EINTR || res == -EAGAIN) &&
+            (slot->stage == STAGE_READ || slot->stage == STAGE_WRITE)) {
+            if (!uring_queue_stage(ring, slot_index)) uring_finish(engine, slot_index, EBUSY);
+            return;
+        }
+        uring_finish(engine, slot_index, -res);
+        return;
+    }
+
+    switch (slot->stage) {
+        case STAGE_OPEN:
+            slot->fd = res;
+            if (req->op == IO_OP_READ_FILE) {
+                slot->stage = STAGE_STAT;
+            } else {
+                slot->stage = req->size > 0 ? STAGE_WRITE : STAGE_CLOSE;
+                if (slot->stage == STAGE_CLOSE) restore_attributes(slot->fd, &req->info);
+            }
+            break;
+        case STAGE_STAT:
+            if (stats_enabled) stats_count(STATS_STAT, 0, 0);
+            file_info_from_statx(&req->info, &slot->stx);
+            if (!S_ISREG(req->info.mode) || req->info.size > IO_ENGINE_INLINE_MAX) {
+                // 把打开的fd交给调用者（由调用者顺序读取）
+                file_advise_sequential(slot->fd);
+                req->fd = slot->fd;
+                slot->fd = -1;
+                uring_finish(engine, slot_index, 0);
+                return;
+            }
+            req->size = req->info.size;
+            req->buffer = buffer_pool_acquire(req->size);
+            req->data = req->buffer ? req->buffer->buffer : NULL;
+            if (!req->data) {
+                uring_finish(engine, slot_index, ENOMEM);
+                return;
+            }
+            slot->stage = req->size > 0 ? STAGE_READ : STAGE_CLOSE;
+            break;
+        case STAGE_READ:
+            if (res == 0) {
+                // 文件在读取期间被截断
+                uring_finish(engine, slot_index, EIO);
+                return;
+            }
+            if (stats_enabled) stats_count(STATS_READ, (uint64_t)res, (uint64_t)res);
+            slot->offset += (size_t)res;
+            if (slot->offset >= req->size) {
+                if (req->drop_cache) file_drop_cache(slot->fd);
+                slot->stage = STAGE_CLOSE;
+            }
+            break;
+        case STAGE_WRITE:
+            if (stats_enabled) stats_count(STATS_WRITE, (uint64_t)res, (uint64_t)res);
+            slot->offset += (size_t)res;
+            if (slot->offset >= req->size) {
+                restore_attributes(slot->fd, &req->info);
+                slot->stage = STAGE_CLOSE;
+            }
+            break;
+        case STAGE_CLOSE:
+            slot->fd = -1;
+            uring_finish(engine, slot_index, 0);
+            return;
+    }
+
+    if (!uring_queue_stage(ring, slot_index)) {
+        uring_finish(engine, slot_index, EBUSY);
+    }
+}
+
+// 提交并收割完成事件；wait为真时至少等待一个
+static int uring_process(IoEngine *engine, int wait) {
+    UringRing *ring = &engine->ring;
+
+    if (!uring_flush(ring, wait ? 1 : 0)) {
+        return 0;
+    }
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        unsigned slot_index = (unsigned)cqe->user_data;
+        int res = cqe->res;
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        uring_handle_cqe(engine, slot_index, res);
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    }
+    return 1;
+}
+
+#endif // HAVE_IO_URING
+
+// 创建引擎；IO_BACKEND_SYNC返回NULL
+ IoEngine* io_engine_create(IoBackend backend, unsigned depth) {
+    if (backend == IO_BACKEND_SYNC) {
+        return NULL;
+    }
+    if (depth == 0) {
+        depth = IO_ENGINE_DEFAULT_DEPTH;
+    }
+
+    IoEngine *engine = calloc(1, sizeof(IoEngine));
+    if (!engine) return NULL;
+
+    engine->depth = depth;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->completed, NULL);
+
+#ifdef HAVE_IO_URING
+    engine->ring.ring_fd = -1;
+    if (backend == IO_BACKEND_URING) {
+        if (uring_init(&engine->ring, depth)) {
+            engine->backend = IO_BACKEND_URING;
+            return engine;
+        }
+        // 内核不支持时退回线程池
+    }
+#endif
+
+    engine->pool = thread_pool_create(0);
+    if (!engine->pool) {
+        pthread_mutex_destroy(&engine->lock);
+        pthread_cond_destroy(&engine->completed);
+        free(engine);
+        return NULL;
+    }
+    engine->backend = IO_BACKEND_THREADS;
+    return engine;
+}
+
+// 实际使用的后端
+ IoBackend io_engine_backend(const IoEngine *engine) {
+    return engine ? engine->backend : IO_BACKEND_SYNC;
+}
+
+// 在途请求数
+ unsigned io_engine_inflight(const IoEngine *engine) {
+    return engine ? engine->inflight : 0;
+}
+
+// 提交请求；队列满时先处理完成事件腾出位置
+ int io_engine_submit(IoEngine *engine, IoRequest *req) {
+    req->done = 0;
+    req->result = 0;
+    req->error = 0;
+    req->next = NULL;
+    if (req->op == IO_OP_READ_FILE) {
+        req->fd = -1;
+        req->data = NULL;
+        req->buffer = NULL;
+        req->size = 0;
+    }
+
+#ifdef HAVE_IO_URING
+    if (engine->backend == IO_BACKEND_URING) {
+        UringRing *ring = &engine->ring;
+        while (ring->free_count == 0) {
+            if (!uring_process(engine, 1)) return 0;
+        }
+
+        unsigned slot_index = ring->free_slots[--ring->free_count];
+        UringSlot *slot = &ring->slots[slot_index];
+        slot->req = req;
+        slot->stage = STAGE_OPEN;
+        slot->fd = -1;
+        slot->offset = 0;
+        if (!uring_queue_stage(ring, slot_index)) {
+            slot->req = NULL;
+            ring->free_slots[ring->free_count++] = slot_index;
+            return 0;
+        }
+        engine->inflight++;
+        return 1;
+    }
+#endif
+
+    req->owner = engine;
+    if (!thread_pool_submit(engine->pool, thread_task, req)) {
+        return 0;
+    }
+    engine->inflight++;
+    return 1;
+}
+
+// 取回一个已完成的请求（必要时阻塞）；没有在途请求时返回NULL
+ IoRequest* io_engine_reap(IoEngine *engine) {
+    if (!engine || engine->inflight == 0) {
+        return NULL;
+    }
+
+    // 只统计真正阻塞等待的时间
+    IoRequest *req = NULL;
+    StatsMark mark;
+    mark.wall_ns = 0;
+#ifdef HAVE_IO_URING
+    if (engine->backend == IO_BACKEND_URING) {
+        while (!(req = pop_done(engine))) {
+            if (!mark.wall_ns) stats_begin(&mark);
+            if (!uring_process(engine, 1)) return NULL;
+        }
+        stats_end(STATS_IO_WAIT, &mark, 0, 0);
+        engine->inflight--;
+        req->done = 1;
+        return req;
+    }
+#endif
+
+    pthread_mutex_lock(&engine->lock);
+    while (!(req = pop_done(engine))) {
+        if (!mark.wall_ns) stats_begin(&mark);
+        pthread_cond_wait(&engine->completed, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    stats_end(STATS_IO_WAIT, &mark, 0, 0);
+
+    engine->inflight--;
+    req->done = 1;
+    return req;
+}
+
+// 销毁引擎（会等待在途请求完成）
+ void io_engine_destroy(IoEngine *engine) {
+    if (!engine) return;
+
+    while (engine->inflight > 0) {
+        IoRequest *req = io_engine_reap(engine);
+        if (!req) break;
+        if (req->op == IO_OP_READ_FILE) {
+            buffer_pool_release(req->buffer);
+            req->buffer = NULL;
+            req->data = NULL;
+            if (req->fd >= 0) close(req->fd);
+            req->fd = -1;
+        }
+    }
+
+    if (engine->pool) {
+        thread_pool_destroy(engine->pool);
+    }
+#ifdef HAVE_IO_URING
+    if (engine->backend == IO_BACKEND_URING) {
+        uring_unmap(&engine->ring);
+    }
+#endif
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->completed);
+    free(engine);
+}
@@ -0,0 +1,110 @@
+#include "../include/archiver.h"
+#include "../include/output_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 创建并截断path
+ OutputSink* output_sink_file(const char *path, mode_t mode) {
+    return output_sink_file_at(AT_FDCWD, path, mode);
+}
+
+// 相对目录fd创建并截断name（dir_fd为AT_FDCWD时同output_sink_file）
+ OutputSink* output_sink_file_at(int dir_fd, const char *name, mode_t mode) {
+    int fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd < 0) return NULL;
+    
+    OutputSink *sink = output_sink_fd(fd);
+    if (!sink) {
+        close(fd);
+        return NULL;
+    }
+    sink->type = OUTPUT_SINK_FILE;
+    sink->owns_fd = 1;
+    return sink;
+}
+
+// 包装已打开的fd（不接管，关闭输出端时不关闭）
+ OutputSink* output_sink_fd(int fd) {
+    OutputSink *sink = calloc(1, sizeof(OutputSink));
+    if (!sink) return NULL;
+    
+    sink->type = OUTPUT_SINK_FD;
+    sink->fd = fd;
+    return sink;
+}
+
+// 把数据交给回调
+ OutputSink* output_sink_callback(OutputSinkCallback callback, void *user) {
+    if (!callback) return NULL;
+    
+    OutputSink *sink = calloc(1, sizeof(OutputSink));
+    if (!sink) return NULL;
+    
+    sink->type = OUTPUT_SINK_CALLBACK;
+    sink->fd = -1;
+    sink->callback = callback;
+    sink->user = user;
+    return sink;
+}
+
+// 写入一段数据，返回1表示成功
+ int output_sink_write(OutputSink *sink, const uint8_t *data, size_t size) {
+    if (sink->error) return 0;
+    if (size == 0) return 1;
+    
+    int ok;
+    if (sink->type == OUTPUT_SINK_CALLBACK) {
+        ok = sink->callback(sink->user, data, size);
+        if (!ok) sink->error = ECANCELED;
+    } else {
+        ok = file_write_all(sink->fd, data, size);
+        if (!ok) sink->error = errno ? errno : EIO;
+    }
+    
+    if (ok) {
+        sink->written += size;
+    }
+    return ok;
+}
+
+// 写入size字节的零：文件输出端上只移动位置留下空洞，其余输出端写入零
+ int output_sink_hole(OutputSink *sink, uint64_t size) {
+    if (sink->error) return 0;
+    if (size == 0) return 1;
+    
+    if (sink->type == OUTPUT_SINK_FILE) {
+        if (lseek(sink->fd, (off_t)size, SEEK_CUR) < 0) {
+            sink->error = errno;
+            return 0;
+        }
+        sink->written += size;
+        sink->holes = 1;
+        return 1;
+    }
+    
+    static const uint8_t zeros[4096];
+    while (size > 0) {
+        size_t n = size < sizeof(zeros) ? (size_t)size : sizeof(zeros);
+        if (!output_sink_write(sink, zeros, n)) return 0;
+        size -= n;
+    }
+    return 1;
+}
+
+// 关闭输出端；返回1表示全部写入成功
+ int output_sink_close(OutputSink *sink) {
+    if (!sink) return 0;
+    
+    int ok = sink->error == 0;
+    // 末尾的空洞只移动了位置，按写到的位置设定文件大小
+    if (ok && sink->holes && ftruncate(sink->fd, (off_t)sink->written) != 0) {
+        ok = 0;
+    }
+    if (sink->owns_fd && close(sink->fd) != 0) {
+        ok = 0;
+    }
+    free(sink);
+    return ok;
+}
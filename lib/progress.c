@@ -0,0 +1,196 @@
+#include "../include/progress.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct ProgressTracker {
+    const char *operation;
+    ProgressCallback callback;
+    void *user;
+    uint64_t bytes_total;       // 原子
+    uint64_t members_total;     // 原子
+    uint64_t bytes_done;        // 原子
+    uint64_t members_done;      // 原子
+    uint64_t members_sized;     // 原子：bytes_total中已计入大小的成员数（0表示总量事先已知）
+    uint64_t start_ns;
+    uint64_t interval_ns;
+    uint64_t next_emit_ns;      // 原子：下一次允许回调的时间
+    pthread_mutex_t emit_lock;  // 回调互斥（取不到锁的线程跳过本次回调）
+    uint64_t last_bytes;        // 以下由持有emit_lock的线程更新
+    uint64_t last_ns;
+    double rate;
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+ProgressTracker* progress_create(const char *operation, uint64_t bytes_total, uint64_t members_total,
+                                 unsigned max_per_second, ProgressCallback callback, void *user) {
+    if (!callback) return NULL;
+    ProgressTracker *p = calloc(1, sizeof(ProgressTracker));
+    if (!p) return NULL;
+
+    p->operation = operation;
+    p->callback = callback;
+    p->user = user;
+    p->bytes_total = bytes_total;
+    p->members_total = members_total;
+    p->interval_ns = 1000000000ULL / (max_per_second ? max_per_second : PROGRESS_DEFAULT_RATE);
+    p->start_ns = monotonic_ns();
+    p->last_ns = p->start_ns;
+    p->next_emit_ns = p->start_ns + p->interval_ns;
+    pthread_mutex_init(&p->emit_lock, NULL);
+    return p;
+}
+
+void progress_add_total(ProgressTracker *p, uint64_t bytes, uint64_t members) {
+    if (!p) return;
+    __atomic_fetch_add(&p->bytes_total, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->members_total, members, __ATOMIC_RELAXED);
+}
+
+void progress_add_source(ProgressTracker *p, uint64_t bytes) {
+    if (!p) return;
+    __atomic_fetch_add(&p->bytes_total, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->members_sized, 1, __ATOMIC_RELAXED);
+}
+
+// 生成快照并回调（调用者持有emit_lock）
+static void emit(ProgressTracker *p, uint64_t now, const char *current, int finished) {
+    ProgressInfo info;
+    info.operation = p->operation;
+    info.current = current;
+    info.bytes_done = __atomic_load_n(&p->bytes_done, __ATOMIC_RELAXED);
+    info.bytes_total = __atomic_load_n(&p->bytes_total, __ATOMIC_RELAXED);
+    info.members_done = __atomic_load_n(&p->members_done, __ATOMIC_RELAXED);
+    info.members_total = __atomic_load_n(&p->members_total, __ATOMIC_RELAXED);
+    info.elapsed = (now - p->start_ns) / 1e9;
+    info.finished = finished;
+    uint64_t sized = __atomic_load_n(&p->members_sized, __ATOMIC_RELAXED);
+    if (!finished && sized > 0 && sized < info.members_total) {
+        // 还有成员的大小未知：按已知成员的平均大小估计总量
+        info.bytes_total = info.bytes_total * info.members_total / sized;
+    }
+    if (finished && info.bytes_total == 0 && info.members_total == 0) {
+        // 总量事先未知（如流），结束时就是已处理的量
+        info.bytes_total = info.bytes_done;
+        info.members_total = info.members_done;
+    }
+
+    // 速率取各回调间隔的指数平均，既不被开头的慢启动拖住，也不随单次间隔剧烈跳动
+    double dt = (now - p->last_ns) / 1e9;
+    if (dt > 0 && info.bytes_done >= p->last_bytes) {
+        double instant = (info.bytes_done - p->last_bytes) / dt;
+        p->rate = p->last_bytes == 0 ? instant : 0.7 * p->rate + 0.3 * instant;
+    }
+    p->last_bytes = info.bytes_done;
+    p->last_ns = now;
+    info.bytes_per_second = finished && info.elapsed > 0 ? info.bytes_done / info.elapsed : p->rate;
+
+    if (info.bytes_total > 0) {
+        uint64_t done = info.bytes_done < info.bytes_total ? info.bytes_done : info.bytes_total;
+        info.percent = (int)(done * 100 / info.bytes_total);
+        info.eta = finished ? 0 : p->rate > 0 ? (info.bytes_total - done) / p->rate : -1;
+    } else if (info.members_total > 0) {
+        // 全是空文件时按成员数计算
+        uint64_t done = info.members_done < info.members_total ? info.members_done : info.members_total;
+        info.percent = (int)(done * 100 / info.members_total);
+        info.eta = finished ? 0 : -1;
+    } else {
+        info.percent = finished ? 100 : -1;
+        info.eta = finished ? 0 : -1;
+    }
+    if (finished && info.percent >= 0) {
+        info.percent = 100;
+    }
+
+    p->callback(&info, p->user);
+}
+
+void progress_update(ProgressTracker *p, uint64_t bytes, uint64_t members, const char *current) {
+    if (!p) return;
+    if (bytes) __atomic_fetch_add(&p->bytes_done, bytes, __ATOMIC_RELAXED);
+    if (members) __atomic_fetch_add(&p->members_done, members, __ATOMIC_RELAXED);
+
+    uint64_t now = monotonic_ns();
+    uint64_t next = __atomic_load_n(&p->next_emit_ns, __ATOMIC_RELAXED);
+    if (now < next) return;
+    // 只有把下一次回调时间推后的线程负责本次回调
+    if (!__atomic_compare_exchange_n(&p->next_emit_ns, &next, now + p->interval_ns, 0,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (pthread_mutex_trylock(&p->emit_lock) != 0) return;
+    emit(p, now, current, 0);
+    pthread_mutex_unlock(&p->emit_lock);
+}
+
+void progress_finish(ProgressTracker *p) {
+    if (!p) return;
+    pthread_mutex_lock(&p->emit_lock);
+    emit(p, monotonic_ns(), NULL, 1);
+    pthread_mutex_unlock(&p->emit_lock);
+    pthread_mutex_destroy(&p->emit_lock);
+    free(p);
+}
+
+// 以1024为进制格式化字节数
+static void format_bytes(char *out, size_t size, double bytes) {
+    static const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    int u = 0;
+    while (bytes >= 1024 && u < 4) {
+        bytes /= 1024;
+        u++;
+    }
+    snprintf(out, size, u == 0 ? "%.0f %s" : "%.1f %s", bytes, units[u]);
+}
+
+static void format_duration(char *out, size_t size, double seconds) {
+    if (seconds < 0) {
+        snprintf(out, size, "--:--");
+        return;
+    }
+    unsigned long s = (unsigned long)(seconds + 0.5);
+    if (s >= 3600) {
+        snprintf(out, size, "%lu:%02lu:%02lu", s / 3600, s / 60 % 60, s % 60);
+    } else {
+        snprintf(out, size, "%02lu:%02lu", s / 60, s % 60);
+    }
+}
+
+void progress_print(const ProgressInfo *info, void *user) {
+    FILE *out = user ? user : stderr;
+    char done[16], total[16], rate[16], eta[32];
+    format_bytes(done, sizeof(done), (double)info->bytes_done);
+    format_bytes(total, sizeof(total), (double)info->bytes_total);
+    format_bytes(rate, sizeof(rate), info->bytes_per_second);
+    format_duration(eta, sizeof(eta), info->finished ? info->elapsed : info->eta);
+
+    char line[160];
+    int n;
+    if (info->percent >= 0) {
+        n = snprintf(line, sizeof(line), "%s %3d%% %s/%s %s/s %s %s", info->operation, info->percent,
+                     done, total, rate, info->finished ? "in" : "ETA", eta);
+    } else {
+        n = snprintf(line, sizeof(line), "%s %s %s/s", info->operation, done, rate);
+    }
+    if (n > 0 && (size_t)n < sizeof(line) && !info->finished && info->current) {
+        // 成员名只显示结尾部分，整行不超过80列
+        const char *name = info->current;
+        size_t room = n + 2 < 79 ? 79 - (n + 2) : 0;
+        size_t len = strlen(name);
+        if (len <= room) {
+            snprintf(line + n, sizeof(line) - n, "  %s", name);
+        } else if (room > 8) {
+            snprintf(line + n, sizeof(line) - n, "  ...%s", name + len - (room - 3));
+        }
+    }
+    // 用空格覆盖上一行剩余的部分
+    fprintf(out, "\r%-79.79s%s", line, info->finished ? "\n" : "");
+    fflush(out);
+}
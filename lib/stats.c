@@ -0,0 +1,172 @@
+#include "../include/stats.h"
+#include "../include/trace.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// 每个线程一个计数块，首次记录时分配并挂到全局链表上。线程退出后计数块保留
+// （线程池的线程可能先于汇总退出），数量等于用过统计的线程数。
+// 计数块只由所属线程写入，汇总时用relaxed原子读取，不需要加锁。
+
+typedef struct StatsBlock {
+    StatsCounter counters[STATS_PHASE_COUNT];
+    struct StatsBlock *next;
+} StatsBlock;
+
+int stats_enabled = 0;
+
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static StatsBlock *blocks;
+static __thread StatsBlock *thread_block;
+
+static const char *phase_names[STATS_PHASE_COUNT] = {
+    "stat", "read", "checksum", "compress", "decompress",
+    "encrypt", "decrypt", "write", "mkdir", "alloc", "io-wait",
+};
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static StatsBlock* current_block(void) {
+    if (thread_block) return thread_block;
+
+    StatsBlock *block = calloc(1, sizeof(StatsBlock));
+    if (!block) return NULL;
+    pthread_mutex_lock(&blocks_lock);
+    block->next = blocks;
+    blocks = block;
+    pthread_mutex_unlock(&blocks_lock);
+    thread_block = block;
+    return block;
+}
+
+void stats_enable(int enabled) {
+    stats_enabled = enabled;
+}
+
+const char* stats_phase_name(StatsPhase phase) {
+    return phase < STATS_PHASE_COUNT ? phase_names[phase] : "unknown";
+}
+
+void stats_mark_now(StatsMark *mark) {
+    mark->wall_ns = clock_ns(CLOCK_MONOTONIC);
+    mark->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+#define STATS_ADD(field, n) \
+    __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+static void stats_add(StatsPhase phase, uint64_t wall_ns, uint64_t cpu_ns,
+                      uint64_t bytes_in, uint64_t bytes_out) {
+    StatsBlock *block = phase < STATS_PHASE_COUNT ? current_block() : NULL;
+    if (!block) return;
+
+    StatsCounter *c = &block->counters[phase];
+    STATS_ADD(c->calls, 1);
+    STATS_ADD(c->wall_ns, wall_ns);
+    STATS_ADD(c->cpu_ns, cpu_ns);
+    STATS_ADD(c->bytes_in, bytes_in);
+    STATS_ADD(c->bytes_out, bytes_out);
+}
+
+void stats_record(StatsPhase phase, const StatsMark *start, uint64_t bytes_in, uint64_t bytes_out) {
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    stats_add(phase, now - start->wall_ns,
+              clock_ns(CLOCK_THREAD_CPUTIME_ID) - start->cpu_ns, bytes_in, bytes_out);
+    if (trace_enabled && phase < STATS_PHASE_COUNT) {
+        trace_record(phase_names[phase], start->wall_ns, now);
+    }
+}
+
+void stats_count(StatsPhase phase, uint64_t bytes_in, uint64_t bytes_out) {
+    stats_add(phase, 0, 0, bytes_in, bytes_out);
+}
+
+void stats_reset(void) {
+    pthread_mutex_lock(&blocks_lock);
+    for (StatsBlock *b = blocks; b; b = b->next) {
+        for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+            StatsCounter *c = &b->counters[p];
+            __atomic_store_n(&c->calls, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->wall_ns, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->cpu_ns, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->bytes_in, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->bytes_out, 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&blocks_lock);
+}
+
+void stats_snapshot(StatsCounter counters[STATS_PHASE_COUNT]) {
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        counters[p] = (StatsCounter){ 0, 0, 0, 0, 0 };
+    }
+    pthread_mutex_lock(&blocks_lock);
+    for (StatsBlock *b = blocks; b; b = b->next) {
+        for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+            StatsCounter *c = &b->counters[p];
+            counters[p].calls += __atomic_load_n(&c->calls, __ATOMIC_RELAXED);
+            counters[p].wall_ns += __atomic_load_n(&c->wall_ns, __ATOMIC_RELAXED);
+            counters[p].cpu_ns += __atomic_load_n(&c->cpu_ns, __ATOMIC_RELAXED);
+            counters[p].bytes_in += __atomic_load_n(&c->bytes_in, __ATOMIC_RELAXED);
+            counters[p].bytes_out += __atomic_load_n(&c->bytes_out, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&blocks_lock);
+}
+
+// 整个进程（所有线程）已用的CPU时间
+static double process_cpu_seconds(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void stats_print(FILE *out, const char *operation, double wall_seconds) {
+    StatsCounter counters[STATS_PHASE_COUNT];
+    stats_snapshot(counters);
+
+    fprintf(out, "Stats for %s: %.3f s wall, %.3f s CPU\n", operation, wall_seconds,
+            process_cpu_seconds());
+    fprintf(out, "%-11s %10s %10s %10s %12s %12s %10s\n",
+            "phase", "calls", "wall(s)", "cpu(s)", "in(MB)", "out(MB)", "MB/s");
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        const StatsCounter *c = &counters[p];
+        if (c->calls == 0) continue;
+        double wall = c->wall_ns / 1e9;
+        double in = c->bytes_in / (1024.0 * 1024);
+        double out_mb = c->bytes_out / (1024.0 * 1024);
+        double moved = in > out_mb ? in : out_mb;
+        fprintf(out, "%-11s %10llu %10.3f %10.3f %12.2f %12.2f ", phase_names[p],
+                (unsigned long long)c->calls, wall, c->cpu_ns / 1e9, in, out_mb);
+        if (wall > 0 && moved > 0) {
+            fprintf(out, "%10.1f\n", moved / wall);
+        } else {
+            fprintf(out, "%10s\n", "-");
+        }
+    }
+    fprintf(out, "(phase times are summed over threads; alloc overlaps the other phases)\n");
+}
+
+int stats_write_json(FILE *out, const char *operation, double wall_seconds) {
+    StatsCounter counters[STATS_PHASE_COUNT];
+    stats_snapshot(counters);
+
+    fprintf(out, "{\"operation\": \"%s\", \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"phases\": {",
+            operation, wall_seconds, process_cpu_seconds());
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        const StatsCounter *c = &counters[p];
+        fprintf(out, "%s\"%s\": {\"calls\": %llu, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, "
+                "\"bytes_in\": %llu, \"bytes_out\": %llu}", p ? ", " : "", phase_names[p],
+                (unsigned long long)c->calls, c->wall_ns / 1e9, c->cpu_ns / 1e9,
+                (unsigned long long)c->bytes_in, (unsigned long long)c->bytes_out);
+    }
+    fprintf(out, "}}\n");
+    return !ferror(out);
+}
@@ -0,0 +1,151 @@
+#include "../include/thread_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define THREAD_POOL_MAX_THREADS 64
+
+// 任务节点
+typedef struct PoolTask {
+    ThreadTask func;
+    void *arg;
+    struct PoolTask *next;
+} PoolTask;
+
+struct ThreadPool {
+    pthread_t *threads;
+    int thread_count;
+    PoolTask *head;
+    PoolTask *tail;
+    int pending;           // 队列中 + 正在执行的任务数
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work;
+    pthread_cond_t all_done;
+};
+
+// 工作线程主循环
+static void* pool_worker(void *arg) {
+    ThreadPool *pool = arg;
+    
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->stopping) {
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        }
+        if (!pool->head && pool->stopping) {
+            break;
+        }
+        
+        PoolTask *task = pool->head;
+        pool->head = task->next;
+        if (!pool->head) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+        
+        task->func(task->arg);
+        free(task);
+        
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_broadcast(&pool->all_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// 创建线程池（threads <= 0 时使用在线CPU数）
+ ThreadPool* thread_pool_create(int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > THREAD_POOL_MAX_THREADS) {
+        threads = THREAD_POOL_MAX_THREADS;
+    }
+    
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    
+    pool->threads = calloc(threads, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_work, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+    
+    if (pool->thread_count == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    
+    return pool;
+}
+
+// 提交任务（队列无上限，不会阻塞）
+ int thread_pool_submit(ThreadPool *pool, ThreadTask task, void *arg) {
+    PoolTask *node = malloc(sizeof(PoolTask));
+    if (!node) return 0;
+    
+    node->func = task;
+    node->arg = arg;
+    node->next = NULL;
+    
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) {
+        pool->tail->next = node;
+    } else {
+        pool->head = node;
+    }
+    pool->tail = node;
+    pool->pending++;
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    
+    return 1;
+}
+
+// 等待所有已提交的任务完成
+ void thread_pool_wait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 停止并销毁线程池（会先完成剩余任务）
+ void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->threads);
+    free(pool);
+}
+
+// 线程池中的线程数
+ int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->thread_count : 0;
+}
@@ -0,0 +1,224 @@
+#include "../include/trace.h"
+#include "../include/stats.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// 一个事件；stage为NULL表示覆盖整个成员的事件
+typedef struct {
+    const char *stage;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    char member[TRACE_MEMBER_MAX];
+} TraceEvent;
+
+// 每个线程的环形缓冲区，只由所属线程写入
+typedef struct TraceRing {
+    TraceEvent *events;
+    uint64_t written;              // 累计写入的事件数（超过容量的部分已被覆盖）
+    long tid;
+    char thread_name[32];
+    char member[TRACE_MEMBER_MAX]; // 正在处理的成员
+    uint64_t member_start;
+    int in_member;
+    struct TraceRing *next;
+} TraceRing;
+
+int trace_enabled = 0;
+
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing *rings;
+static __thread TraceRing *thread_ring;
+static char *trace_path;
+static uint64_t trace_origin;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 复制成员名；超长时保留结尾（文件名比前面的目录更有用）
+static void copy_member(char *dst, const char *name) {
+    size_t len = strlen(name);
+    if (len >= TRACE_MEMBER_MAX) {
+        name += len - (TRACE_MEMBER_MAX - 1);
+        len = TRACE_MEMBER_MAX - 1;
+    }
+    memcpy(dst, name, len);
+    dst[len] = '\0';
+}
+
+static TraceRing* current_ring(void) {
+    if (thread_ring) return thread_ring;
+
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    // 大块calloc按页按需分配，只有实际写到的部分占用内存
+    ring->events = calloc(TRACE_RING_EVENTS, sizeof(TraceEvent));
+    if (!ring->events) {
+        free(ring);
+        return NULL;
+    }
+    ring->tid = (long)syscall(SYS_gettid);
+    if (ring->tid == (long)getpid()) {
+        strcpy(ring->thread_name, "main");
+    } else if (pthread_getname_np(pthread_self(), ring->thread_name, sizeof(ring->thread_name)) != 0 ||
+               !ring->thread_name[0]) {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "thread %ld", ring->tid);
+    }
+
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+    thread_ring = ring;
+    return ring;
+}
+
+static void push_event(TraceRing *ring, const char *stage, uint64_t start_ns, uint64_t end_ns,
+                       const char *member) {
+    TraceEvent *ev = &ring->events[ring->written % TRACE_RING_EVENTS];
+    ev->stage = stage;
+    ev->start_ns = start_ns;
+    ev->end_ns = end_ns;
+    strcpy(ev->member, member);
+    __atomic_store_n(&ring->written, ring->written + 1, __ATOMIC_RELEASE);
+}
+
+static void finish_at_exit(void) {
+    trace_finish();
+}
+
+int trace_start(const char *path) {
+    if (!path || !*path) return 0;
+    if (trace_enabled) return 1;
+
+    // 先确认能写入，避免运行结束才发现路径无效
+    FILE *out = fopen(path, "w");
+    if (!out) return 0;
+    fclose(out);
+
+    trace_path = strdup(path);
+    if (!trace_path) return 0;
+    trace_origin = monotonic_ns();
+    trace_enabled = 1;
+    stats_enabled = 1;
+
+    static int registered = 0;
+    if (!registered) {
+        atexit(finish_at_exit);
+        registered = 1;
+    }
+    return 1;
+}
+
+void trace_record(const char *stage, uint64_t start_ns, uint64_t end_ns) {
+    if (!trace_enabled) return;
+    TraceRing *ring = current_ring();
+    if (!ring) return;
+    push_event(ring, stage, start_ns, end_ns, ring->in_member ? ring->member : "");
+}
+
+int trace_member_begin(const char *name) {
+    if (!trace_enabled || !name) return 0;
+    TraceRing *ring = current_ring();
+    if (!ring || ring->in_member) return 0;
+    copy_member(ring->member, name);
+    ring->member_start = monotonic_ns();
+    ring->in_member = 1;
+    return 1;
+}
+
+void trace_member_end(void) {
+    TraceRing *ring = thread_ring;
+    if (!ring || !ring->in_member) return;
+    if (trace_enabled) {
+        push_event(ring, NULL, ring->member_start, monotonic_ns(), ring->member);
+    }
+    ring->in_member = 0;
+}
+
+// 输出JSON字符串（转义引号、反斜杠和控制字符）
+static void write_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_event(FILE *out, int pid, const TraceRing *ring, const TraceEvent *ev, int *first) {
+    // 时间单位为微秒，相对trace_start
+    double ts = ev->start_ns > trace_origin ? (ev->start_ns - trace_origin) / 1000.0 : 0;
+    double dur = ev->end_ns > ev->start_ns ? (ev->end_ns - ev->start_ns) / 1000.0 : 0;
+
+    fprintf(out, "%s\n{\"ph\": \"X\", \"pid\": %d, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f, ",
+            *first ? "" : ",", pid, ring->tid, ts, dur);
+    *first = 0;
+    if (ev->stage) {
+        fprintf(out, "\"cat\": \"stage\", \"name\": \"%s\"", ev->stage);
+        if (ev->member[0]) {
+            fprintf(out, ", \"args\": {\"member\": ");
+            write_json_string(out, ev->member);
+            fputc('}', out);
+        }
+    } else {
+        fprintf(out, "\"cat\": \"member\", \"name\": ");
+        write_json_string(out, ev->member);
+    }
+    fputc('}', out);
+}
+
+int trace_finish(void) {
+    if (!trace_enabled) return 1;
+    trace_enabled = 0;
+
+    FILE *out = fopen(trace_path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write trace to %s\n", trace_path);
+        return 0;
+    }
+
+    int pid = (int)getpid();
+    int first = 1;
+    uint64_t dropped = 0;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    pthread_mutex_lock(&rings_lock);
+    for (TraceRing *ring = rings; ring; ring = ring->next) {
+        fprintf(out, "%s\n{\"ph\": \"M\", \"pid\": %d, \"tid\": %ld, \"name\": \"thread_name\", "
+                "\"args\": {\"name\": ", first ? "" : ",", pid, ring->tid);
+        write_json_string(out, ring->thread_name);
+        fprintf(out, "}}");
+        first = 0;
+
+        uint64_t written = __atomic_load_n(&ring->written, __ATOMIC_ACQUIRE);
+        uint64_t begin = written > TRACE_RING_EVENTS ? written - TRACE_RING_EVENTS : 0;
+        dropped += begin;
+        for (uint64_t i = begin; i < written; i++) {
+            write_event(out, pid, ring, &ring->events[i % TRACE_RING_EVENTS], &first);
+        }
+    }
+    pthread_mutex_unlock(&rings_lock);
+    fprintf(out, "\n], \"otherData\": {\"dropped_events\": %llu}}\n", (unsigned long long)dropped);
+
+    int ok = !ferror(out);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Cannot write trace to %s\n", trace_path);
+    }
+    return ok;
+}
@@ -0,0 +1,86 @@
+#include "../include/archiver.h"
+
+// 共享数据的条目查找表：开放寻址哈希，键为两个64位数。
+// 创建时以(dev, ino)为键识别同一文件的其他硬链接；复制成员、解压和校验时以数据位置为键，
+// 找到与硬链接条目共享数据的原条目。
+
+// 数据位置键的标记位，与(dev, ino)键区分（复制和追加文件可能用同一张表）
+#define LINK_KEY_DATA  (1ULL << 63)
+#define LINK_KEY_SOLID (1ULL << 62)
+
+static uint64_t link_hash(uint64_t a, uint64_t b) {
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL ^ b;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
+
+// 在表中查找键所在的槽，不存在时返回应插入的空槽
+static LinkSlot* find_slot(LinkSlot *slots, uint32_t capacity, uint64_t a, uint64_t b) {
+    uint32_t pos = (uint32_t)link_hash(a, b) & (capacity - 1);
+    while (slots[pos].entry && (slots[pos].key_a != a || slots[pos].key_b != b)) {
+        pos = (pos + 1) & (capacity - 1);
+    }
+    return &slots[pos];
+}
+
+// 扩容到原来的两倍（负载不超过一半）
+static int grow_links(ArchiveFile *af) {
+    uint32_t capacity = af->link_capacity ? af->link_capacity * 2 : 64;
+    LinkSlot *slots = calloc(capacity, sizeof(LinkSlot));
+    if (!slots) return 0;
+
+    for (uint32_t i = 0; i < af->link_capacity; i++) {
+        const LinkSlot *old = &af->links[i];
+        if (old->entry) {
+            *find_slot(slots, capacity, old->key_a, old->key_b) = *old;
+        }
+    }
+    free(af->links);
+    af->links = slots;
+    af->link_capacity = capacity;
+    return 1;
+}
+
+int archive_link_add(ArchiveFile *af, uint64_t key_a, uint64_t key_b, uint32_t entry) {
+    if ((af->link_count + 1) * 2 > af->link_capacity && !grow_links(af)) {
+        return 0;
+    }
+
+    LinkSlot *slot = find_slot(af->links, af->link_capacity, key_a, key_b);
+    if (!slot->entry) {
+        af->link_count++;
+    }
+    slot->key_a = key_a;
+    slot->key_b = key_b;
+    slot->entry = entry + 1;
+    return 1;
+}
+
+int archive_link_find(const ArchiveFile *af, uint64_t key_a, uint64_t key_b, uint32_t *entry) {
+    if (af->link_count == 0) return 0;
+
+    const LinkSlot *slot = find_slot(af->links, af->link_capacity, key_a, key_b);
+    if (!slot->entry) return 0;
+    *entry = slot->entry - 1;
+    return 1;
+}
+
+void archive_links_free(ArchiveFile *af) {
+    free(af->links);
+    af->links = NULL;
+    af->link_count = 0;
+    af->link_capacity = 0;
+}
+
+// 条目数据位置的键：数据相同的条目（硬链接与其原条目）键相同。
+// 空文件的偏移可能与下一个成员相同，键中包含大小以免混淆
+void archive_entry_data_key(const FileEntry *entry, uint64_t *key_a, uint64_t *key_b) {
+    if (entry->flags & FLAG_SOLID) {
+        *key_a = LINK_KEY_DATA | LINK_KEY_SOLID | entry->file_size;
+        *key_b = ((uint64_t)entry->block_index << 32) | entry->block_offset;
+    } else {
+        *key_a = LINK_KEY_DATA | entry->file_size;
+        *key_b = entry->offset;
+    }
+}
@@ -0,0 +1,196 @@
+#include "../include/archiver.h"
+
+// 成员读取句柄：只解码读取范围涉及的数据。
+// 分块成员一次缓存一个解码后的块；未编码的成员直接按偏移读取；
+// 其他成员（小文件、固实块内的文件、旧版本归档）首次读取时整体解码。
+
+struct ArchiveMember {
+    ArchiveFile *af;
+    FileEntry entry;
+    char *password;
+    uint64_t pos;             // 当前位置
+    ChunkEntry *chunks;       // 块表（FLAG_CHUNKED）
+    MemoryBuffer *cache;      // 当前解码的块，或整体解码的成员内容
+    uint32_t cached_chunk;    // 缓存的块序号（UINT32_MAX表示没有）
+    int direct;               // 数据未压缩未加密，直接读取
+};
+
+// 打开归档中的成员（按完整路径查找），失败返回NULL
+ArchiveMember* archive_member_open(const char *archive, const char *path, const char *password) {
+    if (!archive || !path) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ArchiveFile *af = open_archive_file(archive, "rb");
+    if (!af) return NULL;
+
+    // 有文件名索引时只读取命中的条目页
+    FileEntry found;
+    const FileEntry *entry = &found;
+    if (!archive_find_entry(af, path, &found, NULL) ||
+        (entry->flags & (FLAG_DIRECTORY | FLAG_SYMLINK))) {
+        close_archive_file(af);
+        errno = ENOENT;
+        return NULL;
+    }
+
+    ArchiveMember *member = calloc(1, sizeof(ArchiveMember));
+    if (!member) {
+        close_archive_file(af);
+        return NULL;
+    }
+    member->af = af;
+    member->entry = *entry;
+    member->cached_chunk = UINT32_MAX;
+    member->password = (password && *password) ? strdup(password) : NULL;
+    member->direct = !(entry->flags & (FLAG_COMPRESSED | FLAG_ENCRYPTED | FLAG_SOLID |
+                                       FLAG_DICT | FLAG_CHUNKED));
+
+    if (entry->flags & FLAG_CHUNKED) {
+        member->chunks = load_chunk_table(af, entry);
+        if (!member->chunks) {
+            archive_member_close(member);
+            errno = EIO;
+            return NULL;
+        }
+    }
+    return member;
+}
+
+// 确保offset所在的数据已解码到缓存，返回缓存中对应的位置
+static const uint8_t* member_data_at(ArchiveMember *member, uint64_t offset, size_t *available) {
+    const FileEntry *entry = &member->entry;
+
+    if (member->chunks) {
+        uint32_t index = offset / entry->chunk_size;
+        if (member->cached_chunk != index) {
+            MemoryBuffer *chunk = NULL;
+            if (!decode_member_chunk(member->af, entry, member->chunks, index,
+                                     member->password, &chunk)) {
+                return NULL;
+            }
+            buffer_pool_release(member->cache);
+            member->cache = chunk;
+            member->cached_chunk = index;
+        }
+        size_t in_chunk = offset - (uint64_t)index * entry->chunk_size;
+        *available = member->cache->size - in_chunk;
+        return member->cache->buffer + in_chunk;
+    }
+
+    if (!member->cache) {
+        MemoryBuffer *data = NULL;
+        if (!decode_file_from_archive(member->af, entry, member->password, &data)) {
+            return NULL;
+        }
+        member->cache = data;
+    }
+    *available = member->cache->size - offset;
+    return member->cache->buffer + offset;
+}
+
+// 从指定偏移读取，不改变当前位置
+ssize_t archive_member_pread(ArchiveMember *member, void *buf, size_t size, uint64_t offset) {
+    if (!member || (!buf && size > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t file_size = member->entry.file_size;
+    if (offset >= file_size || size == 0) return 0;
+    if (size > file_size - offset) {
+        size = file_size - offset;
+    }
+
+    // 未编码的数据直接从归档读取
+    if (member->direct) {
+        int fd = fileno(member->af->fp);
+        StatsMark mark;
+        stats_begin(&mark);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = pread(fd, (uint8_t *)buf + done, size - done,
+                              member->entry.offset + offset + done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (n == 0) {
+                errno = EIO;
+                return -1;
+            }
+            done += n;
+        }
+        stats_end(STATS_READ, &mark, done, done);
+        return done;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        size_t available = 0;
+        const uint8_t *data = member_data_at(member, offset + done, &available);
+        if (!data) {
+            errno = EIO;
+            return -1;
+        }
+        size_t n = size - done < available ? size - done : available;
+        memcpy((uint8_t *)buf + done, data, n);
+        done += n;
+    }
+    return done;
+}
+
+// 从当前位置读取，返回读到的字节数，0表示到达末尾，-1表示出错（errno）
+ssize_t archive_member_read(ArchiveMember *member, void *buf, size_t size) {
+    ssize_t n = archive_member_pread(member, buf, size, member ? member->pos : 0);
+    if (n > 0) {
+        member->pos += n;
+    }
+    return n;
+}
+
+// 移动当前位置（SEEK_SET/SEEK_CUR/SEEK_END），返回新位置，出错返回-1
+int64_t archive_member_seek(ArchiveMember *member, int64_t offset, int whence) {
+    if (!member) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int64_t base;
+    switch (whence) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = member->pos; break;
+        case SEEK_END: base = member->entry.file_size; break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if (base + offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // 允许越过末尾，之后的读取返回0
+    member->pos = base + offset;
+    return member->pos;
+}
+
+// 成员原始大小
+uint64_t archive_member_size(const ArchiveMember *member) {
+    return member ? member->entry.file_size : 0;
+}
+
+// 关闭句柄
+void archive_member_close(ArchiveMember *member) {
+    if (!member) return;
+
+    buffer_pool_release(member->cache);
+    free(member->chunks);
+    if (member->password) {
+        memset(member->password, 0, strlen(member->password));
+        free(member->password);
+    }
+    close_archive_file(member->af);
+    free(member);
+}
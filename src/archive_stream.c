@@ -0,0 +1,504 @@
+#include "../include/archiver.h"
+#include "../include/encrypt.h"
+
+// 流格式归档：只做顺序读写，可以直接写入管道或从管道读取。
+// 每个成员的数据分成不超过STREAM_CHUNK_SIZE的块独立压缩、加密，
+// 大小和CRC32写在数据之后，因此两个方向的内存占用都与文件大小无关。
+
+// 单个数据块存储大小的上限（压缩膨胀 + 加密填充）
+#define STREAM_STORED_MAX (compressBound(STREAM_CHUNK_SIZE) + 16 + AES_BLOCK_SIZE)
+
+// 顺序扫描时对每个成员的处理方式
+typedef enum {
+    STREAM_EXTRACT,   // 解码并写入文件
+    STREAM_VERIFY,    // 解码并校验CRC32
+    STREAM_LIST,      // 只读取块头，跳过数据
+    STREAM_TEST       // 同STREAM_LIST，但不输出（结构测试）
+} StreamMode;
+
+// 打开流格式归档："-"为stdin，普通文件只有头部带ARCHIVE_FLAG_STREAM时才返回
+ FILE* archive_stream_open(const char *archive) {
+    if (strcmp(archive, ARCHIVE_STREAM_NAME) == 0) {
+        return stdin;
+    }
+
+    FILE *fp = fopen(archive, "rb");
+    if (!fp) return NULL;
+
+    ArchiveHeader header;
+    if (fread(&header, sizeof(ArchiveHeader), 1, fp) != 1 ||
+        header.magic != ARCHIVE_MAGIC || !(header.flags & ARCHIVE_FLAG_STREAM)) {
+        fclose(fp);
+        return NULL;
+    }
+    rewind(fp);
+    return fp;
+}
+
+// 关闭archive_stream_open打开的归档（不关闭stdin）
+ void archive_stream_close(FILE *fp) {
+    if (fp && fp != stdin) {
+        fclose(fp);
+    }
+}
+
+// 以流格式写入一个已打开的文件；数据写出后才出错时在尾部记录errno
+static int write_stream_member(ArchiveContext *ctx, ArchiveWriter *writer, int fd,
+                               const char *filename, const FileInfo *info,
+                               MemoryBuffer *chunk) {
+    FileEntry entry;
+    memset(&entry, 0, sizeof(FileEntry));
+    strncpy(entry.filename, filename, sizeof(entry.filename) - 1);
+    entry.file_size = info->size;    // 仅作提示，以尾部为准
+    entry.mtime = info->mtime;
+    entry.atime = info->atime;
+    entry.mode = info->mode;
+
+    if (!archive_writer_write(writer, &entry, sizeof(FileEntry))) {
+        return 0;
+    }
+
+    StreamTrailer trailer;
+    memset(&trailer, 0, sizeof(StreamTrailer));
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+
+    for (;;) {
+        ssize_t n = file_read_some(fd, chunk->buffer, STREAM_CHUNK_SIZE);
+        if (n < 0) {
+            trailer.status = errno ? errno : EIO;
+            break;
+        }
+        if (n == 0) break;
+
+        StreamChunk header;
+        memset(&header, 0, sizeof(StreamChunk));
+        header.raw_size = n;
+
+        MemoryBuffer *scratch = NULL;
+        const uint8_t *stored = NULL;
+        size_t stored_size = 0;
+        if (!encode_data(chunk->buffer, n, ctx->compression_level, NULL, 0, ctx->password,
+                         &scratch, &stored, &stored_size, &header.flags)) {
+            trailer.status = EIO;
+            break;
+        }
+        header.stored_size = stored_size;
+
+        int ok = archive_writer_write(writer, &header, sizeof(StreamChunk)) &&
+                 archive_writer_write(writer, stored, stored_size);
+        buffer_pool_release(scratch);
+        if (!ok) return 0;
+
+        crc = update_crc32(crc, chunk->buffer, n);
+        trailer.file_size += n;
+        trailer.chunk_count++;
+        progress_update(ctx->progress, n, 0, filename);
+    }
+
+    // 结束块 + 尾部
+    StreamChunk end;
+    memset(&end, 0, sizeof(StreamChunk));
+    trailer.crc32 = crc;
+    if (!archive_writer_write(writer, &end, sizeof(StreamChunk)) ||
+        !archive_writer_write(writer, &trailer, sizeof(StreamTrailer))) {
+        return 0;
+    }
+
+    if (trailer.status != 0) {
+        fprintf(stderr, "Read error in %s: %s\n", filename, strerror(trailer.status));
+        return -1;
+    }
+    return 1;
+}
+
+// 以流格式把文件写入已打开的fd（如stdout）
+ int archive_create_stream(ArchiveContext *ctx, int out_fd, char **files, int count) {
+    if (!ctx || !files || count <= 0) {
+        report_error(ctx, "Invalid parameters for create");
+        return ARCHIVE_ERROR_INVALID;
+    }
+
+    if (!ctx->write_buffer) {
+        ctx->write_buffer = archive_writer_buffer_create(ARCHIVE_WRITER_BUFFER_SIZE);
+    }
+    ArchiveWriter *writer = archive_writer_attach(out_fd, ctx->write_buffer);
+    MemoryBuffer *chunk = buffer_pool_acquire(STREAM_CHUNK_SIZE);
+    if (!writer || !chunk) {
+        if (writer) archive_writer_close(writer);
+        buffer_pool_release(chunk);
+        report_error(ctx, "Out of memory");
+        return ARCHIVE_ERROR_MEMORY;
+    }
+
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(ArchiveHeader));
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_FORMAT_VERSION;
+    header.header_size = sizeof(ArchiveHeader);
+    header.create_time = time(NULL);
+    header.flags = ARCHIVE_FLAG_STREAM;
+    int ok = archive_writer_write(writer, &header, sizeof(ArchiveHeader));
+
+    archive_progress_begin(ctx, "create", 0, count);
+
+    int success_count = 0;
+    int missing_count = 0;
+    for (int i = 0; ok && i < count; i++) {
+        FileInfo info;
+        int fd = file_open_info(files[i], &info);
+        progress_add_source(ctx->progress, fd >= 0 && S_ISREG(info.mode) ? info.size : 0);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                report_error(ctx, "File does not exist");
+                missing_count++;
+            }
+            fprintf(stderr, "Failed to write file: %s\n", files[i]);
+            progress_update(ctx->progress, 0, 1, files[i]);
+            continue;
+        }
+        if (!S_ISREG(info.mode)) {
+            fprintf(stderr, "Not a regular file, skipped: %s\n", files[i]);
+            progress_update(ctx->progress, 0, 1, files[i]);
+            close(fd);
+            continue;
+        }
+
+        int ret = write_stream_member(ctx, writer, fd, files[i], &info, chunk);
+        if (ctx->drop_cache) {
+            file_drop_cache(fd);
+        }
+        close(fd);
+        progress_update(ctx->progress, 0, 1, files[i]);
+        if (ret == 0) {
+            ok = 0;
+        } else if (ret > 0) {
+            success_count++;
+        }
+    }
+
+    // 文件名为空的条目表示归档结束
+    FileEntry end;
+    memset(&end, 0, sizeof(FileEntry));
+    if (ok) {
+        ok = archive_writer_write(writer, &end, sizeof(FileEntry));
+    }
+    if (!archive_writer_close(writer)) {
+        ok = 0;
+    }
+    buffer_pool_release(chunk);
+
+    archive_progress_end(ctx);
+
+    if (!ok) {
+        report_error(ctx, "Failed to write archive stream");
+        return ARCHIVE_ERROR_WRITE;
+    }
+    if (success_count == 0) {
+        return missing_count == count ? ARCHIVE_ERROR_NOT_FOUND : ARCHIVE_ERROR_WRITE;
+    } else if (success_count < count) {
+        fprintf(stderr, "Warning: Only %d of %d files were archived\n", success_count, count);
+    }
+    return ARCHIVE_OK;
+}
+
+// 读取流中的一个成员；返回0表示流已损坏或截断（无法继续），
+// *member_ok表示该成员是否完整解码（以及写入）
+static int read_stream_member(FILE *in, const FileEntry *entry, const char *password,
+                              StreamMode mode, OutputSink *out, StreamTrailer *trailer,
+                              uint64_t *stored_total, uint16_t *flags, int *member_ok) {
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    uint64_t raw_total = 0;
+    uint32_t chunks = 0;
+    int decoding = mode != STREAM_LIST && mode != STREAM_TEST;
+
+    *stored_total = 0;
+    *flags = 0;
+    *member_ok = 1;
+
+    for (;;) {
+        StreamChunk header;
+        if (fread(&header, sizeof(StreamChunk), 1, in) != 1) {
+            fprintf(stderr, "Truncated archive stream in %s\n", entry->filename);
+            return 0;
+        }
+        if (header.stored_size == 0) break;
+        if (header.raw_size == 0 || header.raw_size > STREAM_CHUNK_SIZE ||
+            header.stored_size > STREAM_STORED_MAX) {
+            fprintf(stderr, "Corrupted chunk header in %s\n", entry->filename);
+            return 0;
+        }
+
+        // 不解码时可定位的输入直接跳过数据；截断会在读取下一个块头时发现
+        if (mode == STREAM_TEST && fseek(in, header.stored_size, SEEK_CUR) == 0) {
+            *stored_total += header.stored_size;
+            *flags |= header.flags;
+            raw_total += header.raw_size;
+            chunks++;
+            continue;
+        }
+
+        MemoryBuffer *stored = buffer_pool_acquire(header.stored_size);
+        if (!stored) return 0;
+        if (fread(stored->buffer, 1, header.stored_size, in) != header.stored_size) {
+            fprintf(stderr, "Truncated archive stream in %s\n", entry->filename);
+            buffer_pool_release(stored);
+            return 0;
+        }
+        stored->size = header.stored_size;
+        *stored_total += header.stored_size;
+        *flags |= header.flags;
+        raw_total += header.raw_size;
+        chunks++;
+
+        // 已经失败的成员只需跳过剩余数据
+        if (!decoding) {
+            buffer_pool_release(stored);
+            continue;
+        }
+
+        MemoryBuffer *raw = NULL;
+        if (!decode_stored_buffer(stored, header.flags, header.raw_size, entry->filename,
+                                  password, NULL, 0, &raw)) {
+            decoding = 0;
+            *member_ok = 0;
+            continue;
+        }
+
+        crc = update_crc32(crc, raw->buffer, raw->size);
+        if (out && !output_sink_write(out, raw->buffer, raw->size)) {
+            fprintf(stderr, "Write failed for %s: %s\n", entry->filename, strerror(out->error));
+            decoding = 0;
+            *member_ok = 0;
+        }
+        buffer_pool_release(raw);
+    }
+
+    if (fread(trailer, sizeof(StreamTrailer), 1, in) != 1) {
+        fprintf(stderr, "Truncated archive stream in %s\n", entry->filename);
+        return 0;
+    }
+    if (trailer->file_size != raw_total || trailer->chunk_count != chunks) {
+        fprintf(stderr, "Corrupted member trailer: %s\n", entry->filename);
+        return 0;
+    }
+
+    if (trailer->status != 0) {
+        fprintf(stderr, "Incomplete member (source read error): %s\n", entry->filename);
+        *member_ok = 0;
+    } else if (decoding && crc != trailer->crc32) {
+        fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
+        *member_ok = 0;
+    }
+    return 1;
+}
+
+// 在缓存的上级目录中打开解压目标的临时文件（成员完整后才替换目标）
+static OutputSink* create_stream_output(DirCache *dirs, const FileEntry *entry,
+                                        int *dir_fd, const char **name,
+                                        char *temp, size_t temp_size) {
+    OutputSink *sink = NULL;
+    *dir_fd = dir_cache_parent(dirs, entry->filename, name);
+    if (*dir_fd >= 0 && extract_temp_path(*name, temp, temp_size)) {
+        sink = output_sink_file_at(*dir_fd, temp, 0644);
+    }
+    if (!sink) {
+        fprintf(stderr, "Cannot create file: %s\n", entry->filename);
+    } else if (entry->file_size >= PREALLOC_MIN_SIZE) {
+        // 流中的大小只是提示：预分配失败时照常写入，完成后按实际大小截断
+        file_preallocate(sink->fd, entry->file_size);
+    }
+    return sink;
+}
+
+// 恢复文件属性并关闭，成员完整时替换目标；成员不完整时删除半成品
+static int finish_stream_output(OutputSink *sink, const FileEntry *entry,
+                                int dir_fd, const char *name, const char *temp, int ok) {
+    if (ok && sink->written < entry->file_size &&
+        ftruncate(sink->fd, (off_t)sink->written) != 0) {
+        ok = 0;
+    }
+    if (ok) {
+        fchmod(sink->fd, entry->mode & 0777);
+        struct timespec times[2];
+        times[0].tv_sec = entry->atime;
+        times[0].tv_nsec = 0;
+        times[1].tv_sec = entry->mtime;
+        times[1].tv_nsec = 0;
+        futimens(sink->fd, times);
+    }
+    if (!output_sink_close(sink)) {
+        ok = 0;
+    }
+    return commit_extract_file(dir_fd, temp, name, ok);
+}
+
+// 顺序处理整个流：解压（到文件或共享的输出端）、校验或列出
+static int walk_stream(ArchiveContext *ctx, FILE *in, StreamMode mode,
+                       const char *dest, OutputSink *shared, const char *name) {
+    ArchiveHeader header;
+    if (fread(&header, sizeof(ArchiveHeader), 1, in) != 1 ||
+        header.magic != ARCHIVE_MAGIC || !(header.flags & ARCHIVE_FLAG_STREAM)) {
+        report_error(ctx, "Not a streamed archive");
+        return ARCHIVE_ERROR_INVALID;
+    }
+
+    // 解压到文件时缓存各级目录fd（目标目录不存在时创建）
+    DirCache *dirs = NULL;
+    if (mode == STREAM_EXTRACT && !shared) {
+        dirs = dir_cache_create(dest, DIR_CACHE_DEFAULT_SIZE);
+        if (!dirs) {
+            fprintf(stderr, "Cannot create destination directory %s: %s\n",
+                    dest && *dest ? dest : ".", strerror(errno));
+            return ARCHIVE_ERROR_WRITE;
+        }
+    }
+    if (mode == STREAM_LIST) {
+        printf("Archive: %s (stream)\n", name);
+        printf("Version: %d.%d\n", header.version >> 8, header.version & 0xFF);
+        printf("Created: %s", ctime(&header.create_time));
+        printf("\nFiles:\n");
+        printf("┌─────┬──────────────────────────────────────┬──────────────┬──────────────┬────────────────┐\n");
+        printf("│ No. │ Filename                             │ Size (bytes) │ Stored Size  │ Flags          │\n");
+        printf("├─────┼──────────────────────────────────────┼──────────────┼──────────────┼────────────────┤\n");
+    } else if (mode == STREAM_VERIFY) {
+        printf("Verifying archive: %s (stream)\n", name);
+    }
+
+    // 解压时只处理选中的成员，其余成员的数据直接跳过
+    uint8_t *matched = NULL;
+    if (mode == STREAM_EXTRACT) {
+        matched = calloc(ctx->include_count + 1, 1);
+        if (!matched) {
+            dir_cache_destroy(dirs);
+            return ARCHIVE_ERROR_MEMORY;
+        }
+    }
+
+    // 流中的总量要读到末尾才知道，只报告已处理的量和速率
+    if (mode == STREAM_EXTRACT) {
+        archive_progress_begin(ctx, "extract", 0, 0);
+    }
+
+    int result = ARCHIVE_OK;
+    int errors = 0;
+    uint32_t count = 0;
+    for (;;) {
+        FileEntry entry;
+        if (fread(&entry, sizeof(FileEntry), 1, in) != 1) {
+            fprintf(stderr, "Truncated archive stream\n");
+            result = ARCHIVE_ERROR_CORRUPTED;
+            break;
+        }
+        if (entry.filename[0] == '\0') break;
+        entry.filename[sizeof(entry.filename) - 1] = '\0';
+        count++;
+
+        char temp[NAME_MAX + 32];
+        const char *target = NULL;
+        int dir_fd = -1;
+        OutputSink *out = NULL;
+        int skip = mode == STREAM_EXTRACT &&
+                   !archive_member_selected(ctx, entry.filename, matched);
+        if (mode == STREAM_EXTRACT && !skip) {
+            out = shared ? shared : create_stream_output(dirs, &entry, &dir_fd, &target,
+                                                         temp, sizeof(temp));
+        }
+
+        // 目标文件创建失败时仍要读过该成员的数据
+        StreamTrailer trailer;
+        uint64_t stored_total = 0;
+        uint16_t flags = 0;
+        int member_ok = 0;
+        StreamMode member_mode = (mode == STREAM_EXTRACT && !out) ? STREAM_LIST : mode;
+        int intact = read_stream_member(in, &entry, ctx->password, member_mode, out,
+                                        &trailer, &stored_total, &flags, &member_ok);
+        if (mode == STREAM_EXTRACT && !out) {
+            member_ok = skip;
+        }
+        if (out && out != shared) {
+            member_ok = finish_stream_output(out, &entry, dir_fd, target, temp, intact && member_ok);
+        }
+        if (!intact) {
+            errors++;
+            result = ARCHIVE_ERROR_CORRUPTED;
+            break;
+        }
+        if (mode == STREAM_EXTRACT && !skip) {
+            progress_update(ctx->progress, trailer.file_size, 1, entry.filename);
+        }
+
+        if (mode == STREAM_LIST) {
+            char flags_str[16] = {0};
+            if (flags & FLAG_COMPRESSED) strcat(flags_str, "C");
+            if (flags & FLAG_ENCRYPTED) strcat(flags_str, "E");
+            printf("│ %3u │ %-36s │ %12llu │ %12llu │ %-14s │\n",
+                   count, entry.filename, (unsigned long long)trailer.file_size,
+                   (unsigned long long)stored_total, flags_str);
+        } else if (skip || mode == STREAM_TEST) {
+            continue;
+        } else if (!member_ok) {
+            if (mode == STREAM_VERIFY) {
+                printf("  [ERROR] File %s: cannot decode or CRC32 mismatch\n", entry.filename);
+            } else {
+                fprintf(stderr, "Failed to extract file: %s\n", entry.filename);
+            }
+            errors++;
+        } else if (mode == STREAM_VERIFY) {
+            printf("  [OK] File %s: CRC32 verified\n", entry.filename);
+        }
+    }
+
+    if (mode == STREAM_LIST) {
+        printf("└─────┴──────────────────────────────────────┴──────────────┴──────────────┴────────────────┘\n");
+        printf("Total files: %u\n", count);
+    } else if (mode == STREAM_VERIFY) {
+        if (errors == 0) {
+            printf("All files verified successfully!\n");
+        } else {
+            printf("%d file(s) failed verification\n", errors);
+        }
+    } else if (mode == STREAM_EXTRACT) {
+        archive_progress_end(ctx);
+    }
+
+    if (result == ARCHIVE_OK && errors > 0) {
+        result = ARCHIVE_ERROR_CORRUPTED;
+    }
+    dir_cache_destroy(dirs);
+    if (matched) {
+        if (archive_report_unmatched(ctx, matched) > 0 && result == ARCHIVE_OK) {
+            result = ARCHIVE_ERROR_NOT_FOUND;
+        }
+        free(matched);
+    }
+    return result;
+}
+
+// 从流格式归档顺序解压（in已定位在归档开头）
+ int archive_extract_stream(ArchiveContext *ctx, FILE *in, const char *dest) {
+    return walk_stream(ctx, in, STREAM_EXTRACT, dest, NULL, NULL);
+}
+
+// 从流格式归档把选中的成员依次写入同一个输出端
+ int archive_extract_stream_to_sink(ArchiveContext *ctx, FILE *in, OutputSink *sink) {
+    int ret = walk_stream(ctx, in, STREAM_EXTRACT, NULL, sink, NULL);
+    return (ret == ARCHIVE_OK || ret == ARCHIVE_ERROR_CORRUPTED) && sink->error ?
+           ARCHIVE_ERROR_WRITE : ret;
+}
+
+// 顺序扫描流格式归档并列出成员
+ int archive_list_stream(ArchiveContext *ctx, FILE *in, const char *name) {
+    return walk_stream(ctx, in, STREAM_LIST, NULL, NULL, name);
+}
+
+// 顺序解码流格式归档并校验每个成员的CRC32
+ int archive_verify_stream(ArchiveContext *ctx, FILE *in, const char *name) {
+    return walk_stream(ctx, in, STREAM_VERIFY, NULL, NULL, name);
+}
+
+// 只检查流格式归档的结构（块头和成员尾部），跳过数据
+ int archive_test_stream(FILE *in) {
+    ArchiveContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    return walk_stream(&ctx, in, STREAM_TEST, NULL, NULL, NULL);
+}
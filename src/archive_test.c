@@ -0,0 +1,312 @@
+#include "../include/archiver.h"
+
+#include <stdarg.h>
+
+// 结构测试：不读取成员数据，只检查头部、块表、条目表、页目录和文件名索引的布局。
+// 归档按顺序写出：头部、数据区（成员、固实块、字典）、块表、条目表、页目录、哈希索引，
+// 因此每个表必须紧接前一个表，最后一个表结束于archive_size（即文件大小）。
+// 单独存储的成员和固实块在数据区内各自按偏移递增，两个序列归并检查是否重叠，
+// 整个测试与条目数线性相关。
+
+#define TEST_MAX_REPORTS 20
+
+typedef struct {
+    int problems;
+} TestReport;
+
+// 记录一个结构问题，只输出前TEST_MAX_REPORTS个
+static void test_problem(TestReport *report, const char *format, ...) {
+    if (report->problems++ >= TEST_MAX_REPORTS) return;
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "  ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+// 区间 [start, end) 是否与 [other_start, other_end) 重叠（空区间不与任何区间重叠）
+static int regions_overlap(uint64_t start, uint64_t end, uint64_t other_start, uint64_t other_end) {
+    return start < end && other_start < other_end && start < other_end && other_start < end;
+}
+
+// 检查头部记录的各个表是否首尾相接，返回数据区的结束位置
+static uint64_t check_layout(const ArchiveHeader *header, uint64_t file_size, TestReport *report) {
+    uint64_t count = header->file_count;
+
+    if (header->archive_size != file_size) {
+        test_problem(report, "Archive size in header is %u bytes, file is %llu bytes",
+                     header->archive_size, (unsigned long long)file_size);
+    }
+
+    // 1.0格式的条目和数据交替存放，没有末尾的表
+    if (header->version < ARCHIVE_FORMAT_VERSION || header->index_offset == 0) {
+        return file_size;
+    }
+
+    uint64_t data_end = header->block_count ? header->block_offset : header->index_offset;
+    if (data_end < header->header_size || data_end > file_size) {
+        test_problem(report, "Index tables start at %llu, outside the archive",
+                     (unsigned long long)data_end);
+        return header->header_size;
+    }
+
+    if (header->block_count) {
+        uint64_t end = (uint64_t)header->block_offset + header->block_count * sizeof(BlockEntry);
+        if (end != header->index_offset) {
+            test_problem(report, "Block table (%u blocks at %u) does not end at the entry table (%u)",
+                         header->block_count, header->block_offset, header->index_offset);
+        }
+    }
+
+    uint64_t end = (uint64_t)header->index_offset + count * sizeof(FileEntry);
+    if (header->page_dir_offset) {
+        uint32_t per_page = header->page_entries;
+        if (per_page == 0) {
+            test_problem(report, "Page directory has zero entries per page");
+            return data_end;
+        }
+        if (header->page_dir_offset != end) {
+            test_problem(report, "Entry table (%u entries at %u) does not end at the page directory (%u)",
+                         header->file_count, header->index_offset, header->page_dir_offset);
+        }
+        uint64_t pages = (count + per_page - 1) / per_page;
+        end = (uint64_t)header->page_dir_offset + pages * sizeof(EntryPageInfo);
+
+        uint32_t slots = header->name_index_slots;
+        if (header->name_index_offset) {
+            if (header->name_index_offset != end) {
+                test_problem(report, "Page directory does not end at the name index (%u)",
+                             header->name_index_offset);
+            }
+            if (slots == 0 || (slots & (slots - 1)) != 0 || slots < count) {
+                test_problem(report, "Name index has an invalid slot count (%u for %u entries)",
+                             slots, header->file_count);
+            }
+            end = (uint64_t)header->name_index_offset + (uint64_t)slots * sizeof(NameIndexSlot);
+        }
+    }
+    if (end != file_size) {
+        test_problem(report, "Index tables end at %llu, file is %llu bytes",
+                     (unsigned long long)end, (unsigned long long)file_size);
+    }
+
+    if (header->dict_offset) {
+        uint64_t dict_end = (uint64_t)header->dict_offset + header->dict_stored_size;
+        if (header->dict_offset < header->header_size || dict_end > data_end) {
+            test_problem(report, "Dictionary [%u, %llu) is outside the data area",
+                         header->dict_offset, (unsigned long long)dict_end);
+        }
+    }
+    return data_end;
+}
+
+// 页目录中每页的偏移和条目数必须与定长条目表一致
+static void check_page_directory(const ArchiveFile *af, TestReport *report) {
+    if (!af->page_dir || !af->header.page_dir_offset) return;
+
+    uint32_t per_page = af->header.page_entries;
+    for (uint32_t p = 0; p < af->page_count; p++) {
+        uint64_t first = (uint64_t)p * per_page;
+        uint64_t offset = af->header.index_offset + first * sizeof(FileEntry);
+        if (af->page_dir[p].offset != offset) {
+            test_problem(report, "Entry page %u is at %u, expected %llu",
+                         p, af->page_dir[p].offset, (unsigned long long)offset);
+        }
+    }
+}
+
+// 固实块在数据区内按偏移递增且互不重叠
+static void check_blocks(const ArchiveFile *af, uint64_t data_end, TestReport *report) {
+    const ArchiveHeader *header = &af->header;
+    uint64_t dict_end = (uint64_t)header->dict_offset + header->dict_stored_size;
+    uint64_t prev_end = header->header_size;
+
+    for (uint32_t b = 0; b < header->block_count; b++) {
+        const BlockEntry *block = &af->blocks[b];
+        uint64_t end = (uint64_t)block->offset + block->stored_size;
+        if (block->offset < prev_end || end > data_end) {
+            test_problem(report, "Solid block %u [%u, %llu) is out of order or outside the data area",
+                         b, block->offset, (unsigned long long)end);
+            continue;
+        }
+        if (header->dict_offset &&
+            regions_overlap(block->offset, end, header->dict_offset, dict_end)) {
+            test_problem(report, "Solid block %u overlaps the dictionary", b);
+        }
+        prev_end = end;
+    }
+}
+
+// 逐个检查条目：数据区范围、顺序、固实块引用和分块参数
+static void check_entries(ArchiveFile *af, uint64_t data_end, TestReport *report) {
+    const ArchiveHeader *header = &af->header;
+    int indexed = header->version >= ARCHIVE_FORMAT_VERSION && header->index_offset;
+    uint64_t dict_end = (uint64_t)header->dict_offset + header->dict_stored_size;
+    uint64_t prev_end = header->header_size;
+    uint32_t next_block = 0;
+    uint32_t total_size = 0;
+    int complete = 1;           // 所有条目页都能读取
+
+    uint32_t *block_members = NULL;
+    if (header->block_count > 0) {
+        block_members = calloc(header->block_count, sizeof(uint32_t));
+        if (!block_members) {
+            test_problem(report, "Out of memory");
+            return;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->file_count; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            // 跳过整页，其余页仍然检查
+            uint32_t per_page = header->page_entries ? header->page_entries : 1;
+            uint32_t page = i / per_page;
+            test_problem(report, "Entry page %u is unreadable or its checksum does not match", page);
+            i = (page + 1) * per_page - 1;
+            complete = 0;
+            continue;
+        }
+        total_size += entry.file_size;
+
+        if (entry.filename[0] == '\0') {
+            test_problem(report, "Entry %u has an empty name", i);
+        }
+
+        if (entry.flags & FLAG_SOLID) {
+            if (entry.block_index >= header->block_count) {
+                test_problem(report, "Entry %u (%s): solid block %u does not exist",
+                             i, entry.filename, entry.block_index);
+            } else {
+                const BlockEntry *block = &af->blocks[entry.block_index];
+                if ((uint64_t)entry.block_offset + entry.file_size > block->raw_size) {
+                    test_problem(report, "Entry %u (%s): [%u, +%u) exceeds solid block %u (%u bytes)",
+                                 i, entry.filename, entry.block_offset, entry.file_size,
+                                 entry.block_index, block->raw_size);
+                }
+                // 硬链接共享原条目的位置，不计入块的成员数
+                if (!(entry.flags & FLAG_HARDLINK)) {
+                    block_members[entry.block_index]++;
+                }
+            }
+            continue;
+        }
+
+        // 硬链接引用之前的条目已写入的数据，不参与顺序检查
+        if (entry.flags & FLAG_HARDLINK) {
+            uint64_t end = (uint64_t)entry.offset + entry.stored_size;
+            if (entry.offset < header->header_size || end > prev_end) {
+                test_problem(report, "Entry %u (%s): hard link data [%u, %llu) is not inside earlier data",
+                             i, entry.filename, entry.offset, (unsigned long long)end);
+            }
+            continue;
+        }
+
+        // 单独存储的成员按偏移递增；1.0格式每个成员前还有条目头
+        uint64_t start = entry.offset;
+        uint64_t end = start + entry.stored_size;
+        uint64_t min_start = indexed ? prev_end : prev_end + sizeof(FileEntry);
+        int in_bounds = start >= min_start && end <= data_end;
+        if (!in_bounds) {
+            test_problem(report, "Entry %u (%s): data [%llu, %llu) is out of order or outside the data area",
+                         i, entry.filename, (unsigned long long)start, (unsigned long long)end);
+        }
+        if (header->dict_offset && regions_overlap(start, end, header->dict_offset, dict_end)) {
+            test_problem(report, "Entry %u (%s): data overlaps the dictionary", i, entry.filename);
+        }
+
+        // 两个有序序列归并：跳过在本成员之前结束的块，剩下的第一个块不能与之重叠
+        while (next_block < header->block_count &&
+               (uint64_t)af->blocks[next_block].offset + af->blocks[next_block].stored_size <= start) {
+            next_block++;
+        }
+        if (next_block < header->block_count) {
+            const BlockEntry *block = &af->blocks[next_block];
+            if (regions_overlap(start, end, block->offset, (uint64_t)block->offset + block->stored_size)) {
+                test_problem(report, "Entry %u (%s): data overlaps solid block %u",
+                             i, entry.filename, next_block);
+            }
+        }
+
+        if (entry.flags & FLAG_CHUNKED) {
+            uint64_t expected = entry.chunk_size ?
+                ((uint64_t)entry.file_size + entry.chunk_size - 1) / entry.chunk_size : 0;
+            if (entry.chunk_size == 0 || entry.chunk_count != expected ||
+                (uint64_t)entry.chunk_count * sizeof(ChunkEntry) > entry.stored_size) {
+                test_problem(report, "Entry %u (%s): inconsistent chunking (%u chunks of %u bytes)",
+                             i, entry.filename, entry.chunk_count, entry.chunk_size);
+            }
+        }
+        // 越界的条目不参与后续成员的顺序检查，避免一个坏条目连带报告后面所有条目
+        if (in_bounds) {
+            prev_end = end;
+        }
+    }
+
+    // 1.0格式的total_size不可靠，只检查1.1格式
+    if (complete && indexed && total_size != header->total_size) {
+        test_problem(report, "Total size in header is %u bytes, entries add up to %u bytes",
+                     header->total_size, total_size);
+    }
+    // 删除成员时固实块原样复制，引用块的条目可以少于块记录的成员数
+    for (uint32_t b = 0; complete && b < header->block_count; b++) {
+        if (block_members[b] > af->blocks[b].member_count) {
+            test_problem(report, "Solid block %u records %u members, %u entries refer to it",
+                         b, af->blocks[b].member_count, block_members[b]);
+        }
+    }
+    free(block_members);
+}
+
+// 结构测试：只读头部、块表和条目表，检查偏移和大小是否越界、重叠，与条目数线性相关
+ int archive_test(const char *archive) {
+    FILE *fp = fopen(archive, "rb");
+    if (!fp) {
+        return ARCHIVE_ERROR_OPEN;
+    }
+
+    ArchiveHeader header;
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || fread(&header, sizeof(ArchiveHeader), 1, fp) != 1) {
+        fclose(fp);
+        return ARCHIVE_ERROR_READ;
+    }
+    if (header.magic != ARCHIVE_MAGIC || header.header_size != sizeof(ArchiveHeader) ||
+        header.version > ARCHIVE_FORMAT_VERSION) {
+        fclose(fp);
+        return ARCHIVE_ERROR_INVALID;
+    }
+
+    // 流格式没有末尾的表，顺序检查块头和成员尾部
+    if (header.flags & ARCHIVE_FLAG_STREAM) {
+        rewind(fp);
+        int ret = archive_test_stream(fp);
+        fclose(fp);
+        return ret;
+    }
+    fclose(fp);
+
+    TestReport report = {0};
+    uint64_t data_end = check_layout(&header, st.st_size, &report);
+    if (report.problems > 0) {
+        // 表的位置不对时不再读取条目
+        return ARCHIVE_ERROR_CORRUPTED;
+    }
+
+    ArchiveFile *af = open_archive_file(archive, "rb");
+    if (!af) {
+        fprintf(stderr, "  Cannot load the block table or entry page directory\n");
+        return ARCHIVE_ERROR_CORRUPTED;
+    }
+    check_page_directory(af, &report);
+    check_blocks(af, data_end, &report);
+    check_entries(af, data_end, &report);
+    close_archive_file(af);
+
+    if (report.problems > TEST_MAX_REPORTS) {
+        fprintf(stderr, "  ... %d more problem(s)\n", report.problems - TEST_MAX_REPORTS);
+    }
+    return report.problems > 0 ? ARCHIVE_ERROR_CORRUPTED : ARCHIVE_OK;
+}
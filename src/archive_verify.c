@@ -0,0 +1,552 @@
+#include "../include/archiver.h"
+#include "../include/thread_pool.h"
+
+// 快速校验：按存储数据（压缩、加密后）的CRC32扫描归档，不解密、不解压，不需要密码。
+// 工作项是单独存储的成员、固实块和字典；线程池中的每个线程用自己的缓冲区pread读取，
+// 用原子计数器领取下一个工作项。固实块内的成员按所在块的结果报告。
+
+#define SCRUB_READ_SIZE (1024 * 1024)
+
+enum {
+    SCRUB_PENDING = 0,
+    SCRUB_OK,
+    SCRUB_MISMATCH,     // CRC32不一致
+    SCRUB_UNREADABLE,   // 超出文件末尾或读取失败
+    SCRUB_NO_CRC,       // 旧版本写入，没有存储数据CRC32
+    SCRUB_SHARED        // 固实块内的成员，由块校验
+};
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t crc32;
+    int status;
+} ScrubItem;
+
+typedef struct {
+    int fd;
+    ScrubItem *items;
+    uint32_t count;
+    uint32_t next;          // 下一个待领取的工作项（原子递增）
+    int fail_fast;
+    int stop;               // fail_fast时发现错误后置位
+} ScrubJob;
+
+// 读取一段存储数据并与记录的CRC32比较
+static int scrub_range(int fd, const ScrubItem *item, uint8_t *buf) {
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    uint64_t pos = item->offset;
+    uint64_t end = pos + item->size;
+
+    while (pos < end) {
+        size_t want = end - pos < SCRUB_READ_SIZE ? end - pos : SCRUB_READ_SIZE;
+        ssize_t n = pread(fd, buf, want, pos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return SCRUB_UNREADABLE;
+        crc = update_crc32(crc, buf, n);
+        pos += n;
+    }
+    return crc == item->crc32 ? SCRUB_OK : SCRUB_MISMATCH;
+}
+
+static void scrub_worker(void *arg) {
+    ScrubJob *job = arg;
+    uint8_t *buf = malloc(SCRUB_READ_SIZE);
+
+    while (!__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) {
+        uint32_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) break;
+
+        ScrubItem *item = &job->items[i];
+        if (item->status == SCRUB_PENDING) {
+            item->status = buf ? scrub_range(job->fd, item, buf) : SCRUB_UNREADABLE;
+            if (item->status != SCRUB_OK && job->fail_fast) {
+                __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    free(buf);
+}
+
+// 硬链接条目与之前的条目共享数据，数据只校验一次：找到共享数据的条目时返回1和它的序号；
+// 单独存储的其他条目登记自己的数据位置
+static int register_shared_entry(ArchiveFile *af, const FileEntry *entry, uint32_t index,
+                                 uint32_t *shared) {
+    uint64_t key_a, key_b;
+    if (!(af->header.flags & ARCHIVE_FLAG_HARDLINKS) || (entry->flags & FLAG_SOLID)) {
+        return 0;
+    }
+    archive_entry_data_key(entry, &key_a, &key_b);
+    if ((entry->flags & FLAG_HARDLINK) && archive_link_find(af, key_a, key_b, shared) &&
+        *shared != index) {
+        return 1;
+    }
+    archive_link_add(af, key_a, key_b, index);
+    return 0;
+}
+
+// 报告结果时使用的条目：已登记的硬链接取共享数据的条目，其他条目取自身
+static uint32_t result_entry(const ArchiveFile *af, const FileEntry *entry, uint32_t index) {
+    uint64_t key_a, key_b;
+    uint32_t shared;
+    if (!(entry->flags & FLAG_HARDLINK) || (entry->flags & FLAG_SOLID)) {
+        return index;
+    }
+    archive_entry_data_key(entry, &key_a, &key_b);
+    return archive_link_find(af, key_a, key_b, &shared) ? shared : index;
+}
+
+// 按记录填写工作项；没有存储数据CRC32时标记为无法快速校验
+static void set_item(ScrubItem *item, uint32_t offset, uint32_t size, uint32_t crc,
+                     int has_crc) {
+    item->offset = offset;
+    item->size = size;
+    item->crc32 = crc;
+    item->status = has_crc ? SCRUB_PENDING : SCRUB_NO_CRC;
+}
+
+// 成员的最终结果：固实成员取所在块的结果，字典损坏时字典压缩的成员同样无法解码
+static int member_status(const ArchiveFile *af, const ScrubItem *items, const FileEntry *entry,
+                         uint32_t index, const char **what) {
+    uint32_t count = af->header.file_count;
+    int status = items[result_entry(af, entry, index)].status;
+    *what = "stored data";
+
+    if (status == SCRUB_SHARED) {
+        if (entry->block_index >= af->header.block_count) {
+            *what = "solid block index";
+            return SCRUB_UNREADABLE;
+        }
+        status = items[count + entry->block_index].status;
+        *what = "solid block";
+    }
+    if ((entry->flags & FLAG_DICT) && af->header.dict_offset) {
+        int dict = items[count + af->header.block_count].status;
+        if (dict == SCRUB_MISMATCH || dict == SCRUB_UNREADABLE) {
+            *what = "dictionary";
+            return dict;
+        }
+    }
+    return status;
+}
+
+// 快速校验：多线程按存储数据的CRC32扫描，不解密、不解压，不需要密码
+ int archive_verify_fast(ArchiveContext *ctx, const char *archive) {
+    // 流格式没有条目表，只能顺序完整校验
+    FILE *stream = archive_stream_open(archive);
+    if (stream) {
+        int ret = archive_verify_stream(ctx, stream, archive);
+        archive_stream_close(stream);
+        return ret;
+    }
+
+    ArchiveFile *af = open_archive_file(archive, "rb");
+    if (!af) {
+        return ARCHIVE_ERROR_OPEN;
+    }
+
+    // 工作项：[0, file_count)为成员，其后是固实块，最后是字典
+    uint32_t count = af->header.file_count;
+    uint32_t total = count + af->header.block_count + 1;
+    ScrubItem *items = calloc(total, sizeof(ScrubItem));
+    if (!items) {
+        close_archive_file(af);
+        return ARCHIVE_ERROR_MEMORY;
+    }
+
+    printf("Verifying archive (fast): %s\n", archive);
+    printf("Checking %u files...\n", count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        FileEntry entry;
+        uint32_t shared;
+        if (!archive_read_entry(af, i, &entry)) {
+            items[i].status = SCRUB_UNREADABLE;
+        } else if (entry.flags & FLAG_SOLID) {
+            items[i].status = SCRUB_SHARED;
+        } else if (register_shared_entry(af, &entry, i, &shared)) {
+            items[i].status = SCRUB_OK;     // 按共享数据的条目报告
+        } else {
+            set_item(&items[i], entry.offset, entry.stored_size, entry.stored_crc32,
+                     entry.flags & FLAG_STORED_CRC);
+        }
+    }
+    for (uint32_t b = 0; b < af->header.block_count; b++) {
+        const BlockEntry *block = &af->blocks[b];
+        set_item(&items[count + b], block->offset, block->stored_size, block->stored_crc32,
+                 block->flags & FLAG_STORED_CRC);
+    }
+    if (af->header.dict_offset) {
+        set_item(&items[total - 1], af->header.dict_offset, af->header.dict_stored_size,
+                 af->header.dict_stored_crc32, af->header.dict_flags & FLAG_STORED_CRC);
+    } else {
+        items[total - 1].status = SCRUB_OK;
+    }
+
+    // 每个线程一个任务，线程各自领取工作项直到取完
+    ScrubJob job = { fileno(af->fp), items, total, 0, ctx->verify_fail_fast, 0 };
+    ThreadPool *pool = thread_pool_create((int)ctx->verify_threads);
+    int threads = pool ? thread_pool_size(pool) : 0;
+    for (int t = 0; t < threads; t++) {
+        if (!thread_pool_submit(pool, scrub_worker, &job)) break;
+    }
+    if (pool) {
+        thread_pool_wait(pool);
+        thread_pool_destroy(pool);
+    }
+    // 线程池不可用时在当前线程完成
+    scrub_worker(&job);
+
+    int errors = 0;
+    uint32_t unchecked = 0;
+    uint32_t skipped = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            printf("  [ERROR] Entry table page for file #%u is corrupted\n", i + 1);
+            errors++;
+            continue;
+        }
+
+        const char *what = NULL;
+        switch (member_status(af, items, &entry, i, &what)) {
+            case SCRUB_OK:
+                printf("  [OK] File %s: stored data verified\n", entry.filename);
+                break;
+            case SCRUB_MISMATCH:
+                printf("  [ERROR] File %s: %s checksum mismatch\n", entry.filename, what);
+                errors++;
+                break;
+            case SCRUB_NO_CRC:
+                printf("  [SKIP] File %s: no stored checksum\n", entry.filename);
+                unchecked++;
+                break;
+            case SCRUB_PENDING:
+                skipped++;
+                break;
+            default:
+                printf("  [ERROR] File %s: %s truncated or unreadable\n", entry.filename, what);
+                errors++;
+                break;
+        }
+    }
+
+    free(items);
+    close_archive_file(af);
+
+    if (unchecked > 0) {
+        printf("%u file(s) written by an older version have no stored checksum; "
+               "run a deep verify to check them\n", unchecked);
+    }
+    if (skipped > 0) {
+        printf("Stopped at the first failure; %u file(s) not checked\n", skipped);
+    }
+    if (errors == 0) {
+        printf("All files verified successfully!\n");
+        return ARCHIVE_OK;
+    }
+    printf("%d file(s) failed verification\n", errors);
+    return ARCHIVE_ERROR_CORRUPTED;
+}
+
+// 完整校验：工作单元是单独存储的成员或整个固实块（块只解码一次，块内成员依次校验）。
+// 解码使用ArchiveFile中的FILE*、块缓存和字典，不能跨线程共享，每个线程打开自己的ArchiveFile。
+// 分块成员逐块解码，未编码的成员按块读取，内存占用与成员大小无关。
+
+enum {
+    VERIFY_PENDING = 0,  // 未校验（fail_fast提前停止）
+    VERIFY_OK,
+    VERIFY_FAILED,
+    VERIFY_NO_PASSWORD
+};
+
+typedef struct {
+    uint32_t index;      // 条目序号或固实块序号
+    uint32_t is_block;
+} VerifyUnit;
+
+typedef struct {
+    const char *archive;
+    const char *password;
+    VerifyUnit *units;
+    uint32_t unit_count;
+    uint32_t next;                  // 下一个待领取的单元（原子递增）
+    const uint32_t *block_start;    // 块b的成员为block_members[block_start[b], block_start[b + 1])
+    const uint32_t *block_members;
+    uint8_t *status;                // 每个条目的结果（VERIFY_*）
+    int fail_fast;
+    int stop;
+    ProgressTracker *progress;
+} VerifyJob;
+
+// 分块成员逐块解码，整个文件的CRC32由块CRC合并得到
+static int verify_chunked_member(ArchiveFile *af, const FileEntry *entry, const char *password) {
+    ChunkEntry *chunks = load_chunk_table(af, entry);
+    if (!chunks) return 0;
+
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < entry->chunk_count; i++) {
+        // 空洞没有存储数据，不需要解码
+        if (chunks[i].flags & FLAG_SPARSE) {
+            uint64_t pos = (uint64_t)i * entry->chunk_size;
+            uint64_t n = entry->file_size - pos < entry->chunk_size ?
+                         entry->file_size - pos : entry->chunk_size;
+            crc = crc32_combine(crc, chunks[i].crc32, n);
+            archive_progress_bytes(af, n, entry->filename);
+            continue;
+        }
+        MemoryBuffer *chunk = NULL;
+        ok = decode_member_chunk(af, entry, chunks, i, password, &chunk);
+        if (ok) {
+            crc = crc32_combine(crc, chunks[i].crc32, chunk->size);
+            archive_progress_bytes(af, chunk->size, entry->filename);
+            buffer_pool_release(chunk);
+        }
+    }
+    free(chunks);
+
+    if (ok && crc != entry->crc32) {
+        fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
+        ok = 0;
+    }
+    return ok;
+}
+
+// 校验一个成员，返回VERIFY_*
+static int verify_member(ArchiveFile *af, const FileEntry *entry, const char *password,
+                         uint8_t *buf) {
+    // 没有密码时不尝试解码加密的数据
+    int encrypted = entry->flags & FLAG_ENCRYPTED;
+    if ((entry->flags & FLAG_SOLID) && entry->block_index < af->header.block_count) {
+        encrypted = af->blocks[entry->block_index].flags & FLAG_ENCRYPTED;
+    }
+    if ((entry->flags & FLAG_DICT) && (af->header.dict_flags & FLAG_ENCRYPTED)) {
+        encrypted = 1;
+    }
+    if (encrypted && (!password || !*password)) {
+        return VERIFY_NO_PASSWORD;
+    }
+
+    int ok;
+    if (entry->flags & FLAG_CHUNKED) {
+        ok = verify_chunked_member(af, entry, password);
+    } else if (!(entry->flags & (FLAG_COMPRESSED | FLAG_ENCRYPTED | FLAG_SOLID | FLAG_DICT))) {
+        // 未编码的数据就是原始内容
+        ScrubItem item = { entry->offset, entry->stored_size, entry->crc32, SCRUB_PENDING };
+        ok = entry->stored_size == entry->file_size &&
+             scrub_range(fileno(af->fp), &item, buf) == SCRUB_OK;
+    } else {
+        MemoryBuffer *data = NULL;
+        ok = decode_file_from_archive(af, entry, password, &data);
+        buffer_pool_release(data);
+    }
+    return ok ? VERIFY_OK : VERIFY_FAILED;
+}
+
+static void record_status(VerifyJob *job, uint32_t index, int status) {
+    job->status[index] = status;
+    if (status != VERIFY_OK && job->fail_fast) {
+        __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void verify_worker(void *arg) {
+    VerifyJob *job = arg;
+    ArchiveFile *af = open_archive_file(job->archive, "rb");
+    uint8_t *buf = malloc(SCRUB_READ_SIZE);
+    if (!af || !buf) {
+        close_archive_file(af);
+        free(buf);
+        return;
+    }
+    af->progress = job->progress;
+
+    while (!__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) {
+        uint32_t u = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (u >= job->unit_count) break;
+
+        const VerifyUnit *unit = &job->units[u];
+        FileEntry entry;
+        if (!unit->is_block) {
+            int status = VERIFY_FAILED;
+            if (archive_read_entry(af, unit->index, &entry)) {
+                status = verify_member(af, &entry, job->password, buf);
+                archive_progress_member(af, entry.file_size, entry.filename);
+            }
+            record_status(job, unit->index, status);
+            continue;
+        }
+
+        // 第一个成员解码整个块，之后的成员从块缓存中取；块本身无法解码时不再重复尝试
+        int block_status = VERIFY_OK;
+        for (uint32_t k = job->block_start[unit->index];
+             k < job->block_start[unit->index + 1] && !__atomic_load_n(&job->stop, __ATOMIC_RELAXED);
+             k++) {
+            uint32_t index = job->block_members[k];
+            int status = block_status;
+            if (status == VERIFY_OK) {
+                status = VERIFY_FAILED;
+                if (archive_read_entry(af, index, &entry)) {
+                    status = verify_member(af, &entry, job->password, buf);
+                    archive_progress_member(af, entry.file_size, entry.filename);
+                }
+                if (status != VERIFY_OK && af->cached_block != unit->index) {
+                    block_status = status;
+                }
+            }
+            record_status(job, index, status);
+        }
+    }
+
+    close_archive_file(af);
+    free(buf);
+}
+
+// 完整校验：多线程逐个成员解密、解压并校验CRC32，大文件逐块解码，不整体读入内存
+ int archive_verify(ArchiveContext *ctx, const char *archive) {
+    FILE *stream = archive_stream_open(archive);
+    if (stream) {
+        int ret = archive_verify_stream(ctx, stream, archive);
+        archive_stream_close(stream);
+        return ret;
+    }
+
+    ArchiveFile *af = open_archive_file(archive, "rb");
+    if (!af) {
+        return ARCHIVE_ERROR_OPEN;
+    }
+
+    uint32_t count = af->header.file_count;
+    uint32_t block_count = af->header.block_count;
+    uint8_t *status = calloc(count + 1, 1);
+    uint32_t *entry_block = malloc(sizeof(uint32_t) * (count + 1));
+    uint32_t *block_start = calloc(block_count + 2, sizeof(uint32_t));
+    uint32_t *block_members = malloc(sizeof(uint32_t) * (count + 1));
+    VerifyUnit *units = malloc(sizeof(VerifyUnit) * (count + block_count + 1));
+    if (!status || !entry_block || !block_start || !block_members || !units) {
+        free(status);
+        free(entry_block);
+        free(block_start);
+        free(block_members);
+        free(units);
+        close_archive_file(af);
+        return ARCHIVE_ERROR_MEMORY;
+    }
+
+    printf("Verifying archive: %s\n", archive);
+    printf("Checking %u files...\n", count);
+
+    // 按归档顺序生成工作单元：单独存储的成员各一个，固实块在第一个成员处生成一个
+    uint32_t unit_count = 0;
+    uint32_t unit_members = 0;
+    uint64_t unit_bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        FileEntry entry;
+        uint32_t shared;
+        entry_block[i] = UINT32_MAX;
+        if (!archive_read_entry(af, i, &entry)) {
+            status[i] = VERIFY_FAILED;
+        } else if (register_shared_entry(af, &entry, i, &shared)) {
+            continue;       // 按共享数据的条目报告
+        } else if (!(entry.flags & FLAG_SOLID)) {
+            units[unit_count++] = (VerifyUnit){ i, 0 };
+            unit_members++;
+            unit_bytes += entry.file_size;
+        } else if (entry.block_index >= block_count) {
+            fprintf(stderr, "Invalid solid block index: %u\n", entry.block_index);
+            status[i] = VERIFY_FAILED;
+        } else {
+            if (block_start[entry.block_index + 1]++ == 0) {
+                units[unit_count++] = (VerifyUnit){ entry.block_index, 1 };
+            }
+            entry_block[i] = entry.block_index;
+            unit_members++;
+            unit_bytes += entry.file_size;
+        }
+    }
+
+    // 按块分组固实成员
+    for (uint32_t b = 0; b < block_count; b++) {
+        block_start[b + 1] += block_start[b];
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t b = entry_block[i];
+        if (b != UINT32_MAX) {
+            block_members[block_start[b]++] = i;
+        }
+    }
+    // 填充时block_start[b]前移到了下一块的起点，恢复为块的起点
+    for (uint32_t b = block_count; b > 0; b--) {
+        block_start[b] = block_start[b - 1];
+    }
+    block_start[0] = 0;
+    free(entry_block);
+
+    archive_progress_begin(ctx, "verify", unit_bytes, unit_members);
+    VerifyJob job = {
+        archive, ctx->password, units, unit_count, 0,
+        block_start, block_members, status, ctx->verify_fail_fast, 0, ctx->progress
+    };
+    ThreadPool *pool = thread_pool_create((int)ctx->verify_threads);
+    int threads = pool ? thread_pool_size(pool) : 0;
+    for (int t = 0; t < threads; t++) {
+        if (!thread_pool_submit(pool, verify_worker, &job)) break;
+    }
+    if (pool) {
+        thread_pool_wait(pool);
+        thread_pool_destroy(pool);
+    }
+    // 线程池不可用或线程无法打开归档时在当前线程完成剩余单元
+    verify_worker(&job);
+    archive_progress_end(ctx);
+
+    int errors = 0;
+    int locked = 0;
+    uint32_t skipped = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            printf("  [ERROR] Entry table page for file #%u is corrupted\n", i + 1);
+            errors++;
+            continue;
+        }
+        switch (status[result_entry(af, &entry, i)]) {
+            case VERIFY_OK:
+                printf("  [OK] File %s: CRC32 verified\n", entry.filename);
+                break;
+            case VERIFY_NO_PASSWORD:
+                printf("  [ERROR] File %s: encrypted, password required\n", entry.filename);
+                errors++;
+                locked++;
+                break;
+            case VERIFY_FAILED:
+                printf("  [ERROR] File %s: cannot decode or CRC32 mismatch\n", entry.filename);
+                errors++;
+                break;
+            default:
+                skipped++;
+                break;
+        }
+    }
+
+    free(status);
+    free(block_start);
+    free(block_members);
+    free(units);
+    close_archive_file(af);
+
+    if (skipped > 0) {
+        printf("Stopped at the first failure; %u file(s) not checked\n", skipped);
+    }
+    if (errors == 0) {
+        printf("All files verified successfully!\n");
+        return ARCHIVE_OK;
+    }
+    printf("%d file(s) failed verification\n", errors);
+    if (locked == errors) {
+        printf("Use -p to give the password, or --fast to check stored data without it\n");
+        return ARCHIVE_ERROR_ENCRYPTION;
+    }
+    return ARCHIVE_ERROR_CORRUPTED;
+}
@@ -18,6 +18,9 @@ static int verbose = 0;
 static int compression_level = 6;
 static char *password = NULL;
 static ArchiveContext ctx;
+static int show_stats = 0;              // --stats：结束时向stderr输出分阶段统计
+static const char *stats_json_path = NULL;  // --stats-json FILE：以JSON写入统计（"-"为stdout）
+static const char *trace_path = NULL;       // --trace FILE：写出Chrome trace格式的阶段事件
 
 ArchiveAPI *API = NULL;
 
@@ -37,9 +40,14 @@ static int remove_files_tool(int argc, char *argv[]);
 static int verify_archive_tool(int argc, char *argv[]);
 static int update_archive_tool(int argc, char *argv[]);
 static int test_archive_tool(int argc, char *argv[]);
+static int parse_io_backend(const char *name, IoBackend *backend);
+static int parse_size(const char *text, uint32_t *size);
+static int take_instrumentation_options(int *argc, char *argv[]);
+static void report_stats(const char *subcommand, double wall_seconds);
+static void show_progress(ArchiveContext *ctx);
 
 
-void close_archive_file(ArchiveFile *af);
+int close_archive_file(ArchiveFile *af);
 
 const char* archive_strerror(int error_code) ;
 // 自定义 strdup 实现
@@ -70,13 +78,21 @@ static struct option long_options[] = {
 int main(int argc, char *argv[]) {
     int ret = 0;
     
+    // 默认只在终端上显示进度（-q、-n关闭）
+    progress = isatty(STDERR_FILENO);
+    
+    // 统计和trace选项可以出现在任意位置，先从参数中取出，子命令不需要处理
+    if (take_instrumentation_options(&argc, argv) != 0) {
+        return 1;
+    }
+    
     // 解析命令行参数
     if (parse_arguments_tool(argc, argv) != 0) {
         return 1;
     }
     
     // 如果没有指定子命令，显示帮助
-    if (argc < 2) {
+    if (optind >= argc) {
         print_usage_tool();
         return 0;
     }
@@ -92,33 +108,37 @@ int main(int argc, char *argv[]) {
    // api->progress_callback = progress ? progress_callback : NULL;
    // api->error_callback = error_callback;
     
-    // 设置压缩级别
-    API->set_compression(compression_level);
-    
-    // 设置密码（如果有）
-    if (password) {
-        API->set_encryption(password);
+    // 压缩级别和密码由各子命令写入自己的ArchiveContext
+    
+    // 根据子命令执行相应操作，子命令之后的参数交给子命令自己解析
+    char *subcommand = argv[optind];
+    int sub_argc = argc - optind - 1;
+    char **sub_argv = argv + optind + 1;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    stats_enable(show_stats || stats_json_path);
+    if (trace_path && !trace_start(trace_path)) {
+        fprintf(stderr, "Cannot write trace to %s: %s\n", trace_path, strerror(errno));
+        archive_cleanup(API);
+        return 1;
     }
     
-    // 根据子命令执行相应操作
-    char *subcommand = argv[1];
-    
     if (strcmp(subcommand, "create") == 0 || strcmp(subcommand, "c") == 0) {
-        ret = create_archive_tool(argc - 2, argv + 2);
+        ret = create_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "extract") == 0 || strcmp(subcommand, "x") == 0) {
-        ret = extract_archive_tool(argc - 2, argv + 2);
+        ret = extract_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "list") == 0 || strcmp(subcommand, "l") == 0) {
-        ret = list_archive_tool(argc - 2, argv + 2);
+        ret = list_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "add") == 0 || strcmp(subcommand, "a") == 0) {
-        ret = add_files_tool(argc - 2, argv + 2);
+        ret = add_files_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "remove") == 0 || strcmp(subcommand, "r") == 0) {
-        ret = remove_files_tool(argc - 2, argv + 2);
+        ret = remove_files_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "verify") == 0 || strcmp(subcommand, "v") == 0) {
-        ret = verify_archive_tool(argc - 2, argv + 2);
+        ret = verify_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "update") == 0 || strcmp(subcommand, "u") == 0) {
-        ret = update_archive_tool(argc - 2, argv + 2);
+        ret = update_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "test") == 0 || strcmp(subcommand, "t") == 0) {
-        ret = test_archive_tool(argc - 2, argv + 2);
+        ret = test_archive_tool(sub_argc, sub_argv);
     } else if (strcmp(subcommand, "help") == 0 || strcmp(subcommand, "h") == 0) {
         print_help_tool();
     } else if (strcmp(subcommand, "version") == 0 || strcmp(subcommand, "V") == 0) {
@@ -129,6 +149,16 @@ int main(int argc, char *argv[]) {
         ret = 1;
     }
     
+    if (trace_path && !trace_finish()) {
+        ret = 1;
+    }
+    if (show_stats || stats_json_path) {
+        struct timespec finished;
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        report_stats(subcommand, (finished.tv_sec - started.tv_sec) +
+                                 (finished.tv_nsec - started.tv_nsec) / 1e9);
+    }
+    
     // 清理资源
     if (API) {
         archive_cleanup(API);
@@ -142,12 +172,80 @@ int main(int argc, char *argv[]) {
     return ret;
 }
 
+// 从argv中移除--stats、--stats-json FILE和--trace FILE（也接受--opt=FILE）
+static int take_instrumentation_options(int *argc, char *argv[]) {
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            // 之后的参数原样保留
+            while (i < *argc) argv[kept++] = argv[i++];
+            break;
+        }
+        if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+        } else if (strcmp(argv[i], "--stats-json") == 0) {
+            if (i + 1 >= *argc) {
+                fprintf(stderr, "Option --stats-json requires a file name\n");
+                return 1;
+            }
+            stats_json_path = argv[++i];
+        } else if (strncmp(argv[i], "--stats-json=", 13) == 0) {
+            stats_json_path = argv[i] + 13;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= *argc) {
+                fprintf(stderr, "Option --trace requires a file name\n");
+                return 1;
+            }
+            trace_path = argv[++i];
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            trace_path = argv[i] + 8;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argv[kept] = NULL;
+    *argc = kept;
+    return 0;
+}
+
+// 输出本次操作的统计；操作名统一为子命令的全名
+static void report_stats(const char *subcommand, double wall_seconds) {
+    static const char *names[][2] = {
+        {"c", "create"}, {"x", "extract"}, {"l", "list"}, {"a", "add"},
+        {"r", "remove"}, {"v", "verify"}, {"u", "update"}, {"t", "test"},
+    };
+    const char *operation = subcommand;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(subcommand, names[i][0]) == 0) operation = names[i][1];
+    }
+
+    if (show_stats) {
+        stats_print(stderr, operation, wall_seconds);
+    }
+    if (stats_json_path) {
+        int to_stdout = strcmp(stats_json_path, "-") == 0;
+        FILE *out = to_stdout ? stdout : fopen(stats_json_path, "w");
+        if (!out || !stats_write_json(out, operation, wall_seconds)) {
+            fprintf(stderr, "Cannot write stats to %s: %s\n", stats_json_path, strerror(errno));
+        }
+        if (out && !to_stdout) fclose(out);
+    }
+}
+
+// stderr是终端且未关闭进度时，在stderr上原地刷新进度行
+static void show_progress(ArchiveContext *ctx) {
+    if (progress && !quiet) {
+        archive_set_progress_callback(ctx, progress_print, stderr, 0);
+    }
+}
+
 // 解析命令行参数
 static int parse_arguments_tool(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "hVvqc:p:nf:C:x:i:latyur", 
+    // "+"：在第一个非选项参数（子命令）处停止，不重排argv，子命令的选项原样留给子命令
+    while ((opt = getopt_long(argc, argv, "+hVvqc:p:nf:C:x:i:latyur", 
                               long_options, &option_index)) != -1) {
         switch (opt) {
             case 'h':
@@ -200,12 +298,51 @@ char* custom_strdup(const char* str) {
     return new_str;
 }
 
+// 解析I/O后端名称
+static int parse_io_backend(const char *name, IoBackend *backend) {
+    if (strcmp(name, "sync") == 0) {
+        *backend = IO_BACKEND_SYNC;
+    } else if (strcmp(name, "uring") == 0 || strcmp(name, "io_uring") == 0 ||
+               strcmp(name, "auto") == 0) {
+        *backend = IO_BACKEND_URING;
+    } else if (strcmp(name, "threads") == 0) {
+        *backend = IO_BACKEND_THREADS;
+    } else {
+        fprintf(stderr, "Error: Unknown I/O backend: %s (use sync, uring or threads)\n", name);
+        return 0;
+    }
+    return 1;
+}
+
+// 解析字节数，支持K/M后缀
+static int parse_size(const char *text, uint32_t *size) {
+    char *end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) {
+        fprintf(stderr, "Error: Invalid size: %s\n", text);
+        return 0;
+    }
+    if (*end == 'K' || *end == 'k') {
+        value *= 1024;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        value *= 1024 * 1024;
+        end++;
+    }
+    if (*end != '\0' || value == 0 || value > 0x7FFFFFFFULL) {
+        fprintf(stderr, "Error: Invalid size: %s\n", text);
+        return 0;
+    }
+    *size = (uint32_t)value;
+    return 1;
+}
+
 // 创建归档文件
 // 创建归档文件的工具函数
 static int create_archive_tool(int argc, char *argv[]) {
     // 最少需要2个参数：归档文件名和至少一个文件
     if (argc < 2) {
-        fprintf(stderr, "Usage: archive create [options] <archive> <files...>\n");
+        fprintf(stderr, "Usage: archive create [options] <archive|-> <files...>\n");
         fprintf(stderr, "Options:\n");
         fprintf(stderr, "  -f, --file <archive>    Archive filename\n");
         fprintf(stderr, "  -r, --recursive         Add directories recursively\n");
@@ -213,6 +350,14 @@ static int create_archive_tool(int argc, char *argv[]) {
         fprintf(stderr, "  -q, --quiet             Quiet mode\n");
         fprintf(stderr, "  -c, --compress <level>  Compression level (0-9)\n");
         fprintf(stderr, "  -p, --password <pass>   Encryption password\n");
+        fprintf(stderr, "  --io <mode>             I/O backend: sync, uring, threads\n");
+        fprintf(stderr, "  --io-depth <n>          Files in flight for async I/O\n");
+        fprintf(stderr, "  --solid                 Pack small files into shared compressed blocks\n");
+        fprintf(stderr, "  --solid-block-size <n>  Solid block size (K/M suffix, default 4M)\n");
+        fprintf(stderr, "  --dict                  Compress small files with a trained dictionary\n");
+        fprintf(stderr, "  --dict-size <n>         Dictionary size (K suffix, max 32K)\n");
+        fprintf(stderr, "  --direct                Write the archive with O_DIRECT (bypass page cache)\n");
+        fprintf(stderr, "  --drop-cache            Drop source files from the page cache after reading\n");
         return 1;
     }
     
@@ -221,8 +366,14 @@ static int create_archive_tool(int argc, char *argv[]) {
     char **files = NULL;
     int file_count = 0;
     int recursive = 0;
+    uint32_t solid_block_size = 0;
+    uint32_t dict_size = 0;
+    int direct_io = 0;
+    int drop_cache = 0;
     int compress_level = 5; // 默认压缩级别
     char *password = NULL;
+    IoBackend io_backend = IO_BACKEND_SYNC;
+    unsigned io_depth = IO_ENGINE_DEFAULT_DEPTH;
     
     // 解析参数
     int i = 0;
@@ -264,7 +415,66 @@ static int create_archive_tool(int argc, char *argv[]) {
                 return 1;
             }
         }
-        else if (argv[i][0] == '-') {
+        else if (strcmp(argv[i], "--io") == 0) {
+            if (i + 1 < argc) {
+                if (!parse_io_backend(argv[++i], &io_backend)) {
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--io-depth") == 0) {
+            if (i + 1 < argc) {
+                int depth = atoi(argv[++i]);
+                io_depth = depth > 0 ? (unsigned)depth : IO_ENGINE_DEFAULT_DEPTH;
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--solid") == 0) {
+            if (solid_block_size == 0) {
+                solid_block_size = SOLID_DEFAULT_BLOCK_SIZE;
+            }
+        }
+        else if (strcmp(argv[i], "--solid-block-size") == 0) {
+            if (i + 1 < argc) {
+                if (!parse_size(argv[++i], &solid_block_size)) {
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--direct") == 0) {
+            direct_io = 1;
+        }
+        else if (strcmp(argv[i], "--drop-cache") == 0) {
+            drop_cache = 1;
+        }
+        else if (strcmp(argv[i], "--dict") == 0) {
+            if (dict_size == 0) {
+                dict_size = DICT_DEFAULT_SIZE;
+            }
+        }
+        else if (strcmp(argv[i], "--dict-size") == 0) {
+            if (i + 1 < argc) {
+                if (!parse_size(argv[++i], &dict_size)) {
+                    return 1;
+                }
+                if (dict_size > DICT_MAX_SIZE) {
+                    fprintf(stderr, "Warning: Dictionary size is limited to %d bytes\n", DICT_MAX_SIZE);
+                    dict_size = DICT_MAX_SIZE;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             return 1;
         }
@@ -294,6 +504,23 @@ static int create_archive_tool(int argc, char *argv[]) {
         return 1;
     }
     
+    if (solid_block_size && dict_size) {
+        fprintf(stderr, "Error: --solid and --dict cannot be combined\n");
+        return 1;
+    }
+    
+    // "-"：流格式写到stdout，stdout上只能有归档数据
+    if (strcmp(archive_name, ARCHIVE_STREAM_NAME) == 0) {
+        if (isatty(STDOUT_FILENO)) {
+            fprintf(stderr, "Error: Refusing to write archive data to a terminal\n");
+            return 1;
+        }
+        if (solid_block_size || dict_size || direct_io) {
+            fprintf(stderr, "Warning: --solid, --dict and --direct are ignored when streaming\n");
+        }
+        quiet = 1;
+    }
+    
     if (!quiet) {
         printf("Creating archive: %s\n", archive_name);
         printf("Files to archive: %d\n", file_count);
@@ -313,13 +540,19 @@ static int create_archive_tool(int argc, char *argv[]) {
     
     // 设置上下文参数
     ctx->compression_level = compress_level;
+    ctx->io_backend = io_backend;
+    ctx->io_depth = io_depth;
+    ctx->solid_block_size = solid_block_size;
+    ctx->dict_size = dict_size;
+    ctx->direct_io = direct_io;
+    ctx->drop_cache = drop_cache;
     if (password) {
-        strncpy(ctx->password, password, sizeof(ctx->password) - 1);
-        ctx->password[sizeof(ctx->password) - 1] = '\0';
+        ctx->password = password;
         //ctx->encryption_enabled = 1;
     }
     //ctx->verbose = verbose;
    // ctx->quiet = quiet;
+    show_progress(ctx);
     
     // 调用API创建归档
     int result = API->create(ctx, archive_name, files, file_count);
@@ -343,14 +576,20 @@ static int create_archive_tool(int argc, char *argv[]) {
 static int extract_archive_tool(int argc, char *argv[]) {
     // 参数检查
     if (argc < 1) {
-        fprintf(stderr, "Usage: archive extract [options] <archive> [dest]\n");
+        fprintf(stderr, "Usage: archive extract [options] <archive|-> [members...]\n");
+        fprintf(stderr, "Members are paths or globs; default is the whole archive\n");
         fprintf(stderr, "Options:\n");
         fprintf(stderr, "  -C, --directory <dir>   Extract to directory\n");
         fprintf(stderr, "  -p, --password <pass>   Password for encrypted archive\n");
         fprintf(stderr, "  -v, --verbose           Verbose output\n");
         fprintf(stderr, "  -q, --quiet             Quiet mode\n");
-        fprintf(stderr, "  -f, --force             Overwrite existing files\n");
+        fprintf(stderr, "  -f, --force             Rewrite every file, even if already up to date\n");
+        fprintf(stderr, "  --overwrite             Same as --force\n");
+        fprintf(stderr, "  --checksum              Also compare CRC32 before skipping a file\n");
         fprintf(stderr, "  -k, --keep              Keep directory structure\n");
+        fprintf(stderr, "  -O, --to-stdout         Write member data to stdout instead of files\n");
+        fprintf(stderr, "  --io <mode>             I/O backend: sync, uring, threads\n");
+        fprintf(stderr, "  --io-depth <n>          Files in flight for async I/O\n");
         return 1;
     }
     
@@ -361,6 +600,17 @@ static int extract_archive_tool(int argc, char *argv[]) {
     int force = 0;
     int keep_structure = 0;
     int overwrite = 0;
+    int checksum = 0;
+    int dest_given = 0;
+    int to_stdout = 0;
+    IoBackend io_backend = IO_BACKEND_SYNC;
+    unsigned io_depth = IO_ENGINE_DEFAULT_DEPTH;
+    char **members = calloc(argc, sizeof(char *));
+    int member_count = 0;
+    if (!members) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
     
     // 解析参数
     int i = 0;
@@ -368,8 +618,10 @@ static int extract_archive_tool(int argc, char *argv[]) {
         if (strcmp(argv[i], "-C") == 0 || strcmp(argv[i], "--directory") == 0) {
             if (i + 1 < argc) {
                 dest_dir = argv[++i];
+                dest_given = 1;
             } else {
                 fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                free(members);
                 return 1;
             }
         }
@@ -378,6 +630,7 @@ static int extract_archive_tool(int argc, char *argv[]) {
                 password = argv[++i];
             } else {
                 fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                free(members);
                 return 1;
             }
         }
@@ -397,20 +650,47 @@ static int extract_archive_tool(int argc, char *argv[]) {
         else if (strcmp(argv[i], "--overwrite") == 0) {
             overwrite = 1;
         }
-        else if (argv[i][0] == '-') {
+        else if (strcmp(argv[i], "--checksum") == 0) {
+            checksum = 1;
+        }
+        else if (strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "--to-stdout") == 0) {
+            // stdout上只能有成员数据
+            to_stdout = 1;
+            quiet = 1;
+        }
+        else if (strcmp(argv[i], "--io") == 0) {
+            if (i + 1 < argc) {
+                if (!parse_io_backend(argv[++i], &io_backend)) {
+                    free(members);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                free(members);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--io-depth") == 0) {
+            if (i + 1 < argc) {
+                int depth = atoi(argv[++i]);
+                io_depth = depth > 0 ? (unsigned)depth : IO_ENGINE_DEFAULT_DEPTH;
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                free(members);
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            free(members);
             return 1;
         }
         else {
-            // 第一个非选项参数是归档文件名
+            // 第一个非选项参数是归档文件名，其余是要解压的成员（路径或glob）
             if (!archive_name) {
                 archive_name = argv[i];
-            } else if (!dest_dir || strcmp(dest_dir, ".") == 0) {
-                // 第二个非选项参数是目标目录（如果还没有通过 -C 设置）
-                dest_dir = argv[i];
             } else {
-                fprintf(stderr, "Error: Too many arguments\n");
-                return 1;
+                members[member_count++] = argv[i];
             }
         }
         i++;
@@ -419,12 +699,22 @@ static int extract_archive_tool(int argc, char *argv[]) {
     // 检查必要参数
     if (!archive_name) {
         fprintf(stderr, "Error: Archive filename is required\n");
+        free(members);
         return 1;
     }
     
-    // 检查归档文件是否存在
-    if (access(archive_name, F_OK) != 0) {
+    // 兼容旧用法：没有-C时，唯一的额外参数若是已存在的目录则作为目标目录
+    struct stat st;
+    if (!dest_given && member_count == 1 &&
+        stat(members[0], &st) == 0 && S_ISDIR(st.st_mode)) {
+        dest_dir = members[0];
+        member_count = 0;
+    }
+    
+    // 检查归档文件是否存在（"-"从stdin读取流格式归档）
+    if (strcmp(archive_name, ARCHIVE_STREAM_NAME) != 0 && access(archive_name, F_OK) != 0) {
         fprintf(stderr, "Error: Archive not found: %s\n", archive_name);
+        free(members);
         return 1;
     }
     
@@ -433,16 +723,17 @@ static int extract_archive_tool(int argc, char *argv[]) {
         printf("Destination: %s\n", dest_dir);
     }
     
-    // 创建目标目录（如果不存在）
-    struct stat st;
-    if (stat(dest_dir, &st) != 0) {
-        printf("Creating directory: %s\n", dest_dir);
-        if (mkdir(dest_dir, 0755) != 0 && errno != EEXIST) {
-            fprintf(stderr, "Error: Failed to create directory: %s\n", dest_dir);
-            return 1;
+    // 检查目标目录（不存在时由解压逐级创建）
+    if (to_stdout) {
+        // 不写文件
+    } else if (stat(dest_dir, &st) != 0) {
+        // 解压时逐级创建
+        if (!quiet) {
+            printf("Creating directory: %s\n", dest_dir);
         }
     } else if (!S_ISDIR(st.st_mode)) {
         fprintf(stderr, "Error: Destination is not a directory: %s\n", dest_dir);
+        free(members);
         return 1;
     }
     
@@ -450,24 +741,39 @@ static int extract_archive_tool(int argc, char *argv[]) {
     ArchiveContext *ctx = archive_context_create();
     if (!ctx) {
         fprintf(stderr, "Error: Failed to create archive context\n");
+        free(members);
         return 1;
     }
     
     // 设置上下文参数
     if (password) {
-        strncpy(ctx->password, password, sizeof(ctx->password) - 1);
-        ctx->password[sizeof(ctx->password) - 1] = '\0';
+        ctx->password = password;
        // ctx->encryption_enabled = 1;
     }
     //ctx->verbose = verbose;
     //ctx->quiet = quiet;
-    //ctx->overwrite = overwrite;
+    show_progress(ctx);
+    ctx->extract_overwrite = overwrite;
+    ctx->extract_checksum = checksum;
+    ctx->io_backend = io_backend;
+    ctx->io_depth = io_depth;
+    int selected = archive_set_include_patterns(ctx, members, member_count);
+    free(members);
+    if (selected != ARCHIVE_OK) {
+        fprintf(stderr, "Error: %s\n", archive_strerror(selected));
+        archive_context_destroy(ctx);
+        return 1;
+    }
     
     // 调用提取函数 - 根据你的API结构选择正确的方式
     
     // 方式1：如果API是一个全局结构体指针
     int result;
-    if (API && API->extract) {
+    if (to_stdout) {
+        OutputSink *sink = output_sink_fd(STDOUT_FILENO);
+        result = sink ? archive_extract_to_sink(ctx, archive_name, sink) : ARCHIVE_ERROR_MEMORY;
+        output_sink_close(sink);
+    } else if (API && API->extract) {
         result = API->extract(ctx, archive_name, dest_dir);
     } else {
         // 方式2：直接调用函数（如果没有API结构）
@@ -482,6 +788,9 @@ static int extract_archive_tool(int argc, char *argv[]) {
     }
     
     if (!quiet) {
+        if (ctx->extract_skipped > 0) {
+            printf("Skipped %u unchanged file(s)\n", ctx->extract_skipped);
+        }
         printf("Extraction completed: %s\n", archive_name);
     }
     
@@ -492,6 +801,56 @@ static int extract_archive_tool(int argc, char *argv[]) {
 }
 
 // 列出归档内容
+static int list_archive_tool(int argc, char *argv[]) {
+    if (argc < 1) {
+        fprintf(stderr, "Usage: archive list [options] <archive|->\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  -v, --verbose           Show detailed information\n");
+        return 1;
+    }
+    
+    char *archive_name = NULL;
+    
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        else if (!archive_name) {
+            archive_name = argv[i];
+        }
+    }
+    
+    if (!archive_name) {
+        fprintf(stderr, "Error: Archive filename is required\n");
+        return 1;
+    }
+    
+    // 检查归档文件是否存在（"-"从stdin读取流格式归档）
+    if (strcmp(archive_name, ARCHIVE_STREAM_NAME) != 0 && access(archive_name, F_OK) != 0) {
+        fprintf(stderr, "Archive not found: %s\n", archive_name);
+        return 1;
+    }
+    
+    ArchiveContext *ctx = archive_context_create();
+    if (!ctx) {
+        fprintf(stderr, "Error: Failed to create archive context\n");
+        return 1;
+    }
+    
+    int result = archive_list(ctx, archive_name);
+    archive_context_destroy(ctx);
+    if (result != ARCHIVE_OK) {
+        fprintf(stderr, "Failed to list archive: %s\n", archive_strerror(result));
+        return 1;
+    }
+    
+    return 0;
+}
+
 // 添加文件到归档
 static int add_files_tool(int argc, char *argv[]) {
     // 参数检查
@@ -606,12 +965,12 @@ static int add_files_tool(int argc, char *argv[]) {
     // 设置上下文参数
     ctx->compression_level = compress_level;
     if (password) {
-        strncpy(ctx->password, password, sizeof(ctx->password) - 1);
-        ctx->password[sizeof(ctx->password) - 1] = '\0';
+        ctx->password = password;
        // ctx->encryption_enabled = 1;
     }
    // ctx->verbose = verbose;
     //ctx->quiet = quiet;
+    show_progress(ctx);
     
     // 调用添加文件函数
     int result;
@@ -668,7 +1027,7 @@ static int remove_files_tool(int argc, char *argv[]) {
         return 1;
     }
     
-    int result =  API->remove(archive_name, files, file_count);
+    int result =  archive_remove(archive_name, files, file_count);
     if (result != ARCHIVE_OK) {
         fprintf(stderr, "Failed to remove files: %s\n", archive_strerror(result));
         return 1;
@@ -684,23 +1043,91 @@ static int remove_files_tool(int argc, char *argv[]) {
 // 验证归档完整性
 static int verify_archive_tool(int argc, char *argv[]) {
     if (argc < 1) {
-        fprintf(stderr, "Usage: archive verify <archive>\n");
+        fprintf(stderr, "Usage: archive verify [options] <archive>\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  --fast                  Check stored-data checksums only (no password, no decompression)\n");
+        fprintf(stderr, "  --deep                  Decrypt, decompress and check every file (default)\n");
+        fprintf(stderr, "  -j, --threads <n>       Verification threads (default: CPU count)\n");
+        fprintf(stderr, "  --fail-fast             Stop at the first damaged file\n");
+        fprintf(stderr, "  -p, --password <pass>   Password for encrypted archive\n");
+        fprintf(stderr, "  -q, --quiet             Quiet mode\n");
         return 1;
     }
     
-    char *archive_name = argv[0];
+    char *archive_name = NULL;
+    char *password = NULL;
+    int fast = 0;
+    int fail_fast = 0;
+    unsigned threads = 0;
+    
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--fast") == 0) {
+            fast = 1;
+        }
+        else if (strcmp(argv[i], "--deep") == 0) {
+            fast = 0;
+        }
+        else if (strcmp(argv[i], "--fail-fast") == 0) {
+            fail_fast = 1;
+        }
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                int n = atoi(argv[++i]);
+                threads = n > 0 ? (unsigned)n : 0;
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--password") == 0) {
+            if (i + 1 < argc) {
+                password = argv[++i];
+            } else {
+                fprintf(stderr, "Error: Missing argument for %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) {
+            quiet = 1;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        else if (!archive_name) {
+            archive_name = argv[i];
+        }
+    }
+    
+    if (!archive_name) {
+        fprintf(stderr, "Error: Archive filename is required\n");
+        return 1;
+    }
     
     if (!quiet) {
         printf("Verifying archive: %s\n", archive_name);
     }
     
-    // 检查归档文件是否存在
-    if (access(archive_name, F_OK) != 0) {
+    // 检查归档文件是否存在（"-"从stdin读取流格式归档）
+    if (strcmp(archive_name, ARCHIVE_STREAM_NAME) != 0 && access(archive_name, F_OK) != 0) {
         fprintf(stderr, "Archive not found: %s\n", archive_name);
         return 1;
     }
     
-    int result =  API->verify(archive_name);
+    ArchiveContext *ctx = archive_context_create();
+    if (!ctx) {
+        fprintf(stderr, "Error: Failed to create archive context\n");
+        return 1;
+    }
+    if (password) {
+        ctx->password = password;
+    }
+    ctx->verify_threads = threads;
+    ctx->verify_fail_fast = fail_fast;
+    show_progress(ctx);
+    
+    int result = fast ? archive_verify_fast(ctx, archive_name) : archive_verify(ctx, archive_name);
+    archive_context_destroy(ctx);
     if (result != ARCHIVE_OK) {
         fprintf(stderr, "Archive verification failed: %s\n", archive_strerror(result));
         return 1;
@@ -740,7 +1167,7 @@ static int update_archive_tool(int argc, char *argv[]) {
         return 1;
     }
     
-    int result =  API->update(archive_name, files, file_count);
+    int result =  archive_update(archive_name, files, file_count);
     if (result != ARCHIVE_OK) {
         fprintf(stderr, "Failed to update files: %s\n", archive_strerror(result));
         return 1;
@@ -772,7 +1199,7 @@ static int test_archive_tool(int argc, char *argv[]) {
         return 1;
     }
     
-    int result =  API->test(archive_name);
+    int result =  archive_test(archive_name);
     if (result != ARCHIVE_OK) {
         fprintf(stderr, "Archive test failed: %s\n", archive_strerror(result));
         return 1;
@@ -799,7 +1226,7 @@ static void print_usage_tool(void) {
     printf("  remove, r    Remove files from an archive\n");
     printf("  verify, v    Verify integrity of an archive\n");
     printf("  update, u    Update files in an archive\n");
-    printf("  test, t      Test archive file integrity\n");
+    printf("  test, t      Check archive structure (fast, reads only the index)\n");
     printf("  help, h      Show this help message\n");
     printf("  version, V   Show version information\n\n");
     printf("Global options:\n");
@@ -807,12 +1234,19 @@ static void print_usage_tool(void) {
     printf("  -q, --quiet            Quiet mode (no output)\n");
     printf("  -c, --compression N    Compression level (0-9, default: 6)\n");
     printf("  -p, --password PASS    Password for encryption\n");
-    printf("  -n, --no-progress      Disable progress display\n\n");
+    printf("  -n, --no-progress      Disable progress display\n");
+    printf("      --stats            Print per-phase counters to stderr when done\n");
+    printf("      --stats-json FILE  Write per-phase counters as JSON (- for stdout)\n");
+    printf("      --trace FILE       Write per-member stage events in Chrome trace format\n\n");
     printf("Examples:\n");
     printf("  archive create backup.arc file1.txt file2.txt\n");
     printf("  archive extract backup.arc\n");
+    printf("  archive extract -C out backup.arc 'src/*.c' docs\n");
+    printf("  archive extract -O db.arc db.sql | psql\n");
     printf("  archive list backup.arc\n");
     printf("  archive add backup.arc newfile.txt\n");
+    printf("  archive verify --fast backup.arc\n");
+    printf("  archive create - dir/* | ssh host archive extract -C dest -\n");
 }
 
 // 打印详细帮助信息
@@ -821,14 +1255,40 @@ static void print_help_tool(void) {
     printf("\nDetailed command usage:\n");
     printf("CREATE:\n");
     printf("  archive create [options] <archive> <files...>\n");
+    printf("  Use - as the archive to stream to stdout (sequential format)\n");
     printf("  Options:\n");
     printf("    -r, --recursive      Add directories recursively\n");
-    printf("    -f, --file NAME      Specify archive filename\n\n");
+    printf("    -f, --file NAME      Specify archive filename\n");
+    printf("    --io MODE            I/O backend: sync, uring, threads\n");
+    printf("    --io-depth N         Files in flight for async I/O (default: %d)\n",
+           IO_ENGINE_DEFAULT_DEPTH);
+    printf("    --solid              Pack small files into shared compressed blocks\n");
+    printf("    --solid-block-size N Solid block size, K/M suffix (default: 4M)\n");
+    printf("    --dict               Compress small files with a trained dictionary\n");
+    printf("    --dict-size N        Dictionary size, K suffix (default/max: 32K)\n");
+    printf("    --direct             Write the archive with O_DIRECT (bypass page cache)\n");
+    printf("    --drop-cache         Drop source files from the page cache after reading\n\n");
     
     printf("EXTRACT:\n");
-    printf("  archive extract [options] <archive> [dest]\n");
+    printf("  archive extract [options] <archive> [paths/globs...]\n");
+    printf("  Use - as the archive to read a streamed archive from stdin\n");
+    printf("  Only members matching a path, a directory prefix or a glob are read\n");
     printf("  Options:\n");
     printf("    -C, --directory DIR  Extract to specific directory\n");
+    printf("    -p, --password PASS  Password for encrypted archive\n");
+    printf("    -O, --to-stdout      Write member data to stdout instead of files\n");
+    printf("    -f, --force          Rewrite files whose size, mtime and mode already match\n");
+    printf("    --checksum           Also compare CRC32 before skipping a matching file\n");
+    printf("    --io MODE            I/O backend: sync, uring, threads\n\n");
+    
+    printf("VERIFY:\n");
+    printf("  archive verify [options] <archive>\n");
+    printf("  Options:\n");
+    printf("    --fast               Check stored-data checksums in parallel; no password,\n");
+    printf("                         no decompression (finds damaged members at disk speed)\n");
+    printf("    --deep               Decrypt, decompress and check every file (default)\n");
+    printf("    -j, --threads N      Verification threads (default: CPU count)\n");
+    printf("    --fail-fast          Stop at the first damaged file\n");
     printf("    -p, --password PASS  Password for encrypted archive\n\n");
     
     printf("LIST:\n");
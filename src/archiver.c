@@ -1,8 +1,39 @@
 #include "../include/archiver.h"
+#include "../include/encrypt.h"
+
+#include <fnmatch.h>
 
  int quiet = 0;
  int progress = 0;
 
+// 内部函数声明
+static void create_members_async(ArchiveContext *ctx, ArchiveFile *af, IoEngine *engine,
+                                 unsigned depth, char **files, int count,
+                                 int *success_count, int *missing_count);
+static void extract_entries_async(ArchiveContext *ctx, ArchiveFile *af,
+                                  const uint32_t *selected, uint32_t selected_count,
+                                  DirCache *dirs, IoEngine *engine, unsigned depth);
+static uint32_t append_block(ArchiveFile *af, const BlockEntry *block);
+static int skip_current_target(ArchiveContext *ctx, DirCache *dirs, const FileEntry *entry);
+static void remember_extracted(ArchiveFile *af, uint32_t index, const FileEntry *entry);
+static int link_extracted_member(ArchiveFile *af, DirCache *dirs, const FileEntry *entry);
+
+// remove、update、test不需要上下文，按API表的签名包装一层
+static int api_remove(ArchiveContext *ctx, const char *archive, char **files, int count) {
+    (void)ctx;
+    return archive_remove(archive, files, count);
+}
+
+static int api_update(ArchiveContext *ctx, const char *archive, char **files, int count) {
+    (void)ctx;
+    return archive_update(archive, files, count);
+}
+
+static int api_test(ArchiveContext *ctx, const char *archive) {
+    (void)ctx;
+    return archive_test(archive);
+}
+
 //初始化archive_init函数
 ArchiveAPI* archive_init(void) {
     ArchiveAPI *api = malloc(sizeof(ArchiveAPI));
@@ -21,9 +52,17 @@ ArchiveAPI* archive_init(void) {
     ctx->recursive = 0;
     ctx->exclude_patterns = NULL;
     ctx->exclude_count = 0;
+    ctx->include_patterns = NULL;
+    ctx->include_count = 0;
     ctx->log_file = NULL;
     ctx->current_archive = NULL;
     ctx->write_buffer = NULL;
+    ctx->io_backend = IO_BACKEND_SYNC;
+    ctx->io_depth = IO_ENGINE_DEFAULT_DEPTH;
+    ctx->solid_block_size = 0;
+    ctx->dict_size = 0;
+    ctx->direct_io = 0;
+    ctx->drop_cache = 0;
     ctx->api = api;
     
     // 设置函数指针
@@ -32,12 +71,13 @@ ArchiveAPI* archive_init(void) {
     api->list = archive_list;
     api->add = archive_add;
 
-    api->remove = archive_remove; 
+    api->remove = api_remove;
     api->verify = archive_verify;
-    api->update = archive_update; 
-    api->test = archive_test;  
-    api->set_compression = compress_data;
-    api->set_encryption = encrypt_data;
+    api->update = api_update;
+    api->test = api_test;
+    // 压缩级别和密码是每个ArchiveContext的设置，没有全局设置函数
+    api->set_compression = NULL;
+    api->set_encryption = NULL;
 
     api->progress_callback = progress_callback;
     api->error_callback = error_callback;
@@ -83,41 +123,93 @@ const char* archive_strerror(int error_code) {
             return "Unknown error";
     }
 }
+// 读取1.0格式的条目：条目头与数据交错，需要逐个跳过数据
+static int read_legacy_entries(ArchiveFile *af) {
+    for (uint32_t i = 0; i < af->header.file_count; i++) {
+        if (fread(&af->entries[i], sizeof(FileEntry), 1, af->fp) != 1) {
+            return 0;
+        }
+        if (fseek(af->fp, af->entries[i].stored_size, SEEK_CUR) != 0) {
+            return 0;
+        }
+        // 1.0格式没有这些字段，保留区内容不可信
+        af->entries[i].flags &= ~(FLAG_SOLID | FLAG_DICT | FLAG_STORED_CRC);
+    }
+    return 1;
+}
+
+// 读取1.1格式末尾的块表和条目表页目录（条目页按需加载）
+static int read_index_tables(ArchiveFile *af) {
+    if (!entry_index_open(af)) {
+        return 0;
+    }
+    
+    if (af->header.block_count > 0) {
+        af->blocks = malloc(sizeof(BlockEntry) * af->header.block_count);
+        if (!af->blocks) return 0;
+        if (fseek(af->fp, af->header.block_offset, SEEK_SET) != 0 ||
+            fread(af->blocks, sizeof(BlockEntry), af->header.block_count, af->fp) != af->header.block_count) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 // 打开归档文件（内部使用）
   ArchiveFile* open_archive_file(const char *filename, const char *mode) {
-    ArchiveFile *af = malloc(sizeof(ArchiveFile));
+    return open_archive_file_ex(filename, mode, NULL, 0);
+}
+
+// 打开归档文件；写模式通过ArchiveWriter输出，可借用对齐的write_buffer
+  ArchiveFile* open_archive_file_ex(const char *filename, const char *mode,
+                                    MemoryBuffer *write_buffer, int writer_flags) {
+    ArchiveFile *af = calloc(1, sizeof(ArchiveFile));
     if (!af) return NULL;
     
-    af->fp = fopen(filename, mode);
-    if (!af->fp) {
-        free(af);
-        return NULL;
+    if (mode[0] == 'w') {
+        af->writer = archive_writer_open(filename, write_buffer, writer_flags);
+        if (!af->writer) {
+            free(af);
+            return NULL;
+        }
+    } else {
+        af->fp = fopen(filename, mode);
+        if (!af->fp) {
+            free(af);
+            return NULL;
+        }
     }
     
     af->filename = strdup(filename);
     af->is_modified = 0;
     af->entries = NULL;
+    af->cached_block = UINT32_MAX;
     
     if (strcmp(mode, "r") == 0 || strcmp(mode, "rb") == 0) {
-        // 读取归档头
-        fread(&af->header, sizeof(ArchiveHeader), 1, af->fp);
-        
-        // 验证魔数
-        if (af->header.magic != 0x48435241) { // "ARCH"
-            fclose(af->fp);
-            free(af->filename);
-            free(af);
+        // 读取归档头并验证魔数
+        if (fread(&af->header, sizeof(ArchiveHeader), 1, af->fp) != 1 ||
+            af->header.magic != ARCHIVE_MAGIC) {
+            close_archive_file(af);
             return NULL;
         }
         
-        // 读取文件条目
+        // 读取文件条目：1.1格式只读页目录，1.0格式需要逐个读取全部条目
         if (af->header.file_count > 0) {
-            af->entries = malloc(sizeof(FileEntry) * af->header.file_count);
-            fread(af->entries, sizeof(FileEntry), af->header.file_count, af->fp);
+            int ok;
+            if (af->header.version >= ARCHIVE_FORMAT_VERSION && af->header.index_offset) {
+                ok = read_index_tables(af);
+            } else {
+                af->entries = malloc(sizeof(FileEntry) * af->header.file_count);
+                ok = af->entries && read_legacy_entries(af);
+            }
+            if (!ok) {
+                close_archive_file(af);
+                return NULL;
+            }
         }
     } else {
         // 创建新的归档头
-        af->header.magic = 0x48435241; // "ARCH"
+        af->header.magic = ARCHIVE_MAGIC;
         af->header.version = ARCHIVE_FORMAT_VERSION;
         af->header.header_size = sizeof(ArchiveHeader);
         af->header.file_count = 0;
@@ -125,43 +217,452 @@ const char* archive_strerror(int error_code) {
         af->header.archive_size = 0;
         af->header.create_time = time(NULL);
         af->header.flags = 0;
+        af->header.index_offset = 0;
+        af->header.block_offset = 0;
+        af->header.block_count = 0;
+        af->header.block_size = 0;
+        af->header.dict_offset = 0;
+        af->header.dict_stored_size = 0;
+        af->header.dict_size = 0;
+        af->header.dict_flags = 0;
+        af->header.page_dir_offset = 0;
+        af->header.page_entries = 0;
+        af->header.name_index_offset = 0;
+        af->header.name_index_slots = 0;
         memset(af->header.reserved, 0, sizeof(af->header.reserved));
         
-        // 写入归档头（稍后会更新）
-        fwrite(&af->header, sizeof(ArchiveHeader), 1, af->fp);
+        // 写入归档头（关闭时用pwrite回填）
+        archive_writer_write(af->writer, &af->header, sizeof(ArchiveHeader));
     }
     
     return af;
 }
 
-// 关闭归档文件
-  void close_archive_file(ArchiveFile *af) {
-    if (!af) return;
+// 写出块表和条目表，并回填归档头
+static int write_index_tables(ArchiveFile *af) {
+    ArchiveWriter *writer = af->writer;
+    int ok = archive_flush_solid(af);
+    
+    af->header.block_offset = 0;
+    if (af->header.block_count > 0) {
+        af->header.block_offset = archive_writer_tell(writer);
+        ok &= archive_writer_write(writer, af->blocks, sizeof(BlockEntry) * af->header.block_count);
+    }
     
-    if (af->fp) {
+    af->header.index_offset = archive_writer_tell(writer);
+    if (af->header.file_count > 0) {
+        ok &= archive_writer_write(writer, af->entries, sizeof(FileEntry) * af->header.file_count);
+    }
+    ok &= entry_index_write(af);
+    
+    // 各偏移都是32位，超出时归档无法读取
+    if (archive_writer_tell(writer) > ARCHIVE_SIZE_MAX) {
+        fprintf(stderr, "Archive exceeds the 4 GiB format limit\n");
+        return 0;
+    }
+    af->header.archive_size = archive_writer_tell(writer);
+    return ok && archive_writer_pwrite(writer, &af->header, sizeof(ArchiveHeader), 0);
+}
+
+// 关闭归档文件；写模式下返回0表示有数据没能写入
+  int close_archive_file(ArchiveFile *af) {
+    if (!af) return 0;
+    
+    int ok = 1;
+    if (af->writer) {
         if (af->is_modified) {
-            // 更新归档头并写入
-            fseek(af->fp, 0, SEEK_SET);
-            fwrite(&af->header, sizeof(ArchiveHeader), 1, af->fp);
+            ok = write_index_tables(af);
         }
+        ok &= archive_writer_close(af->writer);
+    }
+    if (af->fp) {
         fclose(af->fp);
     }
     
     if (af->filename) free(af->filename);
     if (af->entries) free(af->entries);
+    entry_index_close(af);
+    if (af->blocks) free(af->blocks);
+    buffer_pool_release(af->solid);
+    if (af->solid_password) free(af->solid_password);
+    buffer_pool_release(af->block_cache);
+    if (af->dict) free(af->dict);
+    archive_links_free(af);
     free(af);
+    return ok;
+}
+
+// 向条目表追加条目（写模式）
+ int archive_append_entry(ArchiveFile *af, const FileEntry *entry) {
+    if (af->header.file_count >= af->entry_capacity) {
+        uint32_t capacity = af->entry_capacity ? af->entry_capacity * 2 : 64;
+        FileEntry *entries = realloc(af->entries, sizeof(FileEntry) * capacity);
+        if (!entries) return 0;
+        af->entries = entries;
+        af->entry_capacity = capacity;
+    }
+    
+    af->entries[af->header.file_count++] = *entry;
+    af->header.total_size += entry->file_size;
+    if (entry->flags & FLAG_HARDLINK) {
+        af->header.flags |= ARCHIVE_FLAG_HARDLINKS;
+    }
+    af->is_modified = 1;
+    return 1;
+}
+
+// 向块表追加块描述，返回块序号
+static uint32_t append_block(ArchiveFile *af, const BlockEntry *block) {
+    if (af->header.block_count >= af->block_capacity) {
+        uint32_t capacity = af->block_capacity ? af->block_capacity * 2 : 16;
+        BlockEntry *blocks = realloc(af->blocks, sizeof(BlockEntry) * capacity);
+        if (!blocks) return UINT32_MAX;
+        af->blocks = blocks;
+        af->block_capacity = capacity;
+    }
+    
+    af->blocks[af->header.block_count] = *block;
+    return af->header.block_count++;
+}
+
+// 启用固实模式（写模式）
+ int archive_enable_solid(ArchiveFile *af, uint32_t block_size, int level, const char *password) {
+    if (block_size == 0) return 1;
+    
+    af->solid = buffer_pool_acquire(block_size);
+    if (!af->solid) return 0;
+    
+    af->header.block_size = block_size;
+    af->solid_level = level;
+    af->solid_password = (password && *password) ? strdup(password) : NULL;
+    return 1;
+}
+
+// 压缩、加密一段数据；*stored指向raw或*scratch中的结果，*scratch由调用者归还缓冲池
+int encode_data(const uint8_t *raw, size_t raw_size, int level,
+                const uint8_t *dict, size_t dict_size, const char *password,
+                MemoryBuffer **scratch, const uint8_t **stored, size_t *stored_size,
+                uint16_t *flags) {
+    *scratch = NULL;
+    *stored = raw;
+    *stored_size = raw_size;
+    
+    // 压缩失败时按原样存储
+    if (level > 0) {
+        MemoryBuffer *packed = buffer_pool_acquire(compressBound(raw_size) + 16);
+        if (packed && compress_to_buffer(raw, raw_size, packed, level, dict, dict_size)) {
+            *flags |= dict ? (FLAG_COMPRESSED | FLAG_DICT) : FLAG_COMPRESSED;
+            *scratch = packed;
+            *stored = packed->buffer;
+            *stored_size = packed->size;
+        } else {
+            buffer_pool_release(packed);
+        }
+    }
+    
+    if (password && *password) {
+        MemoryBuffer *sealed = buffer_pool_acquire(*stored_size + AES_BLOCK_SIZE);
+        if (!sealed || !encrypt_to_buffer(*stored, *stored_size, sealed, password)) {
+            buffer_pool_release(sealed);
+            buffer_pool_release(*scratch);
+            *scratch = NULL;
+            return 0;
+        }
+        buffer_pool_release(*scratch);
+        *scratch = sealed;
+        *stored = sealed->buffer;
+        *stored_size = sealed->size;
+        *flags |= FLAG_ENCRYPTED;
+    }
+    return 1;
+}
+
+// 把当前固实块压缩写出（写模式）
+ int archive_flush_solid(ArchiveFile *af) {
+    if (!af->solid || af->solid->size == 0) return 1;
+    
+    const uint8_t *raw = af->solid->buffer;
+    size_t raw_size = af->solid->size;
+    
+    BlockEntry block;
+    memset(&block, 0, sizeof(BlockEntry));
+    block.raw_size = raw_size;
+    block.crc32 = calculate_crc32(raw, raw_size);
+    
+    // 压缩、加密整个块
+    MemoryBuffer *scratch = NULL;
+    const uint8_t *stored = raw;
+    size_t stored_size = raw_size;
+    if (!encode_data(raw, raw_size, af->solid_level, NULL, 0, af->solid_password,
+                     &scratch, &stored, &stored_size, &block.flags)) {
+        return 0;
+    }
+    
+    block.offset = archive_writer_tell(af->writer);
+    block.stored_size = stored_size;
+    block.stored_crc32 = update_crc32(0, stored, stored_size);
+    block.flags |= FLAG_STORED_CRC;
+    
+    block.member_count = af->solid_members;
+    
+    int ok = archive_writer_write(af->writer, stored, stored_size) &&
+             append_block(af, &block) != UINT32_MAX;
+    
+    buffer_pool_release(scratch);
+    af->solid->size = 0;
+    af->solid_members = 0;
+    return ok;
+}
+
+// 写入预置字典，之后的小文件用它压缩（写模式）
+ int archive_set_dictionary(ArchiveFile *af, const uint8_t *dict, size_t dict_size, const char *password) {
+    if (af->dict || dict_size == 0 || dict_size > DICT_MAX_SIZE) return 0;
+    
+    af->dict = malloc(dict_size);
+    if (!af->dict) return 0;
+    memcpy(af->dict, dict, dict_size);
+    af->dict_size = dict_size;
+    
+    // 字典内容来自样本文件，有密码时同样加密
+    uint8_t *stored = (uint8_t *)dict;
+    size_t stored_size = dict_size;
+    uint32_t flags = 0;
+    if (password && *password) {
+        if (!encrypt_data(dict, dict_size, &stored, &stored_size, password)) {
+            return 0;
+        }
+        flags |= FLAG_ENCRYPTED;
+    }
+    
+    af->header.dict_offset = archive_writer_tell(af->writer);
+    af->header.dict_stored_size = stored_size;
+    af->header.dict_size = dict_size;
+    af->header.dict_flags = flags | FLAG_STORED_CRC;
+    af->header.dict_stored_crc32 = update_crc32(0, stored, stored_size);
+    
+    int ok = archive_writer_write(af->writer, stored, stored_size);
+    if (stored != dict) free(stored);
+    af->is_modified = 1;
+    return ok;
 }
-void report_progress(ArchiveContext *ctx, int percentage, const char *filename) {
-    if (ctx && ctx->api && ctx->api->progress_callback) {
-        ctx->api->progress_callback(percentage, filename);
+
+// 旧的进度回调（百分比+文件名）接到结构化进度上
+static void legacy_progress(const ProgressInfo *info, void *user) {
+    ArchiveAPI *api = user;
+    const char *name = info->finished ? "Complete" : info->current;
+    api->progress_callback(info->percent < 0 ? 0 : info->percent, name ? name : "");
+}
+
+void archive_progress_begin(ArchiveContext *ctx, const char *operation,
+                            uint64_t bytes_total, uint64_t members_total) {
+    if (!ctx) return;
+    progress_finish(ctx->progress);
+    ctx->progress = NULL;
+    if (ctx->progress_callback) {
+        ctx->progress = progress_create(operation, bytes_total, members_total, ctx->progress_rate,
+                                        ctx->progress_callback, ctx->progress_user);
+    } else if (ctx->api && ctx->api->progress_callback) {
+        ctx->progress = progress_create(operation, bytes_total, members_total, ctx->progress_rate,
+                                        legacy_progress, ctx->api);
     }
 }
+
+void archive_progress_end(ArchiveContext *ctx) {
+    if (!ctx) return;
+    progress_finish(ctx->progress);
+    ctx->progress = NULL;
+}
+
+void archive_progress_bytes(ArchiveFile *af, uint64_t bytes, const char *name) {
+    if (!af->progress) return;
+    af->progress_member += bytes;
+    progress_update(af->progress, bytes, 0, name);
+}
+
+void archive_progress_member(ArchiveFile *af, uint64_t size, const char *name) {
+    if (!af->progress) return;
+    uint64_t rest = size > af->progress_member ? size - af->progress_member : 0;
+    af->progress_member = 0;
+    progress_update(af->progress, rest, 1, name);
+}
+
 void report_error(ArchiveContext *ctx, const char *message) {
     if (ctx && ctx->api && ctx->api->error_callback) {
         ctx->api->error_callback(message);
     }
 }
 
+// 原归档固实块 -> 新归档固实块的映射表（初始为未复制）
+static uint32_t* new_block_map(const ArchiveFile *src) {
+    uint32_t *map = malloc(sizeof(uint32_t) * (src->header.block_count + 1));
+    if (map) {
+        for (uint32_t i = 0; i <= src->header.block_count; i++) {
+            map[i] = UINT32_MAX;
+        }
+    }
+    return map;
+}
+
+// 原样复制一段存储数据到目标归档末尾，同时计算存储数据的CRC32
+static int copy_stored_bytes(ArchiveFile *src, ArchiveFile *dst, uint32_t offset, uint32_t size,
+                             uint32_t *crc) {
+    uint8_t chunk[64 * 1024];
+    
+    *crc = crc32(0L, Z_NULL, 0);
+    if (fseek(src->fp, offset, SEEK_SET) != 0) return 0;
+    while (size > 0) {
+        size_t n = size < sizeof(chunk) ? size : sizeof(chunk);
+        if (fread(chunk, 1, n, src->fp) != n) return 0;
+        if (!archive_writer_write(dst->writer, chunk, n)) return 0;
+        *crc = update_crc32(*crc, chunk, n);
+        size -= n;
+    }
+    return 1;
+}
+
+// 不解码地把一个条目复制到新归档；固实块只复制一次，并重新编号。
+// 原来没有存储数据CRC32的条目在复制时补上；已有的保持原值，复制前的损坏仍能被发现。
+// 硬链接条目共享已复制的原条目的数据；原条目已被删除时由第一个复制的硬链接保存数据
+static int copy_member(ArchiveFile *src, ArchiveFile *dst, const FileEntry *entry, uint32_t *block_map) {
+    FileEntry copy = *entry;
+    uint32_t crc;
+    
+    uint64_t key_a = 0, key_b = 0;
+    int track_links = (src->header.flags & ARCHIVE_FLAG_HARDLINKS) != 0;
+    if (track_links) {
+        uint32_t shared;
+        archive_entry_data_key(entry, &key_a, &key_b);
+        if ((entry->flags & FLAG_HARDLINK) && archive_link_find(dst, key_a, key_b, &shared)) {
+            copy = dst->entries[shared];
+            memcpy(copy.filename, entry->filename, sizeof(copy.filename));
+            copy.mtime = entry->mtime;
+            copy.atime = entry->atime;
+            copy.mode = entry->mode;
+            copy.flags |= FLAG_HARDLINK;
+            return archive_append_entry(dst, &copy);
+        }
+        copy.flags &= ~FLAG_HARDLINK;
+    }
+    
+    // 字典压缩的条目依赖原归档的字典，原样复制一次
+    if ((entry->flags & FLAG_DICT) && dst->header.dict_offset == 0) {
+        uint32_t offset = archive_writer_tell(dst->writer);
+        if (!copy_stored_bytes(src, dst, src->header.dict_offset, src->header.dict_stored_size, &crc)) {
+            return 0;
+        }
+        dst->header.dict_offset = offset;
+        dst->header.dict_stored_size = src->header.dict_stored_size;
+        dst->header.dict_size = src->header.dict_size;
+        dst->header.dict_flags = src->header.dict_flags | FLAG_STORED_CRC;
+        dst->header.dict_stored_crc32 = (src->header.dict_flags & FLAG_STORED_CRC) ?
+                                        src->header.dict_stored_crc32 : crc;
+    }
+    
+    if (entry->flags & FLAG_SOLID) {
+        if (!block_map || entry->block_index >= src->header.block_count) return 0;
+        
+        if (block_map[entry->block_index] == UINT32_MAX) {
+            BlockEntry block = src->blocks[entry->block_index];
+            uint32_t offset = block.offset;
+            block.offset = archive_writer_tell(dst->writer);
+            if (!copy_stored_bytes(src, dst, offset, block.stored_size, &crc)) return 0;
+            if (!(block.flags & FLAG_STORED_CRC)) {
+                block.stored_crc32 = crc;
+                block.flags |= FLAG_STORED_CRC;
+            }
+            block_map[entry->block_index] = append_block(dst, &block);
+            if (block_map[entry->block_index] == UINT32_MAX) return 0;
+        }
+        copy.block_index = block_map[entry->block_index];
+    } else {
+        copy.offset = archive_writer_tell(dst->writer);
+        if (!copy_stored_bytes(src, dst, entry->offset, entry->stored_size, &crc)) return 0;
+        if (!(copy.flags & FLAG_STORED_CRC)) {
+            copy.stored_crc32 = crc;
+            copy.flags |= FLAG_STORED_CRC;
+        }
+    }
+    
+    if (!archive_append_entry(dst, &copy)) return 0;
+    return !track_links || archive_link_add(dst, key_a, key_b, dst->header.file_count - 1);
+}
+
+// 从输入文件中抽样训练字典并写入归档
+static int train_archive_dictionary(ArchiveContext *ctx, ArchiveFile *af, char **files, int count) {
+    const uint8_t **samples = malloc(sizeof(uint8_t *) * count);
+    size_t *sizes = malloc(sizeof(size_t) * count);
+    uint8_t *pool = malloc(DICT_SAMPLE_TOTAL);
+    int sample_count = 0;
+    size_t used = 0;
+    int ok = 0;
+    
+    if (!samples || !sizes || !pool) goto out;
+    
+    // 均匀抽样，只取会用字典压缩的小文件
+    int step = count / (DICT_SAMPLE_TOTAL / DICT_SAMPLE_MAX) + 1;
+    for (int i = 0; i < count && used + DICT_SAMPLE_MAX <= DICT_SAMPLE_TOTAL; i += step) {
+        FileInfo info;
+        int fd = file_open_info(files[i], &info);
+        if (fd < 0) continue;
+        
+        if (S_ISREG(info.mode) && info.size > 0 && info.size <= DICT_MEMBER_MAX) {
+            size_t n = info.size < DICT_SAMPLE_MAX ? info.size : DICT_SAMPLE_MAX;
+            if (file_read_all(fd, pool + used, n)) {
+                samples[sample_count] = pool + used;
+                sizes[sample_count] = n;
+                sample_count++;
+                used += n;
+            }
+        }
+        close(fd);
+    }
+    
+    uint8_t *dict = NULL;
+    size_t dict_size = 0;
+    if (sample_count >= 2 &&
+        train_dictionary(samples, sizes, sample_count, ctx->dict_size, &dict, &dict_size)) {
+        ok = archive_set_dictionary(af, dict, dict_size, ctx->password);
+        free(dict);
+    } else {
+        // 样本不足时不使用字典，照常逐个压缩
+        ok = 1;
+    }
+    
+out:
+    free(samples);
+    free(sizes);
+    free(pool);
+    return ok;
+}
+
+// 把文件逐个写入已打开的归档（add和追加），按操作报告进度
+static void append_source_files(ArchiveContext *ctx, ArchiveFile *af, char **files, int count,
+                                const char *operation) {
+    archive_progress_begin(ctx, operation, 0, count);
+    af->progress = ctx->progress;
+    
+    for (int i = 0; i < count; i++) {
+        FileInfo info;
+        int fd = file_open_info(files[i], &info);
+        progress_add_source(af->progress, fd >= 0 && S_ISREG(info.mode) ? info.size : 0);
+        if (fd < 0) {
+            fprintf(stderr, "Cannot open file: %s\n", files[i]);
+            fprintf(stderr, "Failed to %s file: %s\n", operation, files[i]);
+            archive_progress_member(af, 0, files[i]);
+            continue;
+        }
+        if (!write_fd_to_archive(af, fd, files[i], &info,
+                                 ctx->compression_level, ctx->password, NULL)) {
+            fprintf(stderr, "Failed to %s file: %s\n", operation, files[i]);
+        }
+        archive_progress_member(af, info.size, files[i]);
+        close(fd);
+    }
+    
+    af->progress = NULL;
+    archive_progress_end(ctx);
+}
+
 // 实际的create函数实现
   int archive_create(ArchiveContext *ctx, const char *archive, char **files, int count) {
         // 检查参数
@@ -175,54 +676,99 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_INVALID;
     }
     
-    // 检查文件是否存在
-    for (int i = 0; i < count; i++) {
-        if (access(files[i], F_OK) != 0) {
-            report_error(ctx, "File does not exist");
-            return ARCHIVE_ERROR_NOT_FOUND;
-        }
+    // "-"：以流格式写到stdout
+    if (strcmp(archive, ARCHIVE_STREAM_NAME) == 0) {
+        return archive_create_stream(ctx, STDOUT_FILENO, files, count);
+    }
+    
+    // 归档输出经过上下文中对齐的大写缓冲区（多次create之间复用）
+    if (!ctx->write_buffer) {
+        ctx->write_buffer = archive_writer_buffer_create(ARCHIVE_WRITER_BUFFER_SIZE);
     }
     
     // 创建归档文件
-    ArchiveFile *af = open_archive_file(archive, "wb");
+    ArchiveFile *af = open_archive_file_ex(archive, "wb", ctx->write_buffer,
+                                           ctx->direct_io ? ARCHIVE_WRITER_DIRECT : 0);
     if (!af) {
         report_error(ctx, "Failed to create archive file");
         return ARCHIVE_ERROR_OPEN;
     }
 
     ctx->current_archive = af;
+    
+    // 固实模式：小文件合并成共享的压缩块
+    if (!archive_enable_solid(af, ctx->solid_block_size, ctx->compression_level, ctx->password)) {
+        report_error(ctx, "Failed to allocate solid block buffer");
+        close_archive_file(af);
+        ctx->current_archive = NULL;
+        return ARCHIVE_ERROR_MEMORY;
+    }
+    
+    // 字节总量随每个成员的statx增长，不事先stat所有源文件
+    archive_progress_begin(ctx, "create", 0, count);
+    af->progress = ctx->progress;
+    
+    // 字典模式：从样本训练字典，小文件仍各自独立压缩
+    if (ctx->dict_size > 0 && ctx->solid_block_size == 0 && ctx->compression_level > 0) {
+        if (!train_archive_dictionary(ctx, af, files, count)) {
+            report_error(ctx, "Failed to train compression dictionary");
+            close_archive_file(af);
+            ctx->current_archive = NULL;
+            archive_progress_end(ctx);
+            return ARCHIVE_ERROR_COMPRESSION;
+        }
+    }
 
-    // 写入每个文件
+    // 写入每个文件：每个文件只open一次、statx一次
     int success_count = 0;
-    for (int i = 0; i < count; i++) {
-        report_progress(ctx, (i * 100) / count, files[i]);
+    int missing_count = 0;
+    unsigned depth = ctx->io_depth ? ctx->io_depth : IO_ENGINE_DEFAULT_DEPTH;
+    IoEngine *engine = io_engine_create(ctx->io_backend, depth);
+    if (engine) {
+        create_members_async(ctx, af, engine, depth, files, count,
+                             &success_count, &missing_count);
+        io_engine_destroy(engine);
+    } else for (int i = 0; i < count; i++) {
+        FileInfo info;
+        int fd = file_open_info(files[i], &info);
+        progress_add_source(af->progress, fd >= 0 && S_ISREG(info.mode) ? info.size : 0);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                report_error(ctx, "File does not exist");
+                missing_count++;
+            }
+            fprintf(stderr, "Failed to write file: %s\n", files[i]);
+            archive_progress_member(af, 0, files[i]);
+            continue;
+        }
         
-        if (write_file_to_archive(af->fp, files[i], ctx->compression_level, ctx->password)) {
+        if (write_fd_to_archive(af, fd, files[i], &info,
+                                ctx->compression_level, ctx->password, NULL)) {
             success_count++;
-            af->header.file_count++;
-            
-            // 更新文件大小统计
-            struct stat st;
-            if (stat(files[i], &st) == 0) {
-                af->header.total_size += st.st_size;
-            }
         } else {
             fprintf(stderr, "Failed to write file: %s\n", files[i]);
         }
+        archive_progress_member(af, info.size, files[i]);
+        if (ctx->drop_cache) {
+            file_drop_cache(fd);
+        }
+        close(fd);
     }
     
-    // 计算归档文件大小
-    af->header.archive_size = ftell(af->fp);
+    // 关闭归档文件（写出剩余的固实块、块表和条目表）
     af->is_modified = 1;
-    
-    // 关闭归档文件
-    close_archive_file(af);
+    int closed = close_archive_file(af);
     ctx->current_archive = NULL;
     
-    report_progress(ctx, 100, "Archive creation complete");
+    archive_progress_end(ctx);
     
-    if (success_count == 0) {
+    if (!closed) {
+        report_error(ctx, "Failed to write archive file");
         return ARCHIVE_ERROR_WRITE;
+    }
+    
+    if (success_count == 0) {
+        return missing_count == count ? ARCHIVE_ERROR_NOT_FOUND : ARCHIVE_ERROR_WRITE;
     } else if (success_count < count) {
         fprintf(stderr, "Warning: Only %d of %d files were archived\n", success_count, count);
     }
@@ -230,6 +776,97 @@ void report_error(ArchiveContext *ctx, const char *message) {
     return ARCHIVE_OK;
 }
 
+static int compare_index(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 模式都是完整路径且都命中文件时，用文件名索引直接查找，不扫描条目表
+static uint32_t* lookup_entries(ArchiveContext *ctx, ArchiveFile *af,
+                                uint32_t *selected_count, uint8_t *matched) {
+    if (ctx->include_count == 0 || af->entries || !af->header.name_index_offset) {
+        return NULL;
+    }
+    uint32_t *selected = malloc(sizeof(uint32_t) * ctx->include_count);
+    if (!selected) return NULL;
+    
+    uint32_t n = 0;
+    for (int i = 0; i < ctx->include_count; i++) {
+        const char *pattern = ctx->include_patterns[i];
+        FileEntry entry;
+        uint32_t index;
+        // 目录可能有子成员，需要扫描
+        if (strpbrk(pattern, "*?[") || !archive_find_entry(af, pattern, &entry, &index) ||
+            (entry.flags & FLAG_DIRECTORY)) {
+            free(selected);
+            return NULL;
+        }
+        
+        int duplicate = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            duplicate |= selected[j] == index;
+        }
+        if (!duplicate) selected[n++] = index;
+    }
+    
+    // 按归档中的顺序解压
+    qsort(selected, n, sizeof(uint32_t), compare_index);
+    memset(matched, 1, ctx->include_count);
+    *selected_count = n;
+    return selected;
+}
+
+// 按解压模式从条目表中选出成员序号，返回值由调用者free。
+// 条目表损坏时返回NULL并把*unmatched设为-1
+static uint32_t* select_entries(ArchiveContext *ctx, ArchiveFile *af,
+                                uint32_t *selected_count, int *unmatched) {
+    uint8_t *matched = calloc(ctx->include_count + 1, 1);
+    if (!matched) return NULL;
+    
+    *selected_count = 0;
+    *unmatched = 0;
+    uint32_t *selected = lookup_entries(ctx, af, selected_count, matched);
+    if (!selected) {
+        selected = malloc(sizeof(uint32_t) * (af->header.file_count + 1));
+        for (uint32_t i = 0; selected && i < af->header.file_count; i++) {
+            FileEntry entry;
+            if (!archive_read_entry(af, i, &entry)) {
+                fprintf(stderr, "Archive entry table is corrupted\n");
+                free(selected);
+                free(matched);
+                *unmatched = -1;
+                return NULL;
+            }
+            if (archive_member_selected(ctx, entry.filename, matched)) {
+                selected[(*selected_count)++] = i;
+            }
+        }
+        if (!selected) {
+            free(matched);
+            return NULL;
+        }
+    }
+    *unmatched = archive_report_unmatched(ctx, matched);
+    free(matched);
+    return selected;
+}
+
+// 开始解压的进度，总量为选中成员的原始大小之和
+static void begin_extract_progress(ArchiveContext *ctx, ArchiveFile *af,
+                                   const uint32_t *selected, uint32_t selected_count) {
+    archive_progress_begin(ctx, "extract", 0, selected_count);
+    if (!ctx->progress) return;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < selected_count; i++) {
+        FileEntry entry;
+        if (archive_read_entry(af, selected[i], &entry)) {
+            total += entry.file_size;
+        }
+    }
+    progress_add_total(ctx->progress, total, 0);
+    af->progress = ctx->progress;
+}
+
 // 实际的extract函数实现
   int archive_extract(ArchiveContext *ctx, const char *archive, const char *dest) {
     if (!archive) {
@@ -237,6 +874,14 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_INVALID;
     }
     
+    // 流格式（stdin或带流标志的文件）只能顺序解压
+    FILE *stream = archive_stream_open(archive);
+    if (stream) {
+        int ret = archive_extract_stream(ctx, stream, dest);
+        archive_stream_close(stream);
+        return ret;
+    }
+    
     ArchiveFile *af = open_archive_file(archive, "rb");
     if (!af) {
         report_error(ctx, "Failed to open archive file");
@@ -244,30 +889,122 @@ void report_error(ArchiveContext *ctx, const char *message) {
     }
     
     ctx->current_archive = af;
+    ctx->extract_skipped = 0;
     
-    // 创建目标目录（如果不存在）
-    if (dest && *dest) {
-        #ifdef _WIN32
-            _mkdir(dest);
-        #else
-            mkdir(dest, 0755);
-        #endif
+    // 按条目表筛选要解压的成员，只读取它们的数据区
+    uint32_t selected_count = 0;
+    int unmatched = 0;
+    uint32_t *selected = select_entries(ctx, af, &selected_count, &unmatched);
+    if (!selected) {
+        close_archive_file(af);
+        ctx->current_archive = NULL;
+        return unmatched < 0 ? ARCHIVE_ERROR_CORRUPTED : ARCHIVE_ERROR_MEMORY;
     }
     
-    // 提取每个文件
-    for (uint32_t i = 0; i < af->header.file_count; i++) {
-        report_progress(ctx, (i * 100) / af->header.file_count, af->entries[i].filename);
-        
-        if (!read_file_from_archive(af->fp, &af->entries[i], dest, ctx->password)) {
-            fprintf(stderr, "Failed to extract file: %s\n", af->entries[i].filename);
+    begin_extract_progress(ctx, af, selected, selected_count);
+    
+    // 目标目录（不存在时创建）和解压期间打开的各级目录fd
+    DirCache *dirs = NULL;
+    if (selected_count > 0) {
+        dirs = dir_cache_create(dest, DIR_CACHE_DEFAULT_SIZE);
+        if (!dirs) {
+            fprintf(stderr, "Cannot create destination directory %s: %s\n",
+                    dest && *dest ? dest : ".", strerror(errno));
+            free(selected);
+            close_archive_file(af);
+            ctx->current_archive = NULL;
+            archive_progress_end(ctx);
+            return ARCHIVE_ERROR_WRITE;
+        }
+    }
+    
+    // 提取选中的文件
+    unsigned depth = ctx->io_depth ? ctx->io_depth : IO_ENGINE_DEFAULT_DEPTH;
+    IoEngine *engine = selected_count > 1 ? io_engine_create(ctx->io_backend, depth) : NULL;
+    if (engine) {
+        extract_entries_async(ctx, af, selected, selected_count, dirs, engine, depth);
+        io_engine_destroy(engine);
+    } else {
+        for (uint32_t i = 0; i < selected_count; i++) {
+            FileEntry entry;
+            if (!archive_read_entry(af, selected[i], &entry)) {
+                fprintf(stderr, "Archive entry table is corrupted\n");
+                break;
+            }
+            if (skip_current_target(ctx, dirs, &entry)) {
+                remember_extracted(af, selected[i], &entry);
+            } else if (link_extracted_member(af, dirs, &entry)) {
+                // 已链接到先解压的同一文件
+            } else if (!read_file_from_archive(af, &entry, dirs, ctx->password)) {
+                fprintf(stderr, "Failed to extract file: %s\n", entry.filename);
+            } else {
+                remember_extracted(af, selected[i], &entry);
+            }
+            archive_progress_member(af, entry.file_size, entry.filename);
         }
     }
+    dir_cache_destroy(dirs);
     
+    free(selected);
     close_archive_file(af);
     ctx->current_archive = NULL;
     
-    report_progress(ctx, 100, "Extraction complete");
-    return ARCHIVE_OK;
+    archive_progress_end(ctx);
+    return unmatched > 0 ? ARCHIVE_ERROR_NOT_FOUND : ARCHIVE_OK;
+}
+
+// 把选中的成员依次解压到同一个输出端（如stdout或回调），不创建文件
+ int archive_extract_to_sink(ArchiveContext *ctx, const char *archive, OutputSink *sink) {
+    if (!archive || !sink) {
+        report_error(ctx, "Invalid parameters for extract");
+        return ARCHIVE_ERROR_INVALID;
+    }
+    
+    FILE *stream = archive_stream_open(archive);
+    if (stream) {
+        int ret = archive_extract_stream_to_sink(ctx, stream, sink);
+        archive_stream_close(stream);
+        return ret;
+    }
+    
+    ArchiveFile *af = open_archive_file(archive, "rb");
+    if (!af) {
+        report_error(ctx, "Failed to open archive file");
+        return ARCHIVE_ERROR_OPEN;
+    }
+    
+    uint32_t selected_count = 0;
+    int unmatched = 0;
+    uint32_t *selected = select_entries(ctx, af, &selected_count, &unmatched);
+    if (!selected) {
+        close_archive_file(af);
+        return unmatched < 0 ? ARCHIVE_ERROR_CORRUPTED : ARCHIVE_ERROR_MEMORY;
+    }
+    
+    begin_extract_progress(ctx, af, selected, selected_count);
+    int errors = 0;
+    for (uint32_t i = 0; i < selected_count && !sink->error; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, selected[i], &entry)) {
+            fprintf(stderr, "Archive entry table is corrupted\n");
+            errors++;
+            break;
+        }
+        if (!(entry.flags & (FLAG_DIRECTORY | FLAG_SYMLINK)) &&
+            !write_member_to_sink(af, &entry, ctx->password, sink)) {
+            fprintf(stderr, "Failed to extract file: %s\n", entry.filename);
+            errors++;
+        }
+        archive_progress_member(af, entry.file_size, entry.filename);
+    }
+    
+    free(selected);
+    close_archive_file(af);
+    archive_progress_end(ctx);
+    
+    if (sink->error) return ARCHIVE_ERROR_WRITE;
+    if (errors) return ARCHIVE_ERROR_CORRUPTED;
+    return unmatched > 0 ? ARCHIVE_ERROR_NOT_FOUND : ARCHIVE_OK;
 }
 
 // 实际的list函数实现
@@ -277,6 +1014,13 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_INVALID;
     }
     
+    FILE *stream = archive_stream_open(archive);
+    if (stream) {
+        int ret = archive_list_stream(ctx, stream, archive);
+        archive_stream_close(stream);
+        return ret;
+    }
+    
     ArchiveFile *af = open_archive_file(archive, "rb");
     if (!af) {
         report_error(ctx, "Failed to open archive file");
@@ -291,6 +1035,9 @@ void report_error(ArchiveContext *ctx, const char *message) {
     printf("Archive size: %u bytes\n", af->header.archive_size);
     printf("Compression ratio: %.2f%%\n", 
            (float)af->header.archive_size / af->header.total_size * 100);
+    if (af->header.dict_offset) {
+        printf("Dictionary: %u bytes\n", af->header.dict_size);
+    }
     
     printf("\nFiles:\n");
     printf("┌─────┬──────────────────────────────────────┬──────────────┬──────────────┬────────────────┐\n");
@@ -298,18 +1045,29 @@ void report_error(ArchiveContext *ctx, const char *message) {
     printf("├─────┼──────────────────────────────────────┼──────────────┼──────────────┼────────────────┤\n");
     
     for (uint32_t i = 0; i < af->header.file_count; i++) {
-        FileEntry *entry = &af->entries[i];
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            printf("└─────┴──────────────────────────────────────┴──────────────┴──────────────┴────────────────┘\n");
+            fprintf(stderr, "Archive entry table is corrupted\n");
+            close_archive_file(af);
+            return ARCHIVE_ERROR_CORRUPTED;
+        }
         
         // 构建标志字符串
         char flags_str[16] = {0};
-        if (entry->flags & FLAG_COMPRESSED) strcat(flags_str, "C");
-        if (entry->flags & FLAG_ENCRYPTED) strcat(flags_str, "E");
-        if (entry->flags & FLAG_DIRECTORY) strcat(flags_str, "D");
-        if (entry->flags & FLAG_SYMLINK) strcat(flags_str, "L");
+        if (entry.flags & FLAG_COMPRESSED) strcat(flags_str, "C");
+        if (entry.flags & FLAG_ENCRYPTED) strcat(flags_str, "E");
+        if (entry.flags & FLAG_SOLID) strcat(flags_str, "S");
+        if (entry.flags & FLAG_DICT) strcat(flags_str, "T");
+        if (entry.flags & FLAG_CHUNKED) strcat(flags_str, "K");
+        if (entry.flags & FLAG_SPARSE) strcat(flags_str, "H");
+        if (entry.flags & FLAG_HARDLINK) strcat(flags_str, "=");
+        if (entry.flags & FLAG_DIRECTORY) strcat(flags_str, "D");
+        if (entry.flags & FLAG_SYMLINK) strcat(flags_str, "L");
         
         printf("│ %3u │ %-36s │ %12u │ %12u │ %-14s │\n",
-               i + 1, entry->filename, entry->file_size, 
-               entry->stored_size, flags_str);
+               i + 1, entry.filename, entry.file_size, 
+               entry.stored_size, flags_str);
     }
     
     printf("└─────┴──────────────────────────────────────┴──────────────┴──────────────┴────────────────┘\n");
@@ -318,8 +1076,32 @@ void report_error(ArchiveContext *ctx, const char *message) {
     return ARCHIVE_OK;
 }
 
+// 流格式归档没有条目表，不能原地修改
+static int reject_stream_archive(const char *archive) {
+    FILE *stream = archive_stream_open(archive);
+    if (!stream) return 0;
+    archive_stream_close(stream);
+    fprintf(stderr, "Streamed archive cannot be modified: %s\n", archive);
+    return 1;
+}
+
+// 重写归档时原有成员读取或复制失败：丢弃临时归档，原归档保持不变
+static int abandon_rewrite(ArchiveFile *af, ArchiveFile *temp_af, const char *temp_file,
+                           uint32_t *block_map, int error) {
+    free(block_map);
+    temp_af->is_modified = 0;
+    close_archive_file(temp_af);
+    close_archive_file(af);
+    remove(temp_file);
+    return error;
+}
+
 // 添加文件到现有归档
   int archive_add(ArchiveContext *ctx, const char *archive, char **files, int count) {
+    if (reject_stream_archive(archive)) {
+        return ARCHIVE_ERROR_INVALID;
+    }
+    
     // 1. 打开现有归档读取所有内容
     // 2. 创建临时文件
     // 3. 写入原有文件
@@ -342,31 +1124,38 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_OPEN;
     }
     
+    // 原归档固实块在新归档中的序号
+    uint32_t *block_map = new_block_map(af);
+    
     // 复制原有文件
     for (uint32_t i = 0; i < af->header.file_count; i++) {
-        fseek(af->fp, af->entries[i].offset, SEEK_SET);
-        uint8_t *data = malloc(af->entries[i].stored_size);
-        fread(data, 1, af->entries[i].stored_size, af->fp);
-        
-        // 写入到临时文件
-        fwrite(&af->entries[i], sizeof(FileEntry), 1, temp_af->fp);
-        fwrite(data, 1, af->entries[i].stored_size, temp_af->fp);
-        
-        free(data);
-    }
-    
-    // 添加新文件
-    for (int i = 0; i < count; i++) {
-        if (write_file_to_archive(temp_af->fp, files[i], ctx->compression_level, ctx->password)) {
-            temp_af->header.file_count++;
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            fprintf(stderr, "Failed to read entry #%u\n", i + 1);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_CORRUPTED);
+        }
+        if (!copy_member(af, temp_af, &entry, block_map)) {
+            fprintf(stderr, "Failed to copy file: %s\n", entry.filename);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_WRITE);
         }
     }
+    free(block_map);
+    
+    // 添加新文件（新的小文件可以进入新的固实块）
+    archive_enable_solid(temp_af, ctx->solid_block_size, ctx->compression_level, ctx->password);
+    append_source_files(ctx, temp_af, files, count, "add");
     
     // 更新头信息
     temp_af->is_modified = 1;
-    close_archive_file(temp_af);
+    int closed = close_archive_file(temp_af);
     close_archive_file(af);
     
+    // 写入失败时保留原归档
+    if (!closed) {
+        remove(temp_file);
+        return ARCHIVE_ERROR_WRITE;
+    }
+    
     // 替换文件
     remove(archive);
     rename(temp_file, archive);
@@ -374,77 +1163,15 @@ void report_error(ArchiveContext *ctx, const char *message) {
     return ARCHIVE_OK;
 }
 
-// 验证归档完整性
-  int archive_verify(ArchiveContext *ctx, const char *archive) {
-    ArchiveFile *af = open_archive_file(archive, "rb");
-    if (!af) {
-        return ARCHIVE_ERROR_OPEN;
-    }
-    
-    printf("Verifying archive: %s\n", archive);
-    printf("Checking %u files...\n", af->header.file_count);
-    
-    int errors = 0;
-    for (uint32_t i = 0; i < af->header.file_count; i++) {
-        FileEntry *entry = &af->entries[i];
-        
-        // 跳转到文件数据
-        fseek(af->fp, entry->offset, SEEK_SET);
-        
-        // 读取存储的数据
-        uint8_t *stored_data = malloc(entry->stored_size);
-        fread(stored_data, 1, entry->stored_size, af->fp);
-        
-        // 解密（如果需要）
-        uint8_t *decrypted_data = stored_data;
-        size_t decrypted_size = entry->stored_size;
-        
-        if (entry->flags & FLAG_ENCRYPTED) {
-            if (ctx->password && *ctx->password) {
-                decrypt_data(stored_data, entry->stored_size, 
-                           &decrypted_data, &decrypted_size, ctx->password);
-                free(stored_data);
-            }
-        }
-        
-        // 解压（如果需要）
-        uint8_t *decompressed_data = decrypted_data;
-        if (entry->flags & FLAG_COMPRESSED) {
-            decompress_data(decrypted_data, decrypted_size,
-                          &decompressed_data, entry->file_size);
-            if (decrypted_data != stored_data) {
-                free(decrypted_data);
-            }
-        }
-        
-        // 计算CRC32
-        uint32_t calculated_crc = calculate_crc32(decompressed_data, entry->file_size);
-        if (calculated_crc != entry->crc32) {
-            printf("  [ERROR] File %s: CRC32 mismatch (expected: %08X, got: %08X)\n",
-                   entry->filename, entry->crc32, calculated_crc);
-            errors++;
-        } else {
-            printf("  [OK] File %s: CRC32 verified\n", entry->filename);
-        }
-        
-        free(decompressed_data);
-    }
-    
-    close_archive_file(af);
-    
-    if (errors == 0) {
-        printf("All files verified successfully!\n");
-        return ARCHIVE_OK;
-    } else {
-        printf("%d file(s) failed verification\n", errors);
-        return ARCHIVE_ERROR_CORRUPTED;
-    }
-}
 
 
 
 
   int archive_remove(const char *archive, char **files, int count) {
+    if (reject_stream_archive(archive)) {
+        return ARCHIVE_ERROR_INVALID;
+    }
+    
     // 1. 打开现有归档读取所有内容
     // 2. 创建临时文件
     // 3. 写入未删除的文件
@@ -466,34 +1193,42 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_OPEN;
     }
     
+    // 原归档固实块在新归档中的序号
+    uint32_t *block_map = new_block_map(af);
+    
     // 复制未删除的文件
     for (uint32_t i = 0; i < af->header.file_count; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            fprintf(stderr, "Failed to read entry #%u\n", i + 1);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_CORRUPTED);
+        }
         int to_delete = 0;
         for (int j = 0; j < count; j++) {
-            if (strcmp(af->entries[i].filename, files[j]) == 0) {
+            if (strcmp(entry.filename, files[j]) == 0) {
                 to_delete = 1;
                 break;
             }
         }
         
-        if (!to_delete) {
-            fseek(af->fp, af->entries[i].offset, SEEK_SET);
-            uint8_t *data = malloc(af->entries[i].stored_size);
-            fread(data, 1, af->entries[i].stored_size, af->fp);
-            
-            // 写入到临时文件
-            fwrite(&af->entries[i], sizeof(FileEntry), 1, temp_af->fp);
-            fwrite(data, 1, af->entries[i].stored_size, temp_af->fp);
-            
-            free(data);
+        if (!to_delete && !copy_member(af, temp_af, &entry, block_map)) {
+            fprintf(stderr, "Failed to copy file: %s\n", entry.filename);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_WRITE);
         }
     }
+    free(block_map);
     
     // 更新头信息
     temp_af->is_modified = 1;
-    close_archive_file(temp_af);
+    int closed = close_archive_file(temp_af);
     close_archive_file(af);
     
+    // 写入失败时保留原归档
+    if (!closed) {
+        remove(temp_file);
+        return ARCHIVE_ERROR_WRITE;
+    }
+    
     // 替换文件
     remove(archive);
     rename(temp_file, archive);
@@ -501,6 +1236,10 @@ void report_error(ArchiveContext *ctx, const char *message) {
     return ARCHIVE_OK;
 }
   int archive_update(const char *archive, char **files, int count) {
+    if (reject_stream_archive(archive)) {
+        return ARCHIVE_ERROR_INVALID;
+    }
+    
     // 1. 打开现有归档读取所有内容
     // 2. 创建临时文件
     // 3. 写入原有文件（更新指定文件）
@@ -522,11 +1261,19 @@ void report_error(ArchiveContext *ctx, const char *message) {
         return ARCHIVE_ERROR_OPEN;
     }
     
+    // 原归档固实块在新归档中的序号
+    uint32_t *block_map = new_block_map(af);
+    
     // 复制原有文件，更新指定文件
     for (uint32_t i = 0; i < af->header.file_count; i++) {
+        FileEntry entry;
+        if (!archive_read_entry(af, i, &entry)) {
+            fprintf(stderr, "Failed to read entry #%u\n", i + 1);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_CORRUPTED);
+        }
         int to_update = 0;
         for (int j = 0; j < count; j++) {
-            if (strcmp(af->entries[i].filename, files[j]) == 0) {
+            if (strcmp(entry.filename, files[j]) == 0) {
                 to_update = 1;
                 break;
             }
@@ -534,63 +1281,51 @@ void report_error(ArchiveContext *ctx, const char *message) {
         
         if (to_update) {
             // 写入更新的文件
-            write_file_to_archive(temp_af->fp, af->entries[i].filename, COMPRESSION_DEFAULT, NULL);
-        } else {
-            fseek(af->fp, af->entries[i].offset, SEEK_SET);
-            uint8_t *data = malloc(af->entries[i].stored_size);
-            fread(data, 1, af->entries[i].stored_size, af->fp);
-            
-            // 写入到临时文件
-            fwrite(&af->entries[i], sizeof(FileEntry), 1, temp_af->fp);
-            fwrite(data, 1, af->entries[i].stored_size, temp_af->fp);
-            
-            free(data);
+            if (!write_file_to_archive(temp_af, entry.filename, COMPRESSION_DEFAULT, NULL)) {
+                fprintf(stderr, "Failed to update file: %s\n", entry.filename);
+                return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_WRITE);
+            }
+        } else if (!copy_member(af, temp_af, &entry, block_map)) {
+            fprintf(stderr, "Failed to copy file: %s\n", entry.filename);
+            return abandon_rewrite(af, temp_af, temp_file, block_map, ARCHIVE_ERROR_WRITE);
         }
     }
+    free(block_map);
     
     // 更新头信息
     temp_af->is_modified = 1;
-    close_archive_file(temp_af);
+    int closed = close_archive_file(temp_af);
     close_archive_file(af);
     
+    // 写入失败时保留原归档
+    if (!closed) {
+        remove(temp_file);
+        return ARCHIVE_ERROR_WRITE;
+    }
+    
     // 替换文件
     remove(archive);
     rename(temp_file, archive);
     
     return ARCHIVE_OK;
 }
-  int archive_test(const char *archive) {
-    // 简单测试归档能否打开和读取头信息
-    ArchiveFile *af = open_archive_file(archive, "rb");
-    if (!af) {
-        return ARCHIVE_ERROR_OPEN;
-    }
-    
-    // 仅验证头信息
-    if (af->header.magic != 0x48435241) { // "ARCH"
-        close_archive_file(af);
-        return ARCHIVE_ERROR_INVALID;
-    }
-    
-    close_archive_file(af);
-    return ARCHIVE_OK;
-}
 
-// 进度回调函数
+// 进度回调函数（百分比不变时不输出；输出到stderr，stdout可能是解压的数据）
    void progress_callback(int percentage, const char *filename) {
     if (quiet || !progress) return;
     
-      int last_percentage = -1;
+    static int last_percentage = -1;
     if (percentage != last_percentage) {
         if (filename && *filename) {
-            printf("\rProgress: %3d%% - %-30s", percentage, filename);
+            fprintf(stderr, "\rProgress: %3d%% - %-30.30s", percentage, filename);
         } else {
-            printf("\rProgress: %3d%%", percentage);
+            fprintf(stderr, "\rProgress: %3d%%", percentage);
         }
-        fflush(stdout);
+        fflush(stderr);
         
         if (percentage >= 100) {
-            printf("\n");
+            fprintf(stderr, "\n");
+            percentage = -1;   // 下一次操作重新开始
         }
         last_percentage = percentage;
     }
@@ -603,226 +1338,1234 @@ void report_error(ArchiveContext *ctx, const char *message) {
 
 // 计算CRC32校验和
  uint32_t calculate_crc32(const uint8_t *data, size_t length) {
-    uint32_t crc = 0xFFFFFFFF;
-    
-    for (size_t i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ 0xEDB88320;
-            } else {
-                crc >>= 1;
-            }
-        }
-    }
-    //CRC取反
-    return ~crc;
+    // 与逐位计算的CRC32（多项式0xEDB88320）结果相同，zlib按表计算快得多
+    return update_crc32(0, data, length);
+}
+
+ uint32_t update_crc32(uint32_t crc, const uint8_t *data, size_t length) {
+    StatsMark mark;
+    stats_begin(&mark);
+    crc = crc32(crc, data, length);
+    stats_end(STATS_CHECKSUM, &mark, length, 0);
+    return crc;
 }
 
 // 实际写入文件到归档
-int write_file_to_archive(FILE *archive_fp, const char *filename,
+int write_file_to_archive(ArchiveFile *af, const char *filename,
                          CompressionLevel compression_level,
                          const char *password) {
-    FILE *file_fp = fopen(filename, "rb");
-    if (!file_fp) {
+    FileInfo info;
+    int fd = file_open_info(filename, &info);
+    if (fd < 0) {
         fprintf(stderr, "Cannot open file: %s\n", filename);
         return 0;
     }
     
-    // 获取文件大小
-    fseek(file_fp, 0, SEEK_END);
-    long file_size = ftell(file_fp);
-    fseek(file_fp, 0, SEEK_SET);
+    int ok = write_fd_to_archive(af, fd, filename, &info,
+                                 compression_level, password, NULL);
+    close(fd);
+    return ok;
+}
+
+// 成员大小和写入位置是否在格式的32位范围内（超出时报告错误）
+static int member_fits_format(ArchiveFile *af, const char *filename, uint64_t size) {
+    if (size > ARCHIVE_SIZE_MAX) {
+        fprintf(stderr, "File too large for the archive format (4 GiB limit): %s\n", filename);
+        return 0;
+    }
+    if (af->writer && archive_writer_tell(af->writer) > ARCHIVE_SIZE_MAX) {
+        fprintf(stderr, "Archive exceeds the 4 GiB format limit, cannot add: %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+// 填写条目的名称和元数据
+static void fill_file_entry(FileEntry *entry, const char *filename, const FileInfo *info) {
+    memset(entry, 0, sizeof(FileEntry));
+    strncpy(entry->filename, filename, sizeof(entry->filename) - 1);
+    entry->file_size = info->size;
+    entry->mtime = info->mtime;
+    entry->atime = info->atime;
+    entry->mode = info->mode;
+}
+
+// 同一文件（inode）的另一个硬链接已经写入时，只追加与它共享数据的条目；
+// 返回1/0表示追加成功/失败，不是已写入文件的硬链接时返回-1
+static int append_hardlink_entry(ArchiveFile *af, const char *filename, const FileInfo *info,
+                                 FileEntry *out_entry) {
+    uint32_t index;
+    if (info->nlink < 2 || info->size == 0 || !archive_link_find(af, info->dev, info->ino, &index)) {
+        return -1;
+    }
+    
+    FileEntry entry = af->entries[index];
+    memset(entry.filename, 0, sizeof(entry.filename));
+    strncpy(entry.filename, filename, sizeof(entry.filename) - 1);
+    entry.mtime = info->mtime;
+    entry.atime = info->atime;
+    entry.mode = info->mode;
+    entry.flags |= FLAG_HARDLINK;
+    if (!archive_append_entry(af, &entry)) return 0;
+    
+    if (out_entry) {
+        *out_entry = entry;
+    }
+    return 1;
+}
+
+// 记录刚写入的条目所属的inode（只对有多个硬链接的文件）
+static int remember_inode(ArchiveFile *af, const FileInfo *info) {
+    if (info->nlink < 2 || info->size == 0) return 1;
+    return archive_link_add(af, info->dev, info->ino, af->header.file_count - 1);
+}
+
+// 需要压缩或加密的大文件分块存储（未编码的数据本身就能按偏移随机读取）
+static int use_chunked_storage(size_t file_size, int level, const char *password) {
+    return file_size > MEMBER_CHUNK_SIZE && (level > 0 || (password && *password));
+}
+
+// 一块数据是否全为零
+static int chunk_is_zero(const uint8_t *data, size_t size) {
+    return size == 0 || (data[0] == 0 && memcmp(data, data + 1, size - 1) == 0);
+}
+
+// size字节全零数据的CRC32（空洞块的块表项）
+static uint32_t zero_crc32(size_t size) {
+    static const uint8_t zeros[4096];
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    while (size > 0) {
+        size_t n = size < sizeof(zeros) ? size : sizeof(zeros);
+        crc = crc32(crc, zeros, n);
+        size -= n;
+    }
+    return crc;
+}
+
+// 大文件分块压缩、加密，每块可单独解码，块表写在数据之后；data为NULL时从fd读取。
+// sparse时按SEEK_DATA/SEEK_HOLE跳过空洞，空洞和全零的块只在块表中记为FLAG_SPARSE
+static int write_chunked_member(ArchiveFile *af, FileEntry *entry, int fd, const uint8_t *data,
+                                int level, const char *password, int sparse) {
+    size_t file_size = entry->file_size;
+    uint32_t count = (file_size + MEMBER_CHUNK_SIZE - 1) / MEMBER_CHUNK_SIZE;
+    ChunkEntry *chunks = calloc(count, sizeof(ChunkEntry));
+    MemoryBuffer *input = data ? NULL : buffer_pool_acquire(MEMBER_CHUNK_SIZE);
+    if (!chunks || (!data && !input)) {
+        free(chunks);
+        buffer_pool_release(input);
+        return 0;
+    }
+    
+    uint64_t start = archive_writer_tell(af->writer);
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    uint32_t stored_crc = crc32(0L, Z_NULL, 0);
+    uint16_t flags = 0;
+    int ok = 1;
+    uint64_t data_start = 0, data_end = 0;   // 当前数据区（sparse）
+    uint32_t zero_chunk_crc = 0;             // 整块空洞的CRC32，首次用到时计算
+    int reposition = 0;                      // 跳过空洞后读取位置需要前移
+    
+    for (uint32_t i = 0; ok && i < count; i++) {
+        size_t pos = (size_t)i * MEMBER_CHUNK_SIZE;
+        size_t n = file_size - pos < MEMBER_CHUNK_SIZE ? file_size - pos : MEMBER_CHUNK_SIZE;
+        const uint8_t *raw = data ? data + pos : input->buffer;
+        
+        int hole = 0;
+        if (sparse && !data) {
+            if (pos >= data_end && !file_data_extent(fd, pos, file_size, &data_start, &data_end)) {
+                fprintf(stderr, "Cannot read file: %s\n", entry->filename);
+                ok = 0;
+                break;
+            }
+            // 整块落在下一个数据区之前：不读取
+            hole = pos + n <= data_start;
+        }
+        if (!hole && !data) {
+            if ((reposition && lseek(fd, (off_t)pos, SEEK_SET) < 0) ||
+                !file_read_all(fd, input->buffer, n)) {
+                fprintf(stderr, "Cannot read file: %s\n", entry->filename);
+                ok = 0;
+                break;
+            }
+            reposition = 0;
+        }
+        archive_progress_bytes(af, n, entry->filename);
+        if (sparse && (hole || chunk_is_zero(raw, n))) {
+            if (n == MEMBER_CHUNK_SIZE && !zero_chunk_crc) {
+                zero_chunk_crc = zero_crc32(n);
+            }
+            chunks[i].offset = archive_writer_tell(af->writer) - start;
+            chunks[i].stored_size = 0;
+            chunks[i].crc32 = n == MEMBER_CHUNK_SIZE ? zero_chunk_crc : zero_crc32(n);
+            chunks[i].flags = FLAG_SPARSE;
+            crc = crc32_combine(crc, chunks[i].crc32, n);
+            flags |= FLAG_SPARSE;
+            reposition |= hole;
+            continue;
+        }
+        
+        MemoryBuffer *scratch = NULL;
+        const uint8_t *stored = NULL;
+        size_t stored_size = 0;
+        if (!encode_data(raw, n, level, NULL, 0, password,
+                         &scratch, &stored, &stored_size, &chunks[i].flags)) {
+            ok = 0;
+            break;
+        }
+        
+        chunks[i].offset = archive_writer_tell(af->writer) - start;
+        chunks[i].stored_size = stored_size;
+        chunks[i].crc32 = update_crc32(0, raw, n);
+        crc = crc32_combine(crc, chunks[i].crc32, n);
+        flags |= chunks[i].flags;
+        stored_crc = update_crc32(stored_crc, stored, stored_size);
+        
+        ok = archive_writer_write(af->writer, stored, stored_size);
+        buffer_pool_release(scratch);
+        
+        // 首块压缩不了（已压缩的媒体、加密数据等）：剩余部分按原始大小预分配
+        if (ok && i == 0 && level > 0 && !sparse && !(chunks[0].flags & FLAG_COMPRESSED) &&
+            file_size >= PREALLOC_MIN_SIZE) {
+            archive_writer_reserve(af->writer, start + file_size + sizeof(ChunkEntry) * count);
+        }
+    }
+    
+    if (ok) {
+        stored_crc = crc32(stored_crc, (const Bytef *)chunks, sizeof(ChunkEntry) * count);
+        ok = archive_writer_write(af->writer, chunks, sizeof(ChunkEntry) * count);
+    }
+    if (ok) {
+        entry->offset = start;
+        entry->stored_size = archive_writer_tell(af->writer) - start;
+        entry->flags = flags | FLAG_CHUNKED | FLAG_STORED_CRC;
+        entry->stored_crc32 = stored_crc;
+        entry->crc32 = crc;
+        entry->chunk_size = MEMBER_CHUNK_SIZE;
+        entry->chunk_count = count;
+        ok = archive_append_entry(af, entry);
+    }
+    
+    free(chunks);
+    buffer_pool_release(input);
+    return ok;
+}
+
+// write_fd_to_archive的实现
+static int store_fd_member(ArchiveFile *af, int fd, const char *filename,
+                           const FileInfo *info,
+                           CompressionLevel compression_level,
+                           const char *password, FileEntry *out_entry) {
+    if (!S_ISREG(info->mode)) {
+        fprintf(stderr, "Not a regular file: %s\n", filename);
+        return 0;
+    }
+    if (!member_fits_format(af, filename, info->size)) {
+        return 0;
+    }
+    
+    // 硬链接：数据已经写入，不再读取
+    int linked = append_hardlink_entry(af, filename, info, out_entry);
+    if (linked >= 0) {
+        return linked;
+    }
+    
+    size_t file_size = info->size;
+    
+    // 含空洞的大文件按稀疏文件分块存储，空洞既不读取也不存储
+    int sparse = file_size > MEMBER_CHUNK_SIZE && file_has_holes(fd, file_size);
+    
+    // 不压缩的大文件按原始大小预分配归档空间；压缩后的大小未知，
+    // 不按原始大小预留（可压缩的文件预留过多会在空间或配额紧张时平白失败）
+    if (!sparse && compression_level == 0 && file_size >= PREALLOC_MIN_SIZE && af->writer) {
+        archive_writer_reserve(af->writer, archive_writer_tell(af->writer) + file_size);
+    }
+    
+    // 分块存储的大文件逐块读取，不需要整个文件的缓冲区
+    if (sparse || use_chunked_storage(file_size, compression_level, password)) {
+        FileEntry entry;
+        fill_file_entry(&entry, filename, info);
+        if (!write_chunked_member(af, &entry, fd, NULL, compression_level, password, sparse)) {
+            return 0;
+        }
+        if (out_entry) {
+            *out_entry = entry;
+        }
+        return remember_inode(af, info);
+    }
+    
+    // 读取文件内容（缓冲区来自缓冲池，稳定状态下不再分配）
+    MemoryBuffer *input = buffer_pool_acquire(file_size);
+    if (!input) {
+        return 0;
+    }
     
-    // 读取文件内容
-    uint8_t *file_data = malloc(file_size);
-    if (!file_data) {
-        fclose(file_fp);
+    if (!file_read_all(fd, input->buffer, file_size)) {
+        fprintf(stderr, "Cannot read file: %s\n", filename);
+        buffer_pool_release(input);
         return 0;
     }
     
-    fread(file_data, 1, file_size, file_fp);
-    fclose(file_fp);
+    int ok = write_buffer_to_archive(af, filename, info, input->buffer,
+                                     compression_level, password, out_entry);
+    buffer_pool_release(input);
+    return ok;
+}
+
+// 从已打开的fd写入文件到归档（元数据由调用者一次statx取得）
+int write_fd_to_archive(ArchiveFile *af, int fd, const char *filename,
+                        const FileInfo *info,
+                        CompressionLevel compression_level,
+                        const char *password, FileEntry *out_entry) {
+    int traced = trace_member_begin(filename);
+    int ok = store_fd_member(af, fd, filename, info, compression_level, password, out_entry);
+    if (traced) trace_member_end();
+    return ok;
+}
+
+// 固实模式：把小文件追加到当前固实块，块满时压缩写出
+static int append_to_solid_block(ArchiveFile *af, FileEntry *entry, const uint8_t *file_data) {
+    size_t file_size = entry->file_size;
+    
+    if (af->solid->size > 0 && (af->solid->size + file_size > af->header.block_size ||
+                                af->solid_members >= SOLID_BLOCK_MEMBERS_MAX)) {
+        if (!archive_flush_solid(af)) return 0;
+    }
     
-    // 计算原始CRC32
-    uint32_t original_crc = calculate_crc32(file_data, file_size);
+    entry->flags = FLAG_SOLID;
+    entry->block_index = af->header.block_count;
+    entry->block_offset = af->solid->size;
+    entry->offset = 0;
+    entry->stored_size = 0;
     
-    // 压缩数据
-    uint8_t *compressed_data = NULL;
-    size_t compressed_size = 0;
-    uint16_t flags = 0;
+    if (file_size > 0 && !write_to_buffer(af->solid, file_data, file_size)) {
+        return 0;
+    }
+    af->solid_members++;
     
-    if (compression_level > 0) {
-        if (compress_data(file_data, file_size, &compressed_data, &compressed_size, compression_level)) {
-            flags |= FLAG_COMPRESSED;
-        } else {
-            compressed_data = file_data;
-            compressed_size = file_size;
+    if (!archive_append_entry(af, entry)) return 0;
+    
+    if (af->solid->size >= af->header.block_size) {
+        return archive_flush_solid(af);
+    }
+    return 1;
+}
+
+// 编码文件内容并追加条目：分块、固实块或单独存储
+static int store_buffer_member(ArchiveFile *af, const char *filename,
+                               const FileInfo *info, const uint8_t *file_data,
+                               CompressionLevel compression_level,
+                               const char *password, FileEntry *out_entry) {
+    size_t file_size = info->size;
+    
+    // 创建文件条目
+    FileEntry entry;
+    fill_file_entry(&entry, filename, info);
+    
+    // 大文件分块存储，支持随机读取
+    if (use_chunked_storage(file_size, compression_level, password)) {
+        if (!write_chunked_member(af, &entry, -1, file_data, compression_level, password, 0)) {
+            return 0;
         }
-    } else {
-        compressed_data = file_data;
-        compressed_size = file_size;
+        if (out_entry) {
+            *out_entry = entry;
+        }
+        return 1;
     }
     
-    // 加密数据
-    uint8_t *encrypted_data = NULL;
-    size_t encrypted_size = 0;
+    // 计算原始CRC32
+    entry.crc32 = calculate_crc32(file_data, file_size);
     
-    if (password && *password) {
-        if (encrypt_data(compressed_data, compressed_size, &encrypted_data, &encrypted_size, password)) {
-            flags |= FLAG_ENCRYPTED;
-            free(compressed_data);
-            compressed_data = encrypted_data;
-            compressed_size = encrypted_size;
+    // 小文件进入固实块，由块统一压缩和加密（空文件没有数据，不占用块）
+    uint32_t solid_max = af->header.block_size < SOLID_MEMBER_MAX ?
+                         af->header.block_size : SOLID_MEMBER_MAX;
+    if (af->solid && file_size > 0 && file_size <= solid_max) {
+        if (!append_to_solid_block(af, &entry, file_data)) {
+            return 0;
+        }
+        if (out_entry) {
+            *out_entry = entry;
         }
+        return 1;
     }
     
-    // 获取文件信息
-    struct stat file_stat;
-    stat(filename, &file_stat);
+    // 压缩、加密；小文件使用预置字典，每个条目仍可单独解码
+    int use_dict = af->dict && file_size <= DICT_MEMBER_MAX;
+    MemoryBuffer *scratch = NULL;
+    const uint8_t *stored_data = file_data;
+    size_t stored_size = file_size;
+    uint16_t flags = 0;
+    if (!encode_data(file_data, file_size, compression_level,
+                     use_dict ? af->dict : NULL, use_dict ? af->dict_size : 0, password,
+                     &scratch, &stored_data, &stored_size, &flags)) {
+        return 0;
+    }
     
-    // 创建文件条目头
-    FileEntry entry;
-    memset(&entry, 0, sizeof(FileEntry));
-    strncpy(entry.filename, filename, sizeof(entry.filename) - 1);
-    entry.file_size = file_size;
-    entry.stored_size = compressed_size;
-    entry.offset = ftell(archive_fp) + sizeof(FileEntry);
-    entry.mtime = file_stat.st_mtime;
-    entry.atime = file_stat.st_atime;
-    entry.mode = file_stat.st_mode;
-    entry.flags = flags;
-    entry.crc32 = original_crc;
+    entry.stored_size = stored_size;
+    entry.offset = archive_writer_tell(af->writer);
+    entry.flags = flags | FLAG_STORED_CRC;
+    entry.stored_crc32 = update_crc32(0, stored_data, stored_size);
+    
+    // 写入文件数据，条目在关闭时统一写入条目表
+    int ok = archive_writer_write(af->writer, stored_data, stored_size) &&
+             archive_append_entry(af, &entry);
+    
+    if (ok && out_entry) {
+        *out_entry = entry;
+    }
     
-    // 写入条目头
-    fwrite(&entry, sizeof(FileEntry), 1, archive_fp);
+    buffer_pool_release(scratch);
+    return ok;
+}
+
+// 把已读入内存的文件内容写入归档（不接管file_data）
+int write_buffer_to_archive(ArchiveFile *af, const char *filename,
+                            const FileInfo *info, const uint8_t *file_data,
+                            CompressionLevel compression_level,
+                            const char *password, FileEntry *out_entry) {
+    if (!member_fits_format(af, filename, info->size)) {
+        return 0;
+    }
+    int traced = trace_member_begin(filename);
+    int ok = append_hardlink_entry(af, filename, info, out_entry);
+    if (ok < 0) {
+        ok = store_buffer_member(af, filename, info, file_data, compression_level, password, out_entry) &&
+             remember_inode(af, info);
+    }
+    if (traced) trace_member_end();
+    return ok;
+}
+
+// 还原一段已读入内存的存储数据（解密、解压），接管stored；*out为raw_size字节，由调用者归还缓冲池
+int decode_stored_buffer(MemoryBuffer *stored, uint16_t flags, uint32_t raw_size,
+                         const char *name, const char *password,
+                         const uint8_t *dict, size_t dict_size, MemoryBuffer **out) {
+    MemoryBuffer *current = stored;
+    
+    if ((flags & FLAG_ENCRYPTED) && (!password || !*password)) {
+        fprintf(stderr, "File is encrypted, password required\n");
+        buffer_pool_release(current);
+        return 0;
+    }
     
-    // 写入文件数据
-    fwrite(compressed_data, 1, compressed_size, archive_fp);
+    // 解密数据（保留填充，后面按原始长度取用）
+    if (flags & FLAG_ENCRYPTED) {
+        MemoryBuffer *plain = buffer_pool_acquire(current->size);
+        if (!plain || !decrypt_to_buffer(current->buffer, current->size, plain, password)) {
+            fprintf(stderr, "Decryption failed\n");
+            buffer_pool_release(plain);
+            buffer_pool_release(current);
+            return 0;
+        }
+        buffer_pool_release(current);
+        current = plain;
+    }
     
-    // 清理
-    if (compressed_data != file_data) {
-        free(compressed_data);
+    // 解压数据
+    if (flags & FLAG_COMPRESSED) {
+        MemoryBuffer *raw = buffer_pool_acquire(raw_size);
+        if (!raw || !decompress_to_buffer(current->buffer, current->size, raw, raw_size,
+                                          (flags & FLAG_DICT) ? dict : NULL, dict_size)) {
+            fprintf(stderr, "Decompression failed\n");
+            buffer_pool_release(raw);
+            buffer_pool_release(current);
+            return 0;
+        }
+        buffer_pool_release(current);
+        current = raw;
+    } else if (current->size < raw_size) {
+        fprintf(stderr, "Corrupted entry: %s\n", name);
+        buffer_pool_release(current);
+        return 0;
     }
-    free(file_data);
     
+    current->size = raw_size;
+    *out = current;
     return 1;
 }
 
-// 从归档读取文件
-int read_file_from_archive(FILE *archive_fp, const FileEntry *entry,
-                          const char *dest_path, const char *password) {
+// 读取一段存储数据并还原（解密、解压），*out为raw_size字节，由调用者归还缓冲池
+static int decode_stored_data(FILE *archive_fp, uint32_t offset, uint32_t stored_size,
+                              uint16_t flags, uint32_t raw_size, const char *name,
+                              const char *password, const uint8_t *dict, size_t dict_size,
+                              MemoryBuffer **out) {
+    if ((flags & FLAG_ENCRYPTED) && (!password || !*password)) {
+        fprintf(stderr, "File is encrypted, password required\n");
+        return 0;
+    }
+    
     // 保存当前位置
     long current_pos = ftell(archive_fp);
     
-    // 跳转到文件数据开始处
-    fseek(archive_fp, entry->offset, SEEK_SET);
+    // 读取存储的数据
+    MemoryBuffer *current = buffer_pool_acquire(stored_size);
+    if (!current) {
+        return 0;
+    }
     
-    // 读取文件数据
-    uint8_t *stored_data = malloc(entry->stored_size);
-    if (!stored_data) {
+    StatsMark mark;
+    stats_begin(&mark);
+    fseek(archive_fp, offset, SEEK_SET);
+    if (fread(current->buffer, 1, stored_size, archive_fp) != stored_size) {
+        fprintf(stderr, "Short read for file: %s\n", name);
+        buffer_pool_release(current);
         fseek(archive_fp, current_pos, SEEK_SET);
         return 0;
     }
+    fseek(archive_fp, current_pos, SEEK_SET);
+    stats_end(STATS_READ, &mark, stored_size, stored_size);
+    current->size = stored_size;
     
-    fread(stored_data, 1, entry->stored_size, archive_fp);
+    return decode_stored_buffer(current, flags, raw_size, name, password, dict, dict_size, out);
+}
+
+// 解码固实块到缓存（顺序解压时每个块只解码一次）
+static int load_solid_block(ArchiveFile *af, uint32_t index, const char *password) {
+    if (af->block_cache && af->cached_block == index) {
+        return 1;
+    }
+    if (index >= af->header.block_count) {
+        fprintf(stderr, "Invalid solid block index: %u\n", index);
+        return 0;
+    }
     
-    // 解密数据
-    uint8_t *decrypted_data = stored_data;
-    size_t decrypted_size = entry->stored_size;
+    BlockEntry *block = &af->blocks[index];
+    MemoryBuffer *data = NULL;
+    if (!decode_stored_data(af->fp, block->offset, block->stored_size, block->flags,
+                            block->raw_size, "solid block", password, NULL, 0, &data)) {
+        return 0;
+    }
     
-    if (entry->flags & FLAG_ENCRYPTED) {
-        if (!password || !*password) {
-            fprintf(stderr, "File is encrypted, password required\n");
-            free(stored_data);
-            fseek(archive_fp, current_pos, SEEK_SET);
-            return 0;
+    if (calculate_crc32(data->buffer, block->raw_size) != block->crc32) {
+        fprintf(stderr, "CRC32 mismatch for solid block %u\n", index);
+        buffer_pool_release(data);
+        return 0;
+    }
+    
+    buffer_pool_release(af->block_cache);
+    af->block_cache = data;
+    af->cached_block = index;
+    return 1;
+}
+
+// 按需加载归档内的预置字典
+static int load_dictionary(ArchiveFile *af, const char *password) {
+    if (af->dict) return 1;
+    if (af->header.dict_offset == 0 || af->header.dict_size == 0 ||
+        af->header.dict_size > DICT_MAX_SIZE) {
+        fprintf(stderr, "Archive has no valid compression dictionary\n");
+        return 0;
+    }
+    
+    MemoryBuffer *data = NULL;
+    if (!decode_stored_data(af->fp, af->header.dict_offset, af->header.dict_stored_size,
+                            af->header.dict_flags & FLAG_ENCRYPTED, af->header.dict_size,
+                            "dictionary", password, NULL, 0, &data)) {
+        return 0;
+    }
+    
+    af->dict = malloc(af->header.dict_size);
+    if (af->dict) {
+        memcpy(af->dict, data->buffer, af->header.dict_size);
+        af->dict_size = af->header.dict_size;
+    }
+    buffer_pool_release(data);
+    return af->dict != NULL;
+}
+
+// 读取分块条目的块表（FLAG_CHUNKED），返回值由调用者free
+ChunkEntry* load_chunk_table(ArchiveFile *af, const FileEntry *entry) {
+    uint64_t count = entry->chunk_count;
+    uint64_t table_size = count * sizeof(ChunkEntry);
+    if (count == 0 || entry->chunk_size == 0 || table_size > entry->stored_size ||
+        (count - 1) * entry->chunk_size >= entry->file_size ||
+        count * entry->chunk_size < entry->file_size) {
+        fprintf(stderr, "Corrupted chunk table: %s\n", entry->filename);
+        return NULL;
+    }
+    
+    ChunkEntry *chunks = malloc(table_size);
+    if (!chunks) return NULL;
+    
+    long current_pos = ftell(af->fp);
+    fseek(af->fp, entry->offset + entry->stored_size - table_size, SEEK_SET);
+    size_t got = fread(chunks, sizeof(ChunkEntry), count, af->fp);
+    fseek(af->fp, current_pos, SEEK_SET);
+    if (got != count) {
+        fprintf(stderr, "Short read for file: %s\n", entry->filename);
+        free(chunks);
+        return NULL;
+    }
+    
+    // 每块必须位于块表之前的数据区内
+    uint64_t data_size = entry->stored_size - table_size;
+    for (uint32_t i = 0; i < count; i++) {
+        if ((uint64_t)chunks[i].offset + chunks[i].stored_size > data_size) {
+            fprintf(stderr, "Corrupted chunk table: %s\n", entry->filename);
+            free(chunks);
+            return NULL;
         }
-        
-        if (!decrypt_data(stored_data, entry->stored_size, &decrypted_data, &decrypted_size, password)) {
-            fprintf(stderr, "Decryption failed\n");
-            free(stored_data);
-            fseek(archive_fp, current_pos, SEEK_SET);
+    }
+    return chunks;
+}
+
+// 解码分块条目中的一块并校验CRC32，*out由调用者归还缓冲池
+int decode_member_chunk(ArchiveFile *af, const FileEntry *entry, const ChunkEntry *chunks,
+                        uint32_t index, const char *password, MemoryBuffer **out) {
+    if (index >= entry->chunk_count) return 0;
+    
+    uint64_t pos = (uint64_t)index * entry->chunk_size;
+    uint32_t raw_size = entry->file_size - pos < entry->chunk_size ?
+                        (uint32_t)(entry->file_size - pos) : entry->chunk_size;
+    const ChunkEntry *chunk = &chunks[index];
+    
+    // 空洞块没有存储数据（块表已由stored_crc32保护）
+    if (chunk->flags & FLAG_SPARSE) {
+        MemoryBuffer *zeros = buffer_pool_acquire(raw_size);
+        if (!zeros) return 0;
+        memset(zeros->buffer, 0, raw_size);
+        zeros->size = raw_size;
+        *out = zeros;
+        return 1;
+    }
+    
+    MemoryBuffer *data = NULL;
+    if (!decode_stored_data(af->fp, entry->offset + chunk->offset, chunk->stored_size,
+                            chunk->flags, raw_size, entry->filename, password,
+                            NULL, 0, &data)) {
+        return 0;
+    }
+    
+    if (update_crc32(0, data->buffer, raw_size) != chunk->crc32) {
+        fprintf(stderr, "CRC32 mismatch in chunk %u of %s\n", index, entry->filename);
+        buffer_pool_release(data);
+        return 0;
+    }
+    
+    *out = data;
+    return 1;
+}
+
+// 逐块解码分块条目到一个完整缓冲区
+static int decode_chunked_member(ArchiveFile *af, const FileEntry *entry,
+                                 const char *password, MemoryBuffer **out) {
+    ChunkEntry *chunks = load_chunk_table(af, entry);
+    if (!chunks) return 0;
+    
+    MemoryBuffer *data = buffer_pool_acquire(entry->file_size);
+    if (!data) {
+        free(chunks);
+        return 0;
+    }
+    
+    // 每块已单独校验，整个文件的CRC32由块CRC合并得到
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    size_t pos = 0;
+    for (uint32_t i = 0; i < entry->chunk_count; i++) {
+        MemoryBuffer *chunk = NULL;
+        if (!decode_member_chunk(af, entry, chunks, i, password, &chunk)) {
+            buffer_pool_release(data);
+            free(chunks);
             return 0;
         }
-        
-        free(stored_data);
+        memcpy(data->buffer + pos, chunk->buffer, chunk->size);
+        crc = crc32_combine(crc, chunks[i].crc32, chunk->size);
+        pos += chunk->size;
+        buffer_pool_release(chunk);
     }
+    free(chunks);
     
-    // 解压数据
-    uint8_t *decompressed_data = decrypted_data;
-    size_t decompressed_size = decrypted_size;
+    if (crc != entry->crc32) {
+        fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
+        buffer_pool_release(data);
+        return 0;
+    }
     
-    if (entry->flags & FLAG_COMPRESSED) {
-        if (!decompress_data(decrypted_data, decrypted_size, &decompressed_data, entry->file_size)) {
-            fprintf(stderr, "Decompression failed\n");
-            if (decrypted_data != stored_data) {
-                free(decrypted_data);
-            }
-            fseek(archive_fp, current_pos, SEEK_SET);
+    data->size = entry->file_size;
+    *out = data;
+    return 1;
+}
+
+// decode_file_from_archive的实现
+static int decode_member_data(ArchiveFile *af, const FileEntry *entry,
+                              const char *password, MemoryBuffer **out) {
+    MemoryBuffer *data = NULL;
+    
+    if (entry->flags & FLAG_CHUNKED) {
+        return decode_chunked_member(af, entry, password, out);
+    }
+    
+    if (entry->flags & FLAG_SOLID) {
+        // 只需解码所在的固实块
+        if (!load_solid_block(af, entry->block_index, password)) {
+            return 0;
+        }
+        
+        BlockEntry *block = &af->blocks[entry->block_index];
+        if ((uint64_t)entry->block_offset + entry->file_size > block->raw_size) {
+            fprintf(stderr, "Corrupted entry: %s\n", entry->filename);
             return 0;
         }
         
-        if (decrypted_data != stored_data) {
-            free(decrypted_data);
+        data = buffer_pool_acquire(entry->file_size);
+        if (!data) return 0;
+        memcpy(data->buffer, af->block_cache->buffer + entry->block_offset, entry->file_size);
+        data->size = entry->file_size;
+    } else {
+        if ((entry->flags & FLAG_DICT) && !load_dictionary(af, password)) {
+            return 0;
+        }
+        if (!decode_stored_data(af->fp, entry->offset, entry->stored_size, entry->flags,
+                                entry->file_size, entry->filename, password,
+                                af->dict, af->dict_size, &data)) {
+            return 0;
         }
     }
     
     // 验证CRC32
-    uint32_t calculated_crc = calculate_crc32(decompressed_data, entry->file_size);
+    uint32_t calculated_crc = calculate_crc32(data->buffer, entry->file_size);
     if (calculated_crc != entry->crc32) {
         fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
-        free(decompressed_data);
-        fseek(archive_fp, current_pos, SEEK_SET);
+        buffer_pool_release(data);
         return 0;
     }
     
-    // 构建目标路径
-    char full_path[512];
-    if (dest_path && *dest_path) {
-        snprintf(full_path, sizeof(full_path), "%s/%s", dest_path, entry->filename);
-    } else {
-        snprintf(full_path, sizeof(full_path), "%s", entry->filename);
-    }
-    
-    // 创建目录（如果需要）
-    char *last_slash = strrchr(full_path, '/');
-    if (last_slash) {
-        *last_slash = '\0';
-        // 创建目录
-        #ifdef _WIN32
-            _mkdir(full_path);
-        #else
-            mkdir(full_path, 0755);
-        #endif
-        *last_slash = '/';
-    }
-    
-    // 写入文件
-    FILE *dest_fp = fopen(full_path, "wb");
-    if (!dest_fp) {
-        fprintf(stderr, "Cannot create file: %s\n", full_path);
-        free(decompressed_data);
-        fseek(archive_fp, current_pos, SEEK_SET);
+    *out = data;
+    return 1;
+}
+
+// 从归档读取并解码文件内容（解密、解压、校验CRC32），*out由调用者归还缓冲池
+int decode_file_from_archive(ArchiveFile *af, const FileEntry *entry,
+                             const char *password, MemoryBuffer **out) {
+    int traced = trace_member_begin(entry->filename);
+    int ok = decode_member_data(af, entry, password, out);
+    if (traced) trace_member_end();
+    return ok;
+}
+
+// 未编码的大条目按块复制，同时计算CRC32
+static int copy_plain_member(ArchiveFile *af, const FileEntry *entry, OutputSink *sink) {
+    MemoryBuffer *buf = buffer_pool_acquire(MEMBER_CHUNK_SIZE);
+    if (!buf) return 0;
+    
+    int fd = fileno(af->fp);
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    uint64_t done = 0;
+    int ok = 1;
+    while (ok && done < entry->file_size) {
+        size_t n = entry->file_size - done < MEMBER_CHUNK_SIZE ?
+                   (size_t)(entry->file_size - done) : MEMBER_CHUNK_SIZE;
+        StatsMark mark;
+        stats_begin(&mark);
+        ssize_t got = pread(fd, buf->buffer, n, entry->offset + done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            fprintf(stderr, "Short read for file: %s\n", entry->filename);
+            ok = 0;
+            break;
+        }
+        stats_end(STATS_READ, &mark, got, got);
+        crc = update_crc32(crc, buf->buffer, got);
+        ok = output_sink_write(sink, buf->buffer, got);
+        archive_progress_bytes(af, got, entry->filename);
+        done += got;
+    }
+    buffer_pool_release(buf);
+    
+    if (ok && crc != entry->crc32) {
+        fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
+        ok = 0;
+    }
+    return ok;
+}
+
+// 分块条目逐块解码写出
+static int copy_chunked_member(ArchiveFile *af, const FileEntry *entry,
+                               const char *password, OutputSink *sink) {
+    ChunkEntry *chunks = load_chunk_table(af, entry);
+    if (!chunks) return 0;
+    
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < entry->chunk_count; i++) {
+        // 空洞只移动输出位置，文件输出端上重新形成空洞
+        if (chunks[i].flags & FLAG_SPARSE) {
+            uint64_t pos = (uint64_t)i * entry->chunk_size;
+            size_t n = entry->file_size - pos < entry->chunk_size ?
+                       (size_t)(entry->file_size - pos) : entry->chunk_size;
+            crc = crc32_combine(crc, chunks[i].crc32, n);
+            ok = output_sink_hole(sink, n);
+            archive_progress_bytes(af, n, entry->filename);
+            continue;
+        }
+        
+        MemoryBuffer *chunk = NULL;
+        if (!decode_member_chunk(af, entry, chunks, i, password, &chunk)) {
+            ok = 0;
+            break;
+        }
+        crc = crc32_combine(crc, chunks[i].crc32, chunk->size);
+        ok = output_sink_write(sink, chunk->buffer, chunk->size);
+        archive_progress_bytes(af, chunk->size, entry->filename);
+        buffer_pool_release(chunk);
+    }
+    free(chunks);
+    
+    if (ok && crc != entry->crc32) {
+        fprintf(stderr, "CRC32 mismatch for file: %s\n", entry->filename);
+        ok = 0;
+    }
+    return ok;
+}
+
+// write_member_to_sink的实现
+static int copy_member_to_sink(ArchiveFile *af, const FileEntry *entry,
+                               const char *password, OutputSink *sink) {
+    if (entry->flags & FLAG_CHUNKED) {
+        return copy_chunked_member(af, entry, password, sink);
+    }
+    if (!(entry->flags & (FLAG_COMPRESSED | FLAG_ENCRYPTED | FLAG_SOLID | FLAG_DICT)) &&
+        entry->file_size > MEMBER_CHUNK_SIZE) {
+        return copy_plain_member(af, entry, sink);
+    }
+    
+    // 其余条目不超过一个块（或旧版本归档），整体解码
+    MemoryBuffer *data = NULL;
+    if (!decode_file_from_archive(af, entry, password, &data)) {
+        return 0;
+    }
+    int ok = output_sink_write(sink, data->buffer, entry->file_size);
+    buffer_pool_release(data);
+    return ok;
+}
+
+// 把条目解码后按块写入输出端（分块条目和未编码条目不需要整个文件的缓冲区）
+int write_member_to_sink(ArchiveFile *af, const FileEntry *entry,
+                         const char *password, OutputSink *sink) {
+    int traced = trace_member_begin(entry->filename);
+    int ok = copy_member_to_sink(af, entry, password, sink);
+    if (traced) trace_member_end();
+    return ok;
+}
+
+// 解压时先写入的临时文件（与目标同目录，写完后rename替换目标）。
+// 每次调用取新的序号，同名条目同时在途时各用各的临时文件；
+// 加上后缀超过NAME_MAX时改用不含成员名的短名称
+int extract_temp_path(const char *name, char *temp, size_t size) {
+    static uint32_t sequence = 0;
+    uint32_t seq = __atomic_fetch_add(&sequence, 1, __ATOMIC_RELAXED);
+    int n = snprintf(temp, size, "%s.arctmp%ld.%u", name, (long)getpid(), seq);
+    if (n > NAME_MAX) {
+        n = snprintf(temp, size, ".arctmp%ld.%u", (long)getpid(), seq);
+    }
+    return n > 0 && (size_t)n < size;
+}
+
+// 用写好的临时文件原子地替换目标（都相对dir_fd）；ok为0或rename失败时删除临时文件
+int commit_extract_file(int dir_fd, const char *temp, const char *name, int ok) {
+    if (ok && renameat(dir_fd, temp, dir_fd, name) != 0) {
+        fprintf(stderr, "Cannot replace %s: %s\n", name, strerror(errno));
+        ok = 0;
+    }
+    if (!ok) {
+        unlinkat(dir_fd, temp, 0);
+    }
+    return ok;
+}
+
+// 目标是否已与条目一致：普通文件，大小、mtime和权限相同；checksum时再比较内容的CRC32
+static int extract_target_current(const FileEntry *entry, int dir_fd, const char *name, int checksum) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode) ||
+        (uint64_t)st.st_size != entry->file_size || st.st_mtime != entry->mtime ||
+        (st.st_mode & 0777) != (entry->mode & 0777)) {
+        return 0;
+    }
+    if (!checksum) return 1;
+    
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    MemoryBuffer *buf = buffer_pool_acquire(MEMBER_CHUNK_SIZE);
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    uint64_t done = 0;
+    int ok = buf != NULL;
+    while (ok && done < entry->file_size) {
+        ssize_t n = read(fd, buf->buffer, MEMBER_CHUNK_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = 0;
+            break;
+        }
+        crc = update_crc32(crc, buf->buffer, n);
+        done += n;
+    }
+    buffer_pool_release(buf);
+    close(fd);
+    return ok && done == entry->file_size && crc == entry->crc32;
+}
+
+// 增量解压：目标已与条目一致时跳过（--force/--overwrite时总是重写）
+static int skip_current_target(ArchiveContext *ctx, DirCache *dirs, const FileEntry *entry) {
+    if (ctx->extract_overwrite || (entry->flags & (FLAG_DIRECTORY | FLAG_SYMLINK))) {
+        return 0;
+    }
+    const char *name = NULL;
+    int dir_fd = dir_cache_parent(dirs, entry->filename, &name);
+    if (dir_fd < 0 || !extract_target_current(entry, dir_fd, name, ctx->extract_checksum)) {
+        return 0;
+    }
+    ctx->extract_skipped++;
+    return 1;
+}
+
+// 记录已解压（或已是最新）的文件，之后与它共享数据的硬链接条目链接到它
+static void remember_extracted(ArchiveFile *af, uint32_t index, const FileEntry *entry) {
+    if (!(af->header.flags & ARCHIVE_FLAG_HARDLINKS) || entry->file_size == 0 ||
+        (entry->flags & (FLAG_DIRECTORY | FLAG_SYMLINK))) {
+        return;
+    }
+    uint64_t key_a, key_b;
+    archive_entry_data_key(entry, &key_a, &key_b);
+    archive_link_add(af, key_a, key_b, index);
+}
+
+// 硬链接条目：与本次已解压的原条目建立硬链接（先链接到临时名再替换目标）。
+// 原条目不在本次解压的文件中或无法链接时返回0，由调用者照常解码
+static int link_extracted_member(ArchiveFile *af, DirCache *dirs, const FileEntry *entry) {
+    uint64_t key_a, key_b;
+    uint32_t index;
+    FileEntry primary;
+    if (!(entry->flags & FLAG_HARDLINK)) return 0;
+    archive_entry_data_key(entry, &key_a, &key_b);
+    if (!archive_link_find(af, key_a, key_b, &index) || !archive_read_entry(af, index, &primary)) {
+        return 0;
+    }
+    
+    const char *primary_name = NULL;
+    int primary_dir = dir_cache_parent(dirs, primary.filename, &primary_name);
+    if (primary_dir < 0) return 0;
+    dir_cache_pin(dirs, primary_dir);
+    
+    const char *name = NULL;
+    int dir_fd = dir_cache_parent(dirs, entry->filename, &name);
+    char temp[NAME_MAX + 32];
+    struct stat target, source;
+    int ok = 0;
+    if (dir_fd >= 0 && fstatat(primary_dir, primary_name, &source, AT_SYMLINK_NOFOLLOW) == 0) {
+        if (fstatat(dir_fd, name, &target, AT_SYMLINK_NOFOLLOW) == 0 &&
+            target.st_dev == source.st_dev && target.st_ino == source.st_ino) {
+            // 已经是同一个文件（rename不会替换同一inode的另一个链接）
+            ok = 1;
+        } else if (extract_temp_path(name, temp, sizeof(temp)) &&
+                   linkat(primary_dir, primary_name, dir_fd, temp, 0) == 0) {
+            ok = commit_extract_file(dir_fd, temp, name, 1);
+        }
+    }
+    dir_cache_unpin(dirs, primary_dir);
+    return ok;
+}
+
+// 恢复文件属性（基于fd，不再解析路径）
+static void restore_entry_attributes(int fd, const FileEntry *entry) {
+    struct timespec times[2];
+    fchmod(fd, entry->mode & 0777);
+    times[0].tv_sec = entry->atime;
+    times[0].tv_nsec = 0;
+    times[1].tv_sec = entry->mtime;
+    times[1].tv_nsec = 0;
+    futimens(fd, times);
+}
+
+// read_file_from_archive的实现
+static int extract_member_file(ArchiveFile *af, const FileEntry *entry,
+                               DirCache *dirs, const char *password) {
+    const char *name = NULL;
+    int dir_fd = dir_cache_parent(dirs, entry->filename, &name);
+    if (dir_fd < 0) {
+        fprintf(stderr, "Cannot create directory for %s: %s\n", entry->filename, strerror(errno));
+        return 0;
+    }
+    char temp[NAME_MAX + 32];
+    if (!extract_temp_path(name, temp, sizeof(temp))) {
+        fprintf(stderr, "Name too long: %s\n", entry->filename);
         return 0;
     }
     
-    fwrite(decompressed_data, 1, entry->file_size, dest_fp);
-    fclose(dest_fp);
+    // 解码后的数据流入临时文件，完整写出后才替换目标
+    OutputSink *sink = output_sink_file_at(dir_fd, temp, 0644);
+    if (!sink) {
+        fprintf(stderr, "Cannot create file: %s\n", entry->filename);
+        return 0;
+    }
     
-    // 恢复文件属性
-    #ifndef _WIN32
-        chmod(full_path, entry->mode & 0777);
-        struct utimbuf times;
-        times.actime = entry->atime;
-        times.modtime = entry->mtime;
-        utime(full_path, &times);
-    #endif
+    // 大小已知，一次预分配整个文件，避免逐块追加造成碎片（稀疏文件保留空洞，不预分配）
+    int ok = 1;
+    if (entry->file_size >= PREALLOC_MIN_SIZE && !(entry->flags & FLAG_SPARSE) &&
+        !file_preallocate(sink->fd, entry->file_size)) {
+        fprintf(stderr, "Cannot allocate space for %s: %s\n", entry->filename, strerror(errno));
+        ok = 0;
+    }
     
-    free(decompressed_data);
-    fseek(archive_fp, current_pos, SEEK_SET);
+    ok = ok && write_member_to_sink(af, entry, password, sink);
+    if (!ok && sink->error) {
+        fprintf(stderr, "Write failed for %s: %s\n", entry->filename, strerror(sink->error));
+    }
+    if (ok) {
+        restore_entry_attributes(sink->fd, entry);
+    }
+    if (!output_sink_close(sink)) {
+        ok = 0;
+    }
     
-    return 1;
+    // 解码失败时不留下不完整的文件，原有的目标文件保持不变
+    return commit_extract_file(dir_fd, temp, name, ok);
+}
+
+// 从归档读取文件，相对缓存的上级目录fd创建（缺少的目录逐级创建）
+int read_file_from_archive(ArchiveFile *af, const FileEntry *entry,
+                           DirCache *dirs, const char *password) {
+    int traced = trace_member_begin(entry->filename);
+    int ok = extract_member_file(af, entry, dirs, password);
+    if (traced) trace_member_end();
+    return ok;
+}
+
+// 异步解压时的在途槽
+typedef struct {
+    IoRequest req;
+    MemoryBuffer *data;
+    FileEntry entry;           // 解压的条目（路径为entry.filename）
+    uint32_t index;            // 条目序号
+    char temp[NAME_MAX + 32];  // 写入的临时文件，完成后rename为name
+    const char *name;          // path中的最后一段
+    int dir_fd;                // 上级目录（在途期间固定在缓存中）
+} ExtractSlot;
+
+// 处理一个已完成的异步写请求
+static void finish_extract_request(ArchiveFile *af, IoRequest *req, DirCache *dirs) {
+    ExtractSlot *slot = req->user;
+    if (!req->result) {
+        fprintf(stderr, "Failed to extract file: %s (%s)\n", slot->entry.filename, strerror(req->error));
+    }
+    if (commit_extract_file(slot->dir_fd, slot->temp, slot->name, req->result)) {
+        remember_extracted(af, slot->index, &slot->entry);
+    }
+    archive_progress_member(af, slot->entry.file_size, slot->entry.filename);
+    dir_cache_unpin(dirs, slot->dir_fd);
+    buffer_pool_release(slot->data);
+    slot->data = NULL;
+    req->data = NULL;
+}
+
+// 是否有同名条目正在写入
+static int extract_in_flight(const ExtractSlot *slots, unsigned depth, const char *filename) {
+    for (unsigned i = 0; i < depth; i++) {
+        if (slots[i].data && strcmp(slots[i].entry.filename, filename) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 通过I/O引擎解压：主线程解码，open/write/fchmod/futimens/close异步批量执行
+static void extract_entries_async(ArchiveContext *ctx, ArchiveFile *af,
+                                  const uint32_t *selected, uint32_t selected_count,
+                                  DirCache *dirs, IoEngine *engine, unsigned depth) {
+    ExtractSlot *slots = calloc(depth, sizeof(ExtractSlot));
+    ExtractSlot **free_slots = calloc(depth, sizeof(ExtractSlot *));
+    if (!slots || !free_slots) {
+        free(slots);
+        free(free_slots);
+        for (uint32_t i = 0; i < selected_count; i++) {
+            FileEntry entry;
+            if (!archive_read_entry(af, selected[i], &entry)) {
+                fprintf(stderr, "Archive entry table is corrupted\n");
+                break;
+            }
+            if (skip_current_target(ctx, dirs, &entry) || link_extracted_member(af, dirs, &entry)) {
+                remember_extracted(af, selected[i], &entry);
+            } else if (!read_file_from_archive(af, &entry, dirs, ctx->password)) {
+                fprintf(stderr, "Failed to extract file #%u\n", selected[i] + 1);
+            } else {
+                remember_extracted(af, selected[i], &entry);
+            }
+            archive_progress_member(af, entry.file_size, entry.filename);
+        }
+        return;
+    }
+    
+    unsigned free_count = depth;
+    for (unsigned i = 0; i < depth; i++) {
+        free_slots[i] = &slots[i];
+    }
+    
+    for (uint32_t i = 0; i < selected_count; i++) {
+        FileEntry current;
+        if (!archive_read_entry(af, selected[i], &current)) {
+            fprintf(stderr, "Archive entry table is corrupted\n");
+            break;
+        }
+        const FileEntry *entry = &current;
+        if (skip_current_target(ctx, dirs, entry)) {
+            remember_extracted(af, selected[i], entry);
+            archive_progress_member(af, entry->file_size, entry->filename);
+            continue;
+        }
+        
+        // 硬链接条目等原条目的在途写入完成后再链接；
+        // 同名条目（如add过的文件）等前一个写完，保证后面的条目覆盖前面的
+        if ((entry->flags & FLAG_HARDLINK) || extract_in_flight(slots, depth, entry->filename)) {
+            while (free_count < depth) {
+                IoRequest *done = io_engine_reap(engine);
+                if (!done) break;
+                finish_extract_request(af, done, dirs);
+                free_slots[free_count++] = done->user;
+            }
+        }
+        if ((entry->flags & FLAG_HARDLINK) && link_extracted_member(af, dirs, entry)) {
+            archive_progress_member(af, entry->file_size, entry->filename);
+            continue;
+        }
+        
+        // 大文件走同步路径，避免大量占用内存；稀疏文件要在输出中保留空洞
+        if (entry->file_size > IO_ENGINE_INLINE_MAX || (entry->flags & FLAG_SPARSE)) {
+            if (!read_file_from_archive(af, entry, dirs, ctx->password)) {
+                fprintf(stderr, "Failed to extract file: %s\n", entry->filename);
+            } else {
+                remember_extracted(af, selected[i], entry);
+            }
+            archive_progress_member(af, entry->file_size, entry->filename);
+            continue;
+        }
+        
+        // 等待空闲槽
+        while (free_count == 0) {
+            IoRequest *done = io_engine_reap(engine);
+            if (!done) break;
+            finish_extract_request(af, done, dirs);
+            free_slots[free_count++] = done->user;
+        }
+        
+        MemoryBuffer *data = NULL;
+        if (!decode_file_from_archive(af, entry, ctx->password, &data)) {
+            fprintf(stderr, "Failed to extract file: %s\n", entry->filename);
+            archive_progress_member(af, entry->file_size, entry->filename);
+            continue;
+        }
+        
+        ExtractSlot *slot = free_slots[--free_count];
+        slot->entry = *entry;
+        slot->index = selected[i];
+        slot->dir_fd = dir_cache_parent(dirs, slot->entry.filename, &slot->name);
+        if (slot->dir_fd < 0 || !extract_temp_path(slot->name, slot->temp, sizeof(slot->temp))) {
+            fprintf(stderr, "Cannot create file: %s\n", entry->filename);
+            buffer_pool_release(data);
+            free_slots[free_count++] = slot;
+            archive_progress_member(af, entry->file_size, entry->filename);
+            continue;
+        }
+        dir_cache_pin(dirs, slot->dir_fd);
+        
+        IoRequest *req = &slot->req;
+        memset(req, 0, sizeof(IoRequest));
+        req->op = IO_OP_WRITE_FILE;
+        req->path = slot->temp;
+        req->dir_fd = slot->dir_fd;
+        slot->data = data;
+        req->data = data->buffer;
+        req->size = entry->file_size;
+        req->info.mode = entry->mode;
+        req->info.atime = entry->atime;
+        req->info.mtime = entry->mtime;
+        req->user = slot;
+        
+        if (!io_engine_submit(engine, req)) {
+            fprintf(stderr, "Failed to extract file: %s\n", entry->filename);
+            dir_cache_unpin(dirs, slot->dir_fd);
+            buffer_pool_release(data);
+            slot->data = NULL;
+            free_slots[free_count++] = slot;
+            archive_progress_member(af, entry->file_size, entry->filename);
+        }
+    }
+    
+    // 等待剩余请求完成
+    IoRequest *done;
+    while ((done = io_engine_reap(engine)) != NULL) {
+        finish_extract_request(af, done, dirs);
+    }
+    
+    free(slots);
+    free(free_slots);
+}
+
+// 通过I/O引擎创建：按顺序写入归档，同时保持depth个文件的open/statx/read在途
+static void create_members_async(ArchiveContext *ctx, ArchiveFile *af, IoEngine *engine,
+                                 unsigned depth, char **files, int count,
+                                 int *success_count, int *missing_count) {
+    IoRequest *reqs = calloc(depth, sizeof(IoRequest));
+    if (!reqs) return;
+    
+    int submitted = 0;
+    for (int i = 0; i < count; i++) {
+        // 保持队列填满
+        while (submitted < count && submitted - i < (int)depth) {
+            IoRequest *req = &reqs[submitted % depth];
+            memset(req, 0, sizeof(IoRequest));
+            req->op = IO_OP_READ_FILE;
+            req->path = files[submitted];
+            req->drop_cache = ctx->drop_cache;
+            if (!io_engine_submit(engine, req)) {
+                req->done = 1;
+                req->result = 0;
+                req->error = EIO;
+            }
+            submitted++;
+        }
+        
+        IoRequest *req = &reqs[i % depth];
+        while (!req->done) {
+            if (!io_engine_reap(engine)) break;
+        }
+        progress_add_source(af->progress, req->done && req->result && S_ISREG(req->info.mode) ?
+                                          req->info.size : 0);
+        
+        if (!req->done || !req->result) {
+            if (req->done && req->error == ENOENT) {
+                report_error(ctx, "File does not exist");
+                (*missing_count)++;
+            }
+            fprintf(stderr, "Failed to write file: %s\n", files[i]);
+            archive_progress_member(af, 0, files[i]);
+            continue;
+        }
+        
+        int ok;
+        if (req->data) {
+            ok = write_buffer_to_archive(af, files[i], &req->info, req->data,
+                                         ctx->compression_level, ctx->password, NULL);
+            buffer_pool_release(req->buffer);
+            req->buffer = NULL;
+            req->data = NULL;
+        } else {
+            // 大文件或非普通文件：引擎交还了打开的fd
+            ok = write_fd_to_archive(af, req->fd, files[i], &req->info,
+                                     ctx->compression_level, ctx->password, NULL);
+            if (ctx->drop_cache) {
+                file_drop_cache(req->fd);
+            }
+            close(req->fd);
+            req->fd = -1;
+        }
+        
+        if (ok) {
+            (*success_count)++;
+        } else {
+            fprintf(stderr, "Failed to write file: %s\n", files[i]);
+        }
+        archive_progress_member(af, req->info.size, files[i]);
+    }
+    
+    free(reqs);
 }
 ArchiveContext* archive_context_create(void){
     ArchiveContext *ctx = malloc(sizeof(ArchiveContext));
@@ -837,6 +2580,14 @@ ArchiveContext* archive_context_create(void){
     ctx->recursive = 0;
     ctx->exclude_patterns = NULL;
     ctx->exclude_count = 0;
+    ctx->include_patterns = NULL;
+    ctx->include_count = 0;
+    ctx->io_backend = IO_BACKEND_SYNC;
+    ctx->io_depth = IO_ENGINE_DEFAULT_DEPTH;
+    ctx->solid_block_size = 0;
+    ctx->dict_size = 0;
+    ctx->direct_io = 0;
+    ctx->drop_cache = 0;
     ctx->api = NULL;
     
     return ctx;
@@ -849,7 +2600,7 @@ int archive_context_destroy(ArchiveContext *ctx){
     }
     
     if (ctx->write_buffer) {
-        free(ctx->write_buffer);
+        destroy_buffer(ctx->write_buffer);
     }
     
     if (ctx->exclude_patterns) {
@@ -859,26 +2610,101 @@ int archive_context_destroy(ArchiveContext *ctx){
         free(ctx->exclude_patterns);
     }
     
+    archive_set_include_patterns(ctx, NULL, 0);
+    archive_progress_end(ctx);
+    
     free(ctx);
     return 0;
 }
+
+// 设置解压的成员选择（复制patterns；count为0时恢复为全部解压）
+int archive_set_include_patterns(ArchiveContext *ctx, char **patterns, int count) {
+    if (!ctx) return ARCHIVE_ERROR_INVALID;
+    
+    for (int i = 0; i < ctx->include_count; i++) {
+        free(ctx->include_patterns[i]);
+    }
+    free(ctx->include_patterns);
+    ctx->include_patterns = NULL;
+    ctx->include_count = 0;
+    
+    if (count <= 0) return ARCHIVE_OK;
+    
+    ctx->include_patterns = calloc(count, sizeof(char *));
+    if (!ctx->include_patterns) return ARCHIVE_ERROR_MEMORY;
+    for (int i = 0; i < count; i++) {
+        // 去掉末尾的'/'，"dir/"与"dir"等价
+        char *pattern = strdup(patterns[i]);
+        if (!pattern) {
+            archive_set_include_patterns(ctx, NULL, 0);
+            return ARCHIVE_ERROR_MEMORY;
+        }
+        size_t len = strlen(pattern);
+        while (len > 1 && pattern[len - 1] == '/') {
+            pattern[--len] = '\0';
+        }
+        ctx->include_patterns[i] = pattern;
+        ctx->include_count++;
+    }
+    return ARCHIVE_OK;
+}
+
+// 设置结构化进度回调（callback为NULL时取消）
+int archive_set_progress_callback(ArchiveContext *ctx, ProgressCallback callback, void *user,
+                                  unsigned max_per_second) {
+    if (!ctx) return ARCHIVE_ERROR_INVALID;
+    
+    ctx->progress_callback = callback;
+    ctx->progress_user = user;
+    ctx->progress_rate = max_per_second;
+    return ARCHIVE_OK;
+}
+
+// 单个模式是否匹配：glob、完整路径，或该路径下的成员
+static int match_member_pattern(const char *pattern, const char *name) {
+    size_t len = strlen(pattern);
+    if (strncmp(name, pattern, len) == 0 && (name[len] == '\0' || name[len] == '/')) {
+        return 1;
+    }
+    if (strpbrk(pattern, "*?[") == NULL) {
+        return 0;
+    }
+    return fnmatch(pattern, name, 0) == 0;
+}
+
+// 成员是否被选中；matched非NULL时记录命中的模式
+int archive_member_selected(const ArchiveContext *ctx, const char *name, uint8_t *matched) {
+    if (!ctx || ctx->include_count == 0) return 1;
+    
+    int selected = 0;
+    for (int i = 0; i < ctx->include_count; i++) {
+        if (match_member_pattern(ctx->include_patterns[i], name)) {
+            selected = 1;
+            if (!matched) break;
+            matched[i] = 1;
+        }
+    }
+    return selected;
+}
+
+// 报告没有命中任何成员的模式，返回其个数
+int archive_report_unmatched(const ArchiveContext *ctx, const uint8_t *matched) {
+    int unmatched = 0;
+    for (int i = 0; ctx && i < ctx->include_count; i++) {
+        if (!matched[i]) {
+            fprintf(stderr, "Not found in archive: %s\n", ctx->include_patterns[i]);
+            unmatched++;
+        }
+    }
+    return unmatched;
+}
  int archive_append_files(ArchiveContext *ctx, const char **files, int file_count) {
     if (!ctx || !ctx->current_archive) {
         report_error(ctx, "No open archive to append files to");
         return ARCHIVE_ERROR_INVALID;
     }
     
-    for (int i = 0; i < file_count; i++) {
-        report_progress(ctx, (i * 100) / file_count, files[i]);
-        
-        if (!write_file_to_archive(ctx->current_archive->fp, files[i], 
-                                   ctx->compression_level, ctx->password)) {
-            fprintf(stderr, "Failed to append file: %s\n", files[i]);
-        } else {
-            ctx->current_archive->header.file_count++;
-        }
-    }
-    
+    append_source_files(ctx, ctx->current_archive, (char **)files, file_count, "append");
     ctx->current_archive->is_modified = 1;
     return ARCHIVE_OK;
 }
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "../include/archiver.h"
+
+// 条目表分页访问：1.1格式的条目表是定长FileEntry数组，按ENTRY_PAGE_ENTRIES分页。
+// 打开归档时只读取页目录，条目页在访问时用pread加载，只缓存ENTRY_CACHE_PAGES页；
+// 文件名哈希索引让按路径查找只读取几个槽和一页条目。
+// 写模式和1.0格式仍使用内存中的完整条目数组。
+
+// FNV-1a文件名哈希
+static uint32_t name_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 从归档读取指定偏移的数据（不移动文件位置）
+static int read_at(ArchiveFile *af, void *buf, size_t size, uint64_t offset) {
+    int fd = fileno(af->fp);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, size - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (n == 0) return 0;
+        done += n;
+    }
+    return 1;
+}
+
+// 加载页目录；旧的1.1归档没有页目录，按固定页大小计算页偏移
+int entry_index_open(ArchiveFile *af) {
+    uint32_t count = af->header.file_count;
+    uint32_t per_page = af->header.page_dir_offset ? af->header.page_entries : ENTRY_PAGE_ENTRIES;
+    if (per_page == 0) return 0;
+
+    af->page_count = (count + per_page - 1) / per_page;
+    af->page_dir = calloc(af->page_count, sizeof(EntryPageInfo));
+    af->page_cache = calloc(ENTRY_CACHE_PAGES, sizeof(EntryPage));
+    if (!af->page_dir || !af->page_cache) return 0;
+
+    if (af->header.page_dir_offset) {
+        if (!read_at(af, af->page_dir, sizeof(EntryPageInfo) * af->page_count,
+                     af->header.page_dir_offset)) {
+            return 0;
+        }
+        // 页目录必须与条目数一致
+        uint64_t total = 0;
+        for (uint32_t p = 0; p < af->page_count; p++) {
+            if (af->page_dir[p].count == 0 || af->page_dir[p].count > per_page) return 0;
+            total += af->page_dir[p].count;
+        }
+        if (total != count) return 0;
+    } else {
+        for (uint32_t p = 0; p < af->page_count; p++) {
+            uint32_t first = p * per_page;
+            af->page_dir[p].offset = af->header.index_offset + (uint64_t)first * sizeof(FileEntry);
+            af->page_dir[p].count = count - first < per_page ? count - first : per_page;
+        }
+    }
+    af->header.page_entries = per_page;
+    return 1;
+}
+
+void entry_index_close(ArchiveFile *af) {
+    if (af->page_cache) {
+        for (uint32_t i = 0; i < ENTRY_CACHE_PAGES; i++) {
+            free(af->page_cache[i].entries);
+        }
+        free(af->page_cache);
+        af->page_cache = NULL;
+    }
+    free(af->page_dir);
+    af->page_dir = NULL;
+}
+
+// 返回缓存中的页，未缓存时替换最久未使用的页
+static EntryPage* load_page(ArchiveFile *af, uint32_t page) {
+    EntryPage *victim = NULL;
+    for (uint32_t i = 0; i < ENTRY_CACHE_PAGES; i++) {
+        EntryPage *slot = &af->page_cache[i];
+        if (slot->count && slot->page == page) {
+            slot->last_used = ++af->page_clock;
+            return slot;
+        }
+        // 优先使用空闲页，否则替换最久未使用的页
+        if (!victim || (victim->count && (!slot->count || slot->last_used < victim->last_used))) {
+            victim = slot;
+        }
+    }
+
+    const EntryPageInfo *info = &af->page_dir[page];
+    if (!victim->entries) {
+        victim->entries = malloc(sizeof(FileEntry) * af->header.page_entries);
+        if (!victim->entries) return NULL;
+    }
+    victim->count = 0;
+    if (!read_at(af, victim->entries, sizeof(FileEntry) * info->count, info->offset)) {
+        return NULL;
+    }
+    // 有页目录时校验页内容
+    if (af->header.page_dir_offset &&
+        crc32(0L, (const Bytef *)victim->entries, sizeof(FileEntry) * info->count) != info->crc32) {
+        return NULL;
+    }
+
+    victim->page = page;
+    victim->count = info->count;
+    victim->last_used = ++af->page_clock;
+    return victim;
+}
+
+int archive_read_entry(ArchiveFile *af, uint32_t index, FileEntry *entry) {
+    if (!af || index >= af->header.file_count) return 0;
+
+    if (af->entries) {
+        *entry = af->entries[index];
+        return 1;
+    }
+    if (!af->page_dir) return 0;
+
+    EntryPage *page = load_page(af, index / af->header.page_entries);
+    if (!page) return 0;
+    *entry = page->entries[index % af->header.page_entries];
+    entry->filename[sizeof(entry->filename) - 1] = '\0';
+    return 1;
+}
+
+int archive_find_entry(ArchiveFile *af, const char *name, FileEntry *entry, uint32_t *index) {
+    uint32_t slots = af->header.name_index_slots;
+
+    if (!af->entries && af->header.name_index_offset && slots && (slots & (slots - 1)) == 0) {
+        uint32_t hash = name_hash(name);
+        uint32_t pos = hash & (slots - 1);
+        NameIndexSlot batch[64];
+
+        // 线性探测，每次读取一批连续的槽
+        for (uint32_t probed = 0; probed < slots; ) {
+            uint32_t n = slots - pos < 64 ? slots - pos : 64;
+            if (!read_at(af, batch, sizeof(NameIndexSlot) * n,
+                         af->header.name_index_offset + (uint64_t)pos * sizeof(NameIndexSlot))) {
+                return 0;
+            }
+            for (uint32_t i = 0; i < n && probed < slots; i++, probed++) {
+                if (batch[i].entry == 0) return 0;
+                if (batch[i].hash != hash) continue;
+                if (!archive_read_entry(af, batch[i].entry - 1, entry)) return 0;
+                if (strcmp(entry->filename, name) == 0) {
+                    if (index) *index = batch[i].entry - 1;
+                    return 1;
+                }
+            }
+            pos = (pos + n) & (slots - 1);
+        }
+        return 0;
+    }
+
+    // 没有哈希索引：扫描条目表，重名时取最后一个
+    int found = 0;
+    FileEntry current;
+    for (uint32_t i = 0; i < af->header.file_count; i++) {
+        if (!archive_read_entry(af, i, &current)) return 0;
+        if (strcmp(current.filename, name) == 0) {
+            *entry = current;
+            if (index) *index = i;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+int entry_index_write(ArchiveFile *af) {
+    ArchiveWriter *writer = af->writer;
+    uint32_t count = af->header.file_count;
+
+    af->header.page_dir_offset = 0;
+    af->header.page_entries = 0;
+    af->header.name_index_offset = 0;
+    af->header.name_index_slots = 0;
+    if (count == 0) return 1;
+
+    // 页目录：每页的偏移、条目数和CRC32
+    uint32_t page_count = (count + ENTRY_PAGE_ENTRIES - 1) / ENTRY_PAGE_ENTRIES;
+    EntryPageInfo *dir = calloc(page_count, sizeof(EntryPageInfo));
+    if (!dir) return 0;
+    for (uint32_t p = 0; p < page_count; p++) {
+        uint32_t first = p * ENTRY_PAGE_ENTRIES;
+        dir[p].offset = af->header.index_offset + (uint64_t)first * sizeof(FileEntry);
+        dir[p].count = count - first < ENTRY_PAGE_ENTRIES ? count - first : ENTRY_PAGE_ENTRIES;
+        dir[p].crc32 = crc32(0L, (const Bytef *)&af->entries[first], sizeof(FileEntry) * dir[p].count);
+    }
+
+    af->header.page_dir_offset = archive_writer_tell(writer);
+    af->header.page_entries = ENTRY_PAGE_ENTRIES;
+    int ok = archive_writer_write(writer, dir, sizeof(EntryPageInfo) * page_count);
+    free(dir);
+
+    // 文件名哈希索引：槽数为条目数两倍以上的2的幂。
+    // 重名时保留最后一个条目，与依次解压后留下的文件一致
+    uint32_t slots = 16;
+    while (slots < (uint64_t)count * 2 && slots < (1u << 31)) {
+        slots <<= 1;
+    }
+    NameIndexSlot *table = calloc(slots, sizeof(NameIndexSlot));
+    if (!table) return 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t hash = name_hash(af->entries[i].filename);
+        uint32_t pos = hash & (slots - 1);
+        while (table[pos].entry &&
+               (table[pos].hash != hash ||
+                strcmp(af->entries[table[pos].entry - 1].filename, af->entries[i].filename) != 0)) {
+            pos = (pos + 1) & (slots - 1);
+        }
+        table[pos].hash = hash;
+        table[pos].entry = i + 1;
+    }
+
+    af->header.name_index_offset = archive_writer_tell(writer);
+    af->header.name_index_slots = slots;
+    ok &= archive_writer_write(writer, table, sizeof(NameIndexSlot) * slots);
+    free(table);
+    return ok;
+}
@@ -0,0 +1,236 @@
+#!/bin/sh
+# 回归测试：每个用例在临时目录中运行archive命令并检查结果
+# 用法：tests/regress.sh [archive可执行文件]（默认build/bin/archive）
+
+ARCHIVE=${1:-build/bin/archive}
+case "$ARCHIVE" in
+    /*) ;;
+    *) ARCHIVE="$(pwd)/$ARCHIVE" ;;
+esac
+LD_LIBRARY_PATH="$(dirname "$ARCHIVE")${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+export LD_LIBRARY_PATH
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/archive-regress.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+
+# 运行一个用例：在单独的目录中执行函数，返回0为通过
+run_case() {
+    name=$1
+    mkdir -p "$WORK/$name"
+    if (cd "$WORK/$name" && "$name" > log 2>&1); then
+        echo "PASS $name"
+        passed=$((passed + 1))
+    else
+        echo "FAIL $name"
+        sed 's/^/    /' "$WORK/$name/log"
+        failed=$((failed + 1))
+    fi
+}
+
+fail() {
+    echo "$*"
+    return 1
+}
+
+# 超过4 GiB的成员（稀疏文件，不占磁盘）被拒绝，而不是截断大小后静默丢失数据；
+# 4 GiB以内的稀疏文件完整还原
+sparse_over_4g() {
+    truncate -s 5G big || return 1
+    printf 'head' | dd of=big conv=notrunc 2>/dev/null
+    printf 'tail' | dd of=big bs=1M seek=4600 conv=notrunc 2>/dev/null
+    if "$ARCHIVE" create big.arc big; then
+        fail "5 GiB member was accepted"
+        return 1
+    fi
+
+    truncate -s 4000M ok || return 1
+    printf 'tail' | dd of=ok bs=1M seek=3900 conv=notrunc 2>/dev/null
+    "$ARCHIVE" create ok.arc ok || fail "create of 4000 MiB sparse file failed" || return 1
+    "$ARCHIVE" extract -C out ok.arc || fail "extract failed" || return 1
+    cmp ok out/ok || fail "restored sparse file differs"
+}
+
+# 固实块的成员数是16位：超过65535个小文件时必须分成多个块；只有空文件的块也要能解压
+solid_many_members() {
+    mkdir d e || return 1
+    i=0
+    while [ $i -lt 70000 ]; do
+        echo x > d/$i
+        i=$((i + 1))
+    done
+    "$ARCHIVE" create --solid many.arc d/* > /dev/null || fail "create failed" || return 1
+    "$ARCHIVE" test many.arc || fail "test rejected the archive" || return 1
+    "$ARCHIVE" extract -C out many.arc > /dev/null || fail "extract failed" || return 1
+    diff -r d out/d || fail "extracted files differ" || return 1
+
+    : > e/a
+    : > e/b
+    "$ARCHIVE" create --solid empty.arc e/a e/b > /dev/null || fail "create failed" || return 1
+    "$ARCHIVE" test empty.arc || fail "test rejected the empty-file archive" || return 1
+    "$ARCHIVE" extract -C out2 empty.arc > /dev/null &&
+        [ -f out2/e/a ] && [ -f out2/e/b ] || fail "empty files not extracted"
+}
+
+# 解压的临时文件名加在成员名后面：名称接近NAME_MAX时要改用短名称
+extract_long_name() {
+    long=$(printf '%0250d' 0)
+    echo long > "$long"
+    echo other > other
+    "$ARCHIVE" create long.arc "$long" other > /dev/null || fail "create failed" || return 1
+    for io in sync threads uring; do
+        rm -rf out
+        "$ARCHIVE" extract --io $io -C out long.arc > /dev/null || fail "extract --io $io failed" || return 1
+        cmp "$long" "out/$long" || fail "long name not extracted with --io $io" || return 1
+    done
+}
+
+# add已有的文件后归档中有同名条目：异步解压时不能共用临时文件，后面的条目覆盖前面的
+extract_duplicate_names() {
+    echo v0 > f
+    i=0
+    while [ $i -lt 8 ]; do
+        echo $i > g$i
+        i=$((i + 1))
+    done
+    "$ARCHIVE" create dup.arc f g* > /dev/null || fail "create failed" || return 1
+    # 各版本大小不同，避免同一秒内的修改被快速检查（大小+mtime）当作未变
+    for v in 1 22 333; do
+        echo v$v > f
+        "$ARCHIVE" add dup.arc f > /dev/null || fail "add failed" || return 1
+    done
+    for io in sync threads uring; do
+        rm -rf out
+        "$ARCHIVE" extract --io $io -C out dup.arc > err 2>&1 || fail "extract --io $io failed" || return 1
+        if grep -q "Cannot" err; then
+            cat err
+            fail "extract --io $io reported errors"
+            return 1
+        fi
+        [ "$(cat out/f)" = v333 ] || fail "--io $io restored $(cat out/f) instead of v333" || return 1
+        [ -z "$(ls -a out | grep arctmp)" ] || fail "temp files left with --io $io" || return 1
+    done
+}
+
+# 大量结构相似的小JSON文件：--dict应接近--solid的压缩效果。
+# 要求字典模式至少拿到固实模式相对逐个压缩节省量的3/4（三者的条目表开销相同）
+dict_ratio_vs_solid() {
+    mkdir c || return 1
+    awk 'BEGIN {
+        srand(7)
+        split("Berlin Paris London Madrid Rome Vienna Prague Warsaw Lisbon Dublin", city, " ")
+        split("active pending suspended closed", status, " ")
+        split("Anna Ben Carla David Eva Felix Greta Hugo", first, " ")
+        split("Schmidt Meyer Martin Rossi Novak Garcia", last, " ")
+        for (i = 0; i < 2000; i++) {
+            f = sprintf("c/r%04d.json", i)
+            printf "{\n  \"id\": %d,\n  \"uuid\": \"%08x-%04x-4%03x\",\n", i, int(rand() * 2^31), int(rand() * 65536), int(rand() * 4096) > f
+            printf "  \"name\": \"%s %s\",\n  \"email\": \"user%d@example.com\",\n", first[int(rand() * 8) + 1], last[int(rand() * 6) + 1], i > f
+            printf "  \"status\": \"%s\",\n  \"address\": {\n    \"street\": \"%d Main Street\",\n", status[int(rand() * 4) + 1], int(rand() * 300) > f
+            printf "    \"city\": \"%s\",\n    \"zip\": \"%05d\",\n    \"country\": \"EU\"\n  },\n", city[int(rand() * 10) + 1], int(rand() * 90000) + 10000 > f
+            printf "  \"created_at\": \"2024-%02d-%02dT%02d:%02d:00Z\",\n", int(rand() * 12) + 1, int(rand() * 28) + 1, int(rand() * 24), int(rand() * 60) > f
+            printf "  \"settings\": {\n    \"notifications\": %s,\n    \"theme\": \"%s\"\n  },\n", rand() < 0.5 ? "true" : "false", rand() < 0.5 ? "dark" : "light" > f
+            printf "  \"balance\": %.2f\n}\n", rand() * 10000 > f
+            close(f)
+        }
+    }' || return 1
+    "$ARCHIVE" create plain.arc c/* > /dev/null || fail "create failed" || return 1
+    "$ARCHIVE" create --dict dict.arc c/* > /dev/null || fail "create --dict failed" || return 1
+    "$ARCHIVE" create --solid solid.arc c/* > /dev/null || fail "create --solid failed" || return 1
+    plain=$(wc -c < plain.arc)
+    dict=$(wc -c < dict.arc)
+    solid=$(wc -c < solid.arc)
+    echo "plain $plain, dict $dict, solid $solid"
+    [ $((4 * (dict - solid))) -le $((plain - solid)) ] || fail "dictionary mode too far from solid mode" || return 1
+    "$ARCHIVE" extract -C out dict.arc > /dev/null || fail "extract failed" || return 1
+    diff -r c out/c || fail "extracted files differ"
+}
+
+# 子命令自己的选项（包括-C这样与全局选项同名的）必须传到子命令，不能被全局解析吃掉
+subcommand_options() {
+    mkdir -p src/sub || return 1
+    echo one > src/a.c
+    echo two > src/b.txt
+    echo three > src/sub/c.c
+    "$ARCHIVE" -q create --solid --io threads --drop-cache -c 9 s.arc src/a.c src/b.txt src/sub/c.c ||
+        fail "create with subcommand options failed" || return 1
+    "$ARCHIVE" list s.arc | grep -q "src/a.c .*S" || fail "--solid did not reach create" || return 1
+    "$ARCHIVE" verify --fast --fail-fast s.arc || fail "verify --fast --fail-fast failed" || return 1
+    "$ARCHIVE" extract -C out --io uring --checksum s.arc 'src/*.c' ||
+        fail "extract -C with a glob failed" || return 1
+    cmp src/a.c out/src/a.c && cmp src/sub/c.c out/src/sub/c.c || fail "selected members differ" || return 1
+    [ ! -e out/src/b.txt ] || fail "unselected member was extracted" || return 1
+    [ ! -e src/src ] || fail "-C was ignored" || return 1
+    mkdir j || return 1
+    for i in 1 2 3 4 5 6 7 8; do
+        echo "{\"id\": $i, \"name\": \"item number $i\", \"status\": \"active\", \"tags\": [\"alpha\", \"beta\"]}" > j/$i.json
+    done
+    "$ARCHIVE" create --dict d.arc j/*.json || fail "create --dict failed" || return 1
+    "$ARCHIVE" list d.arc | grep -q "j/1.json .*T" || fail "--dict did not reach create"
+}
+
+# 预分配只是提示：可压缩的大文件在文件大小限制（或空间、配额）低于原始大小时仍能归档
+prealloc_over_limit() {
+    awk 'BEGIN { for (i = 0; i < 600000; i++) printf "line %d of a compressible text file\n", i % 1000 }' > big.txt ||
+        return 1
+    (trap '' XFSZ; ulimit -f 20000; "$ARCHIVE" create big.arc big.txt) > /dev/null ||
+        fail "create under a 20 MB file size limit failed" || return 1
+    [ -s big.arc ] || fail "archive is empty" || return 1
+    "$ARCHIVE" extract -C out big.arc > /dev/null || fail "extract failed" || return 1
+    cmp big.txt out/big.txt || fail "extracted file differs"
+}
+
+# add/remove/update重写归档：原有成员读不出或复制失败时必须保留原归档，不能丢成员
+rewrite_keeps_original() {
+    echo aaa > a
+    echo bbb > b
+    echo ccc > c
+    "$ARCHIVE" -q create t.arc a b || fail "create failed" || return 1
+    # 改坏第一个条目（条目表偏移在头部第36字节），条目页的CRC32不再匹配
+    off=$(od -An -tu4 -j36 -N4 t.arc | tr -d ' ')
+    printf 'Z' | dd of=t.arc bs=1 seek=$((off + 100)) conv=notrunc 2>/dev/null
+    cp t.arc t.orig
+    for cmd in "remove t.arc b" "add t.arc c" "update t.arc b"; do
+        if "$ARCHIVE" -q $cmd; then
+            fail "$cmd succeeded on a damaged entry table"
+            return 1
+        fi
+        cmp t.arc t.orig || fail "$cmd replaced the original archive" || return 1
+        [ ! -e t.arc.tmp ] || fail "$cmd left its temp archive" || return 1
+    done
+}
+
+# 成员路径中的".."和目标目录中已有的指向外部的符号链接都不能让解压写到-C之外
+extract_stays_inside() {
+    mkdir -p w/sub w/link outside || return 1
+    echo evil > w/x
+    echo link > w/link/f
+    echo good > w/sub/ok
+    (cd w/sub && "$ARCHIVE" -q create ../../dots.arc ../x ok) || fail "create failed" || return 1
+    (cd w && "$ARCHIVE" -q create ../link.arc link/f) || fail "create failed" || return 1
+    rm w/x
+
+    "$ARCHIVE" -q extract -C out/d dots.arc 2> err
+    [ ! -e out/x ] && [ ! -e w/x ] || fail "../x was written outside the target" || return 1
+    grep -q "\.\./x" err || fail "../x was not reported" || return 1
+    [ "$(cat out/d/ok)" = good ] || fail "ok was not extracted" || return 1
+
+    mkdir -p out/l && ln -s ../../outside out/l/link
+    "$ARCHIVE" -q extract -C out/l link.arc 2> /dev/null
+    [ ! -e outside/f ] || fail "extract followed a symlinked directory out of the target"
+}
+
+run_case subcommand_options
+run_case extract_stays_inside
+run_case rewrite_keeps_original
+run_case prealloc_over_limit
+run_case sparse_over_4g
+run_case solid_many_members
+run_case extract_long_name
+run_case extract_duplicate_names
+run_case dict_ratio_vs_solid
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]